@@ -5,6 +5,7 @@ macro(project_setup_options)
         set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -O0 -g --coverage")
         set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -O0 -g --coverage")
         set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} --coverage")
+        set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} --coverage")
 
         option(PROJECT_ENABLE_CLANG_TIDY "Enable clang-tidy checks" ON)
         option(PROJECT_ENABLE_CPPCHECK "Enable cppcheck checks" ON)
@@ -39,6 +40,12 @@ macro(project_setup_options)
     endif(CMAKE_BUILD_TYPE STREQUAL "RelWithDebInfo")
     
     
+    option(PROJECT_BUILD_BENCHMARKS "Build benchmarks" OFF)
+    option(PROJECT_ENABLE_IPO "Enable interprocedural optimization (LTO)" OFF)
+    set(PROJECT_PGO "OFF" CACHE STRING "Profile-guided optimization phase: OFF, GENERATE or USE")
+    set_property(CACHE PROJECT_PGO PROPERTY STRINGS OFF GENERATE USE)
+    set(PROJECT_PGO_DIR "${CMAKE_BINARY_DIR}/pgo-profile" CACHE PATH "Directory of the profiles of the PGO training")
+
     add_library(project_options INTERFACE)
 
 
@@ -54,6 +61,13 @@ macro(project_setup_options)
         project_enable_clang_tidy(project_options ${PROJECT_ENABLE_WARNINGS_AS_ERRORS})
     endif(PROJECT_ENABLE_CLANG_TIDY)
     
+    include(cmake/Optimization.cmake)
+    if(PROJECT_ENABLE_IPO)
+        message(STATUS "Enabling IPO/LTO")
+        project_enable_ipo()
+    endif(PROJECT_ENABLE_IPO)
+    project_enable_pgo(project_options ${PROJECT_PGO} ${PROJECT_PGO_DIR})
+
     if(PROJECT_BUILD_TESTS)
         message(STATUS "Enabling tests")
         include(FetchContent)
@@ -68,6 +82,11 @@ macro(project_setup_options)
         add_subdirectory(test)
     endif(PROJECT_BUILD_TESTS)
 
+    if(PROJECT_BUILD_BENCHMARKS)
+        message(STATUS "Enabling benchmarks")
+        add_subdirectory(bench)
+    endif(PROJECT_BUILD_BENCHMARKS)
+
     if(PROJECT_COMPILER_WARNINGS)
         message(STATUS "Enabling compiler warnings")
         include(cmake/CompilerWarnings.cmake)
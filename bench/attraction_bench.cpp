@@ -0,0 +1,102 @@
+#include "coordinate.hpp"
+#include "eom.hpp"
+#include "fish.hpp"
+#include "grid.hpp"
+#include "simulation.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+// NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+
+// Error and speed of the cell-aggregate attraction against the exact sum, for a dense spherical school.
+// Usage: attraction_bench [n_fish] [school_radius]
+int main(int argc, char *argv[])
+{
+  const unsigned int n_fish = argc > 1 ? static_cast<unsigned int>(std::stoul(argv[1])) : 20000;
+  const double school_radius = argc > 2 ? std::stod(argv[2]) : 8.0;
+
+  const SimParam sim_param{ .length = 32, .n_fish = n_fish, .max_steps = 1, .delta_t = 0.01, .snapshot_interval = 1 };
+  const FishParam fish_param{ .vel_standard = 1.5,
+    .vel_repulsion = 1.5,
+    .vel_escape = 7.5,
+    .body_length = 1.0,
+    .repulsion_radius = 1.0,
+    .attraction_radius = 7.5,
+    .n_cog = 3,
+    .attraction_str = 15.0,
+    .attraction_duration = 0.1 };
+
+  // Fish spread uniformly in a ball at the centre of the box, all feeling the attraction
+  std::mt19937 gen(1);// NOLINT(cert-msc32-c,cert-msc51-cpp)
+  std::uniform_real_distribution<double> dis_unit(-1.0, 1.0);
+  School fish{};
+  fish.reserve(n_fish);
+  while (fish.size() < n_fish) {
+    const Vect3 offset{ .x = dis_unit(gen), .y = dis_unit(gen), .z = dis_unit(gen) };
+    if (absolute(offset) > 1.0) { continue; }
+    const double centre = static_cast<double>(sim_param.length) / 2;
+    fish.emplace_back(Vect3{ .x = centre, .y = centre, .z = centre } + school_radius * offset,
+      Vect3{ .x = dis_unit(gen), .y = dis_unit(gen), .z = dis_unit(gen) },
+      Vect3{ .x = 0.0, .y = 0.0, .z = 0.0 },
+      1.0);
+  }
+
+  auto attractive_cells = getBoundaryBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
+  const auto attractive_inner = getInnerBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
+  attractive_cells.insert(attractive_cells.end(), attractive_inner.begin(), attractive_inner.end());
+  const auto attractive_runs = getStencilRuns(attractive_cells);
+
+  CellList cells(sim_param.length, getStencilReach(attractive_cells));
+  cells.build(fish);
+  cells.computeCentroids();
+
+  // Exact attraction as the reference
+  std::vector<Vect3> exact(fish.size());
+  const auto exact_begin = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    exact[i] = std::get<0>(calcAttraction(fish[i], sim_param, fish_param, cells, attractive_runs));
+  }
+  const std::chrono::duration<double> exact_time = std::chrono::steady_clock::now() - exact_begin;
+
+  std::cout << "n_fish " << n_fish << ", school radius " << school_radius << '\n';
+  std::cout << std::setw(14) << "opening angle" << std::setw(14) << "time [s]" << std::setw(14) << "speedup"
+            << std::setw(14) << "rms rel err" << std::setw(14) << "max rel err" << '\n';
+  std::cout << std::setw(14) << "exact" << std::setw(14) << exact_time.count() << std::setw(14) << 1.0
+            << std::setw(14) << 0.0 << std::setw(14) << 0.0 << '\n';
+
+  for (const double opening_angle : { 0.1, 0.2, 0.3, 0.5, 0.75, 1.0 }) {
+    std::vector<Vect3> approximate(fish.size());
+    const auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < fish.size(); i++) {
+      approximate[i] =
+        std::get<0>(calcAttraction(fish[i], sim_param, fish_param, cells, attractive_runs, opening_angle));
+    }
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+
+    // Error relative to the magnitude of the exact attraction
+    double squared_error = 0.0;
+    double max_error = 0.0;
+    for (std::size_t i = 0; i < fish.size(); i++) {
+      if (absolute(exact[i]) == 0.0) { continue; }
+      const double error = absolute(approximate[i] - exact[i]) / absolute(exact[i]);
+      squared_error += error * error;
+      max_error = std::max(max_error, error);
+    }
+    std::cout << std::setw(14) << opening_angle << std::setw(14) << time.count() << std::setw(14)
+              << exact_time.count() / time.count() << std::setw(14)
+              << std::sqrt(squared_error / static_cast<double>(fish.size())) << std::setw(14) << max_error << '\n';
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Compare the wall time of two builds of fish_schooling on the same workload, e.g. the default and the PGO build:
+#   bench/compare_builds.sh build/release/src/fish_schooling build/pgo-use/src/fish_schooling
+# The builds run alternately, and the best of the runs of each is kept.
+
+baseline=$1
+candidate=$2
+config=${3:-$(dirname "$0")/workload.yaml}
+runs=${4:-5}
+
+if [ -z "$baseline" ] || [ -z "$candidate" ]; then
+    echo "Usage: $0 <baseline binary> <candidate binary> [config] [runs]"
+    exit 1
+fi
+
+for binary in "$baseline" "$candidate"; do
+    if [ ! -x "$binary" ]; then
+        echo "Binary '$binary' not found!"
+        exit 1
+    fi
+done
+
+if [ ! -f "$config" ]; then
+    echo "Config file '$config' not found!"
+    exit 1
+fi
+
+# The simulation writes output.txt to the working directory
+config=$(realpath "$config")
+baseline=$(realpath "$baseline")
+candidate=$(realpath "$candidate")
+workdir=$(mktemp -d)
+trap 'rm -rf "$workdir"' EXIT
+cd "$workdir" || exit 1
+
+# Wall time of one run in milliseconds, failing with the run
+time_run() {
+    local start end
+    start=$(date +%s%N)
+    "$1" --config "$config" > /dev/null || return 1
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+best_baseline=""
+best_candidate=""
+for run in $(seq "$runs"); do
+    # The substitution runs in a subshell, so a failed run is caught here
+    baseline_ms=$(time_run "$baseline") || { echo "Baseline run $run failed!"; exit 1; }
+    candidate_ms=$(time_run "$candidate") || { echo "Candidate run $run failed!"; exit 1; }
+    echo "run $run: baseline ${baseline_ms} ms, candidate ${candidate_ms} ms"
+    if [ -z "$best_baseline" ] || [ "$baseline_ms" -lt "$best_baseline" ]; then best_baseline=$baseline_ms; fi
+    if [ -z "$best_candidate" ] || [ "$candidate_ms" -lt "$best_candidate" ]; then best_candidate=$candidate_ms; fi
+done
+
+echo "best: baseline ${best_baseline} ms, candidate ${best_candidate} ms"
+awk -v b="$best_baseline" -v c="$best_candidate" 'BEGIN { printf "speedup: %.3f\n", b / c }'
@@ -0,0 +1,203 @@
+#include "coordinate.hpp"
+#include "driver.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+
+namespace {
+
+constexpr std::size_t n_observables = 3;
+constexpr std::array<const char *, n_observables> observable_names = { "polarization", "speed", "nn distance" };
+
+// Polarization, mean speed and mean nearest neighbour distance of the school
+template<typename F>
+std::array<double, n_observables> observe(const BasicSchool<F> &fish, const SimParam &sim_param)
+{
+  Vect3 velocity_sum{ .x = 0.0, .y = 0.0, .z = 0.0 };
+  double speed_sum = 0.0;
+  double nearest_sum = 0.0;
+  for (const auto &one_fish : fish) {
+    const auto velocity = castVect3<double>(one_fish.getVelocity());
+    velocity_sum += velocity;
+    speed_sum += absolute(velocity);
+
+    double nearest = std::numeric_limits<double>::max();
+    for (const auto &other_fish : fish) {
+      if (&other_fish == &one_fish) { continue; }
+      if constexpr (std::is_same_v<F, FixedFish>) {
+        nearest = std::min(nearest,
+          absolute(vect12(one_fish.getFixedPosition(), other_fish.getFixedPosition(), sim_param.length)));
+      } else {
+        nearest = std::min(nearest,
+          absolute(vect12(castVect3<double>(one_fish.getPosition()),
+            castVect3<double>(other_fish.getPosition()),
+            sim_param.length)));
+      }
+    }
+    nearest_sum += nearest;
+  }
+  const auto n_fish = static_cast<double>(fish.size());
+  return { absolute(velocity_sum) / speed_sum, speed_sum / n_fish, nearest_sum / n_fish };
+}
+
+struct Run
+{
+  std::array<double, n_observables> observables;// Averaged over the second half of the run
+  double step_time;// Seconds per step
+};
+
+// Simulate the school with the neighbour search of the parameters in the precision of F
+template<typename F>
+Run simulate(const School &initial, const SimParam &sim_param, const FishParam &fish_param)
+{
+  constexpr unsigned int sample_interval = 10;
+  BasicSchool<F> fish{};
+  fish.reserve(initial.size());
+  for (const auto &one_fish : initial) {
+    if constexpr (std::is_same_v<F, FixedFish>) {
+      fish.emplace_back(one_fish, sim_param.length);
+    } else {
+      fish.emplace_back(one_fish);
+    }
+  }
+  BasicSimulation<F> simulation(sim_param, fish_param, std::move(fish));
+  Run run{ .observables = {}, .step_time = 0.0 };
+  unsigned int n_samples = 0;
+  std::chrono::duration<double> time{ 0.0 };
+  for (unsigned int step = 0; step < sim_param.max_steps; step++) {
+    const auto begin = std::chrono::steady_clock::now();
+    simulation.step();
+    time += std::chrono::steady_clock::now() - begin;
+
+    if (2 * step >= sim_param.max_steps && step % sample_interval == 0) {
+      const auto observables = observe(simulation.getSchool(), sim_param);
+      for (std::size_t k = 0; k < n_observables; k++) { run.observables[k] += observables[k]; }
+      n_samples++;
+    }
+  }
+  for (auto &observable : run.observables) { observable /= n_samples; }
+  run.step_time = time.count() / sim_param.max_steps;
+  return run;
+}
+
+}// namespace
+
+// Statistics of the trajectories in float, mixed and fixed precision against double.
+// The trajectories diverge after a few hundred steps whatever the precision, so the observables averaged over the
+// second half of the runs are compared over an ensemble of initial schools, in units of their standard error.
+// Usage: precision_bench [n_fish] [n_steps] [n_runs] [neighbour_search], the search being cell (default), tiled,
+// kd-tree or all-pairs
+int main(int argc, char *argv[])
+{
+  const unsigned int n_fish = argc > 1 ? static_cast<unsigned int>(std::stoul(argv[1])) : 500;
+  const unsigned int n_steps = argc > 2 ? static_cast<unsigned int>(std::stoul(argv[2])) : 400;
+  const unsigned int n_runs = argc > 3 ? static_cast<unsigned int>(std::stoul(argv[3])) : 4;
+  const std::string search = argc > 4 ? argv[4] : "cell";
+
+  SimParam sim_param{
+    .length = 32, .n_fish = n_fish, .max_steps = n_steps, .delta_t = 0.01, .snapshot_interval = n_steps
+  };
+  if (search == "cell") {
+    sim_param.neighbour_search = NeighbourSearch::Cell;
+  } else if (search == "tiled") {
+    sim_param.neighbour_search = NeighbourSearch::Tiled;
+  } else if (search == "kd-tree") {
+    sim_param.neighbour_search = NeighbourSearch::KdTree;
+  } else if (search == "all-pairs") {
+    sim_param.neighbour_search = NeighbourSearch::AllPairs;
+  } else {
+    std::cerr << "Unknown neighbour-search: " << search << '\n';
+    return EXIT_FAILURE;
+  }
+  const FishParam fish_param{ .vel_standard = 1.5,
+    .vel_repulsion = 1.5,
+    .vel_escape = 7.5,
+    .body_length = 1.0,
+    .repulsion_radius = 1.0,
+    .attraction_radius = 7.5,
+    .n_cog = 3,
+    .attraction_str = 15.0,
+    .attraction_duration = 0.1 };
+
+  constexpr std::array<const char *, 4> precision_names = { "double", "float", "mixed", "fixed" };
+  std::array<std::vector<Run>, 4> runs{};
+  for (unsigned int seed = 0; seed < n_runs; seed++) {
+    // Fish in a ball at the centre of the box, wrapped into it, swimming in random directions
+    std::mt19937 gen(seed);// NOLINT(cert-msc32-c,cert-msc51-cpp)
+    std::uniform_real_distribution<double> dis_unit(-1.0, 1.0);
+    const double school_radius = fish_param.repulsion_radius * std::cbrt(n_fish);
+    const double centre = static_cast<double>(sim_param.length) / 2;
+    School initial{};
+    while (initial.size() < n_fish) {
+      const Vect3 offset{ .x = dis_unit(gen), .y = dis_unit(gen), .z = dis_unit(gen) };
+      const Vect3 direction{ .x = dis_unit(gen), .y = dis_unit(gen), .z = dis_unit(gen) };
+      if (absolute(offset) > 1.0 || absolute(direction) == 0.0) { continue; }
+      const Vect3 position = Vect3{ .x = centre, .y = centre, .z = centre } + school_radius * offset;
+      initial.emplace_back(periodic(position, sim_param.length),
+        fish_param.vel_standard * normalize(direction),
+        Vect3{ .x = 0.0, .y = 0.0, .z = 0.0 },
+        0.0);
+    }
+
+    runs[0].push_back(simulate<Fish>(initial, sim_param, fish_param));
+    runs[1].push_back(simulate<FishF>(initial, sim_param, fish_param));
+    runs[2].push_back(simulate<MixedFish>(initial, sim_param, fish_param));
+    runs[3].push_back(simulate<FixedFish>(initial, sim_param, fish_param));
+  }
+
+  // Mean and standard error over the runs
+  const auto statistics = [n_runs](const std::vector<Run> &ensemble, std::size_t k) {
+    double sum = 0.0;
+    double squared_sum = 0.0;
+    for (const auto &run : ensemble) {
+      sum += run.observables[k];
+      squared_sum += run.observables[k] * run.observables[k];
+    }
+    const double mean = sum / n_runs;
+    const double variance = n_runs > 1 ? (squared_sum - n_runs * mean * mean) / (n_runs - 1) : 0.0;
+    return std::array<double, 2>{ mean, std::sqrt(std::max(variance, 0.0) / n_runs) };
+  };
+
+  std::cout << std::setprecision(4);
+  std::cout << "n_fish " << n_fish << ", n_steps " << n_steps << ", n_runs " << n_runs << ", " << search << '\n';
+  std::cout << std::setw(10) << "precision" << std::setw(14) << "step [ms]" << std::setw(10) << "speedup";
+  for (const auto *name : observable_names) { std::cout << std::setw(14) << name << std::setw(12) << "z"; }
+  std::cout << '\n';
+
+  double reference_time = 0.0;
+  for (const auto &run : runs[0]) { reference_time += run.step_time; }
+  for (std::size_t p = 0; p < runs.size(); p++) {
+    double step_time = 0.0;
+    for (const auto &run : runs[p]) { step_time += run.step_time; }
+    std::cout << std::setw(10) << precision_names[p] << std::setw(14) << 1e3 * step_time / n_runs << std::setw(10)
+              << reference_time / step_time;
+    for (std::size_t k = 0; k < n_observables; k++) {
+      // Difference from double in units of the combined standard error
+      const auto [mean, error] = statistics(runs[p], k);
+      const auto [reference_mean, reference_error] = statistics(runs[0], k);
+      const double combined_error = std::hypot(error, reference_error);
+      std::cout << std::setw(14) << mean << std::setw(12)
+                << (combined_error > 0.0 ? (mean - reference_mean) / combined_error : 0.0);
+    }
+    std::cout << '\n';
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
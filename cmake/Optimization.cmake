@@ -0,0 +1,70 @@
+macro(project_enable_ipo)
+  include(CheckIPOSupported)
+  check_ipo_supported(RESULT IPO_SUPPORTED OUTPUT IPO_OUTPUT)
+  if(IPO_SUPPORTED)
+    # Targets created after this point inline across the libraries at link time
+    set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+  else()
+    message(WARNING "IPO/LTO is not supported: ${IPO_OUTPUT}")
+  endif()
+endmacro()
+
+# PHASE is GENERATE to build an instrumented binary, or USE to optimize with the profiles it wrote to PROFILE_DIR.
+# Both phases may be built in different build directories.
+macro(project_enable_pgo TARGET PHASE PROFILE_DIR)
+  if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+    # The profiles are named after the object files, relative to the build directory
+    set(PGO_GENERATE_FLAGS -fprofile-generate=${PROFILE_DIR} -fprofile-update=atomic
+                           -fprofile-prefix-path=${CMAKE_BINARY_DIR})
+    # Code the training does not reach is still optimized as without profiles
+    set(PGO_USE_FLAGS -fprofile-use=${PROFILE_DIR} -fprofile-partial-training -fprofile-prefix-path=${CMAKE_BINARY_DIR}
+                      -Wno-missing-profile)
+  elseif(CMAKE_CXX_COMPILER_ID MATCHES ".*Clang")
+    set(PGO_GENERATE_FLAGS -fprofile-generate=${PROFILE_DIR} -fprofile-update=atomic)
+    set(PGO_USE_FLAGS -fprofile-use=${PROFILE_DIR}/default.profdata -Wno-profile-instr-unprofiled)
+  else()
+    message(FATAL_ERROR "PGO is only supported with GCC and Clang")
+  endif()
+
+  if(${PHASE} STREQUAL "GENERATE")
+    message(STATUS "Building for the PGO training, profiles in ${PROFILE_DIR}")
+    target_compile_options(${TARGET} INTERFACE ${PGO_GENERATE_FLAGS})
+    target_link_options(${TARGET} INTERFACE ${PGO_GENERATE_FLAGS})
+  elseif(${PHASE} STREQUAL "USE")
+    if(NOT EXISTS ${PROFILE_DIR})
+      message(FATAL_ERROR "No profile in ${PROFILE_DIR}, build the pgo-training target of the GENERATE phase first")
+    endif()
+    message(STATUS "Optimizing with the PGO profiles in ${PROFILE_DIR}")
+    target_compile_options(${TARGET} INTERFACE ${PGO_USE_FLAGS})
+    target_link_options(${TARGET} INTERFACE ${PGO_USE_FLAGS})
+  elseif(NOT ${PHASE} STREQUAL "OFF")
+    message(FATAL_ERROR "PROJECT_PGO must be OFF, GENERATE or USE, not ${PHASE}")
+  endif()
+endmacro()
+
+# Run the executable on the training configuration, writing the profiles of the GENERATE phase
+function(project_add_pgo_training EXECUTABLE CONFIG PROFILE_DIR)
+  if(CMAKE_CXX_COMPILER_ID MATCHES ".*Clang")
+    find_program(LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+    add_custom_target(
+      pgo-training
+      COMMAND ${CMAKE_COMMAND} -E rm -f ${PROFILE_DIR}/training.profraw
+      COMMAND ${CMAKE_COMMAND} -E env LLVM_PROFILE_FILE=${PROFILE_DIR}/training.profraw $<TARGET_FILE:${EXECUTABLE}>
+              --config ${CONFIG}
+      COMMAND ${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/default.profdata ${PROFILE_DIR}/training.profraw
+      WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+      DEPENDS ${EXECUTABLE}
+      COMMENT "Training ${EXECUTABLE} on ${CONFIG}"
+      VERBATIM)
+  else()
+    # Start from fresh counters, as GCC adds up the runs
+    add_custom_target(
+      pgo-training
+      COMMAND ${CMAKE_COMMAND} -E rm -rf ${PROFILE_DIR}
+      COMMAND $<TARGET_FILE:${EXECUTABLE}> --config ${CONFIG}
+      WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+      DEPENDS ${EXECUTABLE}
+      COMMENT "Training ${EXECUTABLE} on ${CONFIG}"
+      VERBATIM)
+  endif()
+endfunction()
@@ -0,0 +1,101 @@
+#ifndef ANALYSIS_HPP
+#define ANALYSIS_HPP
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <ostream>
+#include <vector>
+
+// Order parameters and shape of the school at one step
+struct Observables
+{
+  double polarization;// Norm of the mean unit velocity, 1 when every fish swims the same way
+  Vect3 centre_of_mass;// Circular mean of the positions along each axis of the periodic box
+  Vect3 angular_momentum;// Mean of r x v over the fish, r being the minimum image displacement from the centre of mass
+  double nearest_distance;// Mean distance from each fish to its nearest neighbour
+  double extent;// Radius of gyration about the centre of mass
+};
+
+// Sub-schools, each made of the fish linked by chains of fish within the connection radius of one another
+struct Clusters
+{
+  std::vector<unsigned int> labels;// Cluster of each fish, the clusters being numbered in the order of their first fish
+  std::vector<unsigned int> sizes;// Number of fish in each cluster
+};
+
+// Number of fish and their mean velocity in each voxel of a grid of resolution^3 voxels, z varying the fastest
+struct VoxelField
+{
+  unsigned int resolution;
+  std::vector<unsigned int> counts;
+  std::vector<Vect3> mean_velocities;// Zero in the empty voxels
+};
+
+// Radial distribution function g(r) of the pairs of fish up to a radius, accumulated over the analysed steps. The
+// radius should be under half the length, beyond which the minimum images miss some of the pairs.
+class RadialDistribution
+{
+private:
+  double m_radius;
+  std::vector<double> m_pairs;// Pairs of fish per bin, over all the steps
+  double m_ideal_pairs = 0.0;// Pairs per unit volume of a uniform school of as many fish, over all the steps
+
+public:
+  RadialDistribution(double radius, unsigned int n_bins);
+
+  // Add the pairs of the school, found in a grid of cells at least as wide as the radius
+  void accumulate(const School &fish, unsigned int length);
+
+  [[nodiscard]] inline unsigned int getBinCount() const { return static_cast<unsigned int>(m_pairs.size()); }
+  [[nodiscard]] inline double getBinWidth() const { return m_radius / static_cast<double>(m_pairs.size()); }
+
+  // g(r) of each bin, which tends to 1 in a uniform school
+  [[nodiscard]] std::vector<double> compute() const;
+
+  // The centre and g(r) of each bin, one per line after a header naming the columns
+  void write(std::ostream &output) const;
+};
+
+// Streams the analysis writes to and accumulators it adds to, each skipped if null
+struct AnalysisOutput
+{
+  std::ostream *observables = nullptr;
+  std::ostream *clusters = nullptr;
+  std::ostream *cluster_labels = nullptr;
+  std::ostream *field = nullptr;
+  RadialDistribution *radial_distribution = nullptr;
+};
+
+// Compute the observables in parallel reductions over the fish, the nearest neighbours being found in a k-d tree
+Observables computeObservables(const School &fish, unsigned int length);
+
+// Link the fish within the radius of one another, searching the 27 cells around each fish in a grid of cells at least
+// as wide as the radius. The threads merge the clusters of a lock-free union-find concurrently.
+Clusters findClusters(const School &fish, unsigned int length, double radius);
+
+// Bin the fish into a CellList of one cell per voxel and reduce the velocities over the fish of each cell
+VoxelField computeVoxelField(const School &fish, unsigned int length, unsigned int resolution);
+
+// Time series of the observables, one step per line after a header naming the columns
+void writeObservablesHeader(std::ostream &output);
+void writeObservables(std::ostream &output, unsigned int step, double time, const Observables &observables);
+
+// Number of clusters and histogram of their sizes as size:count pairs, one step per line after a header
+void writeClustersHeader(std::ostream &output);
+void writeClusters(std::ostream &output, unsigned int step, double time, const Clusters &clusters);
+
+// Cluster of every fish in the order of the snapshots, one step per line
+void writeClusterLabels(std::ostream &output, const Clusters &clusters);
+
+// The voxels holding any fish after a line "# step time n_voxels", one voxel per line as its three coordinates, the
+// number of fish and their mean velocity
+void writeVoxelField(std::ostream &output, unsigned int step, double time, const VoxelField &field);
+
+// Write the headers of the streams, before the first step is analysed
+void writeAnalysisHeaders(const AnalysisOutput &output);
+
+// Analyse the school after the given number of steps, writing what sim_param asks for to the streams
+void analyse(const School &fish, const SimParam &sim_param, unsigned int step, const AnalysisOutput &output);
+
+#endif// ANALYSIS_HPP
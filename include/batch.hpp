@@ -0,0 +1,92 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Replicas with the same simulation parameters and number of fish, stored lane by lane so that one vector instruction
+// advances every replica. Each lane has its own school and fish parameters. The interactions are those of
+// calcDeltaVelocitiesAllPairs() in double, so that every lane follows the trajectory of its replica run on its own.
+// A batch runs on one thread, so that batches of small schools are best run side by side.
+class ReplicaBatch
+{
+public:
+  static constexpr std::size_t lanes = 8;// The doubles of an AVX-512 register
+
+  template<typename T> using LaneArray = std::array<T, lanes>;
+
+  // Fish parameters of each lane, as arrays so that they load into vector registers
+  struct LaneParams
+  {
+    LaneArray<double> vel_standard;
+    LaneArray<double> vel_repulsion;
+    LaneArray<double> vel_escape;
+    LaneArray<double> body_length;
+    LaneArray<double> squared_repulsion_radius;
+    LaneArray<double> squared_attraction_radius;
+    LaneArray<double> n_cog;
+    LaneArray<double> attraction_str;
+    LaneArray<double> lambda_rate;// attraction_str / attraction_duration
+  };
+
+  // State of fish i of lane l at i * lanes + l
+  struct State
+  {
+    std::vector<double> pos_x;
+    std::vector<double> pos_y;
+    std::vector<double> pos_z;
+    std::vector<double> vel_x;
+    std::vector<double> vel_y;
+    std::vector<double> vel_z;
+    std::vector<double> delta_x;
+    std::vector<double> delta_y;
+    std::vector<double> delta_z;
+    std::vector<double> lambda;
+  };
+
+  // Nearest fish of every lane, k-th nearest of lane l at k * lanes + l. The indices are stored as doubles, which
+  // keeps every array of the kernel in 64-bit lanes.
+  struct Nearest
+  {
+    std::vector<double> distance;
+    std::vector<double> index;
+  };
+
+private:
+  SimParam m_sim_param;
+  std::size_t m_n_replicas;
+  std::size_t m_n_fish;
+  unsigned int m_max_cog;// Largest n_cog of the lanes
+  LaneParams m_params{};
+  State m_state;
+  Nearest m_nearest;
+
+public:
+  // Replica r in lane r with the fish parameters fish_params[r]. The lanes beyond the replicas repeat the last one.
+  ReplicaBatch(const SimParam &sim_param, const std::vector<FishParam> &fish_params);
+
+  [[nodiscard]] inline std::size_t getReplicaCount() const { return m_n_replicas; }
+  [[nodiscard]] inline const SimParam &getSimParam() const { return m_sim_param; }
+
+  // Set the school of a replica, which must have sim_param.n_fish fish
+  void setSchool(std::size_t replica, const School &fish);
+  [[nodiscard]] School getSchool(std::size_t replica) const;
+
+  // Store the change of velocity of every fish of every replica
+  void calcDeltaVelocities();
+
+  // Update the fish positions and velocities of every replica, as Fish::update()
+  void update();
+
+  // Output the fish positions and velocities of a replica, one fish per line
+  void writeSnapshot(std::size_t replica, std::ostream &output) const;
+};
+
+// Run the simulation of every replica of the batch, writing the snapshots of replica r to outputs[r]
+void simulate(ReplicaBatch &batch, const std::vector<std::ostream *> &outputs);
+
+#endif// BATCH_HPP
@@ -5,29 +5,53 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
 #include <vector>
 
 
-struct Vect3
+template<typename T> struct BasicVect3
 {
-  double x;
-  double y;
-  double z;
+  T x;
+  T y;
+  T z;
 };
 
+using Vect3 = BasicVect3<double>;
+using Vect3f = BasicVect3<float>;
+using FixedVect3 = BasicVect3<std::uint32_t>;// Unsigned 32-bit fractions of the box length
+
+// Convert the components to another scalar type
+template<typename To, typename From> [[nodiscard]] inline BasicVect3<To> castVect3(const BasicVect3<From> &vect)
+{
+  return { .x = static_cast<To>(vect.x), .y = static_cast<To>(vect.y), .z = static_cast<To>(vect.z) };
+}
+
+// Consecutive stencil cells along z at a fixed (dx, dy) offset, covering z_begin <= dz <= z_end
+struct StencilRun
+{
+  int dx;
+  int dy;
+  int z_begin;
+  int z_end;
+};
 
-Vect3 operator+(const Vect3 &lhs, const Vect3 &rhs);
-Vect3 operator-(const Vect3 &lhs, const Vect3 &rhs);
-Vect3 operator*(double scalar, const Vect3 &rhs);
-Vect3 operator*(const Vect3 &lhs, double scalar);
-Vect3 operator/(const Vect3 &lhs, double scalar);
 
-Vect3 operator+=(Vect3 &lhs, const Vect3 &rhs);
-Vect3 operator-=(Vect3 &lhs, const Vect3 &rhs);
-Vect3 operator*=(Vect3 &lhs, double scalar);
-Vect3 operator/=(Vect3 &lhs, double scalar);
+// The vector operations are instantiated for double and float in coordinate.cpp.
+// The scalars are not deduced, so that any arithmetic type scales a vector.
+template<typename T> BasicVect3<T> operator+(const BasicVect3<T> &lhs, const BasicVect3<T> &rhs);
+template<typename T> BasicVect3<T> operator-(const BasicVect3<T> &lhs, const BasicVect3<T> &rhs);
+template<typename T> BasicVect3<T> operator*(std::type_identity_t<T> scalar, const BasicVect3<T> &rhs);
+template<typename T> BasicVect3<T> operator*(const BasicVect3<T> &lhs, std::type_identity_t<T> scalar);
+template<typename T> BasicVect3<T> operator/(const BasicVect3<T> &lhs, std::type_identity_t<T> scalar);
 
-Vect3 periodic(const Vect3 &vect, unsigned int len);
+template<typename T> BasicVect3<T> operator+=(BasicVect3<T> &lhs, const BasicVect3<T> &rhs);
+template<typename T> BasicVect3<T> operator-=(BasicVect3<T> &lhs, const BasicVect3<T> &rhs);
+template<typename T> BasicVect3<T> operator*=(BasicVect3<T> &lhs, std::type_identity_t<T> scalar);
+template<typename T> BasicVect3<T> operator/=(BasicVect3<T> &lhs, std::type_identity_t<T> scalar);
+
+template<typename T> BasicVect3<T> periodic(const BasicVect3<T> &vect, unsigned int len);
 
 bool isCellOnBoundary(const std::array<int, 3> &cell, double radius, const Vect3 &center);
 
@@ -45,9 +69,99 @@ std::vector<std::array<int, 3>> getBoundaryBetween(double radius1, double radius
 
 std::vector<std::array<int, 3>> getInnerBetween(double radius1, double radius2);
 
-double absolute(const Vect3 &vect);
-Vect3 normalize(const Vect3 &vect);
+// Compress the stencil into runs of consecutive cells along z, sorted by (dx, dy, z_begin)
+std::vector<StencilRun> getStencilRuns(const std::vector<std::array<int, 3>> &cells);
+
+// Largest absolute offset (in cells) along any axis of the stencil
+unsigned int getStencilReach(const std::vector<std::array<int, 3>> &cells);
+
+// Lookup table mapping a cell coordinate c in [-reach, len + reach) to its periodic image at index c + reach
+std::vector<unsigned int> getWrapTable(unsigned int len, unsigned int reach);
+
+// Largest number of cells per side of the box for which the cells are at least min_cell_size wide
+unsigned int getCellsPerSide(unsigned int length, double min_cell_size);
 
-Vect3 vect12(const Vect3 &vect1, Vect3 vect2, unsigned int len);
+// Runs of the 27 cells around a cell, skipping the periodic images that coincide when there are fewer than 3 cells
+std::vector<StencilRun> getNeighbourRuns(unsigned int cells_per_side);
+
+template<typename T> T absolute(const BasicVect3<T> &vect);
+template<typename T> BasicVect3<T> normalize(const BasicVect3<T> &vect);
+
+// The displacements are always inlined, so that they are compiled for the SIMD level of each copy of the kernels
+template<typename T>
+[[gnu::always_inline]] inline BasicVect3<T> vect12(const BasicVect3<T> &vect1, BasicVect3<T> vect2, unsigned int len)
+{
+  const auto length = static_cast<T>(len);
+
+  if (vect2.x - vect1.x > length / 2) {
+    vect2.x -= length;
+  } else if (vect2.x - vect1.x < -length / 2) {
+    vect2.x += length;
+  }
+  if (vect2.y - vect1.y > length / 2) {
+    vect2.y -= length;
+  } else if (vect2.y - vect1.y < -length / 2) {
+    vect2.y += length;
+  }
+  if (vect2.z - vect1.z > length / 2) {
+    vect2.z -= length;
+  } else if (vect2.z - vect1.z < -length / 2) {
+    vect2.z += length;
+  }
+
+  return { .x = vect2.x - vect1.x, .y = vect2.y - vect1.y, .z = vect2.z - vect1.z };
+}
+
+constexpr double fixed_steps = 4294967296.0;// Fixed-point steps in the box length
+
+// Fixed-point coordinates wrap around the box by the overflow of the integers, so that any position or displacement
+// converts to them without branches
+FixedVect3 toFixed(const Vect3 &vect, unsigned int len);
+Vect3 fromFixed(const FixedVect3 &vect, unsigned int len);
+
+// Minimum image displacement from vect1 to vect2, which is the signed difference of the fixed-point coordinates
+[[gnu::always_inline]] inline Vect3 vect12(const FixedVect3 &vect1, const FixedVect3 &vect2, unsigned int len)
+{
+  const double scale = static_cast<double>(len) / fixed_steps;
+  return { .x = static_cast<std::int32_t>(vect2.x - vect1.x) * scale,
+    .y = static_cast<std::int32_t>(vect2.y - vect1.y) * scale,
+    .z = static_cast<std::int32_t>(vect2.z - vect1.z) * scale };
+}
+
+// Position stored as the unit cell it is in and the float offset from the corner of that cell, see MixedFish
+struct MixedPosition
+{
+  std::array<int, 3> cell;
+  Vect3f offset;
+};
+
+// Minimum image displacement from vect1 to vect2 in float, the difference of the cells, which is exact, being added to
+// the difference of the offsets
+[[gnu::always_inline]] inline Vect3f vect12(const MixedPosition &vect1, const MixedPosition &vect2, unsigned int len)
+{
+  const auto length = static_cast<float>(len);
+  Vect3f relative{ .x = static_cast<float>(vect2.cell[0] - vect1.cell[0]) + (vect2.offset.x - vect1.offset.x),
+    .y = static_cast<float>(vect2.cell[1] - vect1.cell[1]) + (vect2.offset.y - vect1.offset.y),
+    .z = static_cast<float>(vect2.cell[2] - vect1.cell[2]) + (vect2.offset.z - vect1.offset.z) };
+  for (float *component : { &relative.x, &relative.y, &relative.z }) {
+    if (*component > length / 2) {
+      *component -= length;
+    } else if (*component < -length / 2) {
+      *component += length;
+    }
+  }
+  return relative;
+}
+
+// The stored positions in double, the length converting the fixed-point ones
+[[nodiscard]] inline Vect3 toVect3(const Vect3 &vect, unsigned int /*len*/) { return vect; }
+[[nodiscard]] inline Vect3 toVect3(const Vect3f &vect, unsigned int /*len*/) { return castVect3<double>(vect); }
+[[nodiscard]] inline Vect3 toVect3(const MixedPosition &vect, unsigned int /*len*/)
+{
+  return { .x = vect.cell[0] + static_cast<double>(vect.offset.x),
+    .y = vect.cell[1] + static_cast<double>(vect.offset.y),
+    .z = vect.cell[2] + static_cast<double>(vect.offset.z) };
+}
+[[nodiscard]] inline Vect3 toVect3(const FixedVect3 &vect, unsigned int len) { return fromFixed(vect, len); }
 
 #endif// COORDINATE_HPP
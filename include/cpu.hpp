@@ -0,0 +1,35 @@
+#ifndef CPU_HPP
+#define CPU_HPP
+
+#include "simulation.hpp"
+#include <string>
+
+// Vector instruction sets for which the vectorized kernels are compiled, from the oldest to the newest.
+// The all-pairs sweep and the replica batches are compiled without contracting to FMA, so that every level gives the
+// same trajectories. The neighbour searches may contract at AVX-512 and differ in the last bits.
+enum class SimdLevel {
+  Generic,// Whatever the compiler targets by default, SSE2 on x86-64
+  SSE42,
+  AVX2,
+  AVX512,// AVX-512F
+};
+
+// Newest level supported by the processor, detected on the first call
+SimdLevel getSupportedSimdLevel();
+
+// Level of the kernels in use, which is the supported one unless forced by setSimdLevel()
+SimdLevel getSimdLevel();
+
+// Force the kernels of a level, for benchmarking. Returns EXIT_FAILURE if the processor does not support it.
+int setSimdLevel(SimdLevel level);
+
+// Read "generic", "sse4.2", "avx2" or "avx512". Returns EXIT_FAILURE for any other name.
+int parseSimdLevel(const std::string &name, SimdLevel &level);
+
+std::string toString(SimdLevel level);
+
+// Pin each OpenMP thread to one of the processors the process may run on, which keeps the pages it touched first on
+// its NUMA node. Call before the parallel first touch. Returns EXIT_FAILURE if the threads could not be pinned.
+int pinThreads(ThreadAffinity affinity);
+
+#endif// CPU_HPP
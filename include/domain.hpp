@@ -0,0 +1,90 @@
+#ifndef DOMAIN_HPP
+#define DOMAIN_HPP
+
+#include "fish.hpp"
+#include <cstddef>
+#include <mpi.h>
+#include <span>
+#include <vector>
+
+// Periodic box split along x into one slab per MPI rank, each rank owning the fish in its slab.
+// The slabs are moved by rebalance() so that the ranks own about as many fish each.
+class SlabDecomposition
+{
+private:
+  static constexpr unsigned int bins_per_unit = 32;// Resolution of the histogram the slabs are balanced on
+
+  MPI_Comm m_comm;
+  MPI_Datatype m_fish_type{};
+  int m_rank = 0;
+  int m_size = 1;
+  unsigned int m_length;
+  double m_halo_width;
+  std::vector<double> m_bounds;// Slab r is [m_bounds[r], m_bounds[r + 1])
+
+  // Buffers of the exchanges, kept to avoid reallocating them every step
+  std::vector<Fish> m_send;
+  std::vector<Fish> m_receive;
+  std::vector<std::vector<Fish>> m_leaving;// Fish leaving the slab, by the rank they go to
+  std::vector<int> m_send_counts;
+  std::vector<int> m_send_displacements;
+  std::vector<int> m_receive_counts;
+  std::vector<int> m_receive_displacements;
+
+  // Distance along x from a position outside of slab r to the slab, across the periodic boundary if shorter
+  [[nodiscard]] double distanceToSlab(double x, int rank) const;
+
+  // Send m_send, sorted by the rank it goes to with m_send_counts fish each, and store what arrives in m_receive
+  void exchange();
+
+public:
+  // Slabs of equal width. The halo is as wide as the largest interaction radius.
+  SlabDecomposition(MPI_Comm comm, unsigned int length, double halo_width);
+  SlabDecomposition(const SlabDecomposition &) = delete;
+  SlabDecomposition &operator=(const SlabDecomposition &) = delete;
+  SlabDecomposition(SlabDecomposition &&) = delete;
+  SlabDecomposition &operator=(SlabDecomposition &&) = delete;
+  ~SlabDecomposition();
+
+  [[nodiscard]] inline int getRank() const { return m_rank; }
+  [[nodiscard]] inline int getSize() const { return m_size; }
+  [[nodiscard]] inline double getLower() const { return m_bounds[static_cast<std::size_t>(m_rank)]; }
+  [[nodiscard]] inline double getUpper() const { return m_bounds[static_cast<std::size_t>(m_rank) + 1]; }
+
+  // Rank whose slab contains the coordinate x, which must lie in the box
+  [[nodiscard]] int getOwner(double x) const;
+
+  // Send the fish that left the slab to the ranks that own them now, and append the fish that entered it
+  void migrate(School &fish);
+
+  // Append copies of the fish of the other ranks within the halo width of the slab, after the fish of the rank.
+  // Returns the number of fish of the rank, at which the halo starts.
+  std::size_t appendHalo(School &fish);
+
+  // Most fish owned by one rank divided by the mean over the ranks
+  [[nodiscard]] double getImbalance(const School &fish) const;
+
+  // Move the slabs so that each holds about the same number of fish, and migrate the fish to their new owners
+  void rebalance(School &fish);
+
+  // Call visit(fish) on rank 0 with the fish of every rank in turn, its own first. Every rank must call it.
+  template<typename Visit> void visitOnRoot(const School &fish, Visit &&visit)
+  {
+    if (m_rank != 0) {
+      MPI_Send(fish.data(), static_cast<int>(fish.size()), m_fish_type, 0, 0, m_comm);
+      return;
+    }
+    visit(std::span<const Fish>(fish.data(), fish.size()));
+    for (int rank = 1; rank < m_size; rank++) {
+      MPI_Status status{};
+      int n_fish = 0;
+      MPI_Probe(rank, 0, m_comm, &status);
+      MPI_Get_count(&status, m_fish_type, &n_fish);
+      m_receive.resize(static_cast<std::size_t>(n_fish));
+      MPI_Recv(m_receive.data(), n_fish, m_fish_type, rank, 0, m_comm, MPI_STATUS_IGNORE);
+      visit(std::span<const Fish>(m_receive.data(), m_receive.size()));
+    }
+  }
+};
+
+#endif// DOMAIN_HPP
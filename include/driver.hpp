@@ -0,0 +1,108 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include "analysis.hpp"
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "grid.hpp"
+#include "kdtree.hpp"
+#include "simulation.hpp"
+#include <functional>
+#include <ostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Runs of the stencils scanned in the cell lists. They only depend on the radii, the cell grid and, for the two-level
+// grid, the length, so that the simulations sharing those may share them.
+struct Stencils
+{
+  std::vector<StencilRun> repulsion_runs;
+  std::vector<StencilRun> attractive_runs;
+  unsigned int reach = 0;// Of the unit grid
+  unsigned int fine_side = 0;// Cells per side of the two-level grid, 0 for the unit grid
+  unsigned int coarse_side = 0;
+};
+
+// Empty unless the neighbours are searched for in cell lists
+Stencils makeStencils(const SimParam &sim_param, const FishParam &fish_param);
+
+// Fish at random distances from the centre of the box, swimming along x
+School makeSphere(const SimParam &sim_param, const FishParam &fish_param, std::mt19937 &gen);
+
+// A school advanced step by step, owning the cell lists or the tree in which the neighbours are searched for.
+// Once the buffers of the neighbour search have grown to the fullest cells seen, step() allocates nothing, so that the
+// simulation may be driven from a pipeline without going through files. The fish are stored as F, which simulate()
+// picks from sim_param.precision. Instantiated for Fish, FishF, MixedFish and FixedFish.
+template<typename F> class BasicSimulation
+{
+public:
+  // Called with the simulation after the steps at which it was asked to be called
+  using Observer = std::function<void(const BasicSimulation &)>;
+
+private:
+  // Free slots per cell kept by the cell lists when they are rebuilt only every few steps. update() rebuilds them in
+  // full whenever more fish enter a cell than it has free slots. With the school of config.yaml and a rebuild interval
+  // of 10, 2 slots fell back to a full rebuild in 10 to 17% of the updates for 3000 to 10000 fish, and 4 in about 1%.
+  // More slots mostly pad the many empty cells of the box.
+  static constexpr unsigned int rebuild_slack = 4;
+
+  SimParam m_sim_param;
+  FishParam m_fish_param;
+  BasicSchool<F> m_fish;
+  Stencils m_stencils;
+  std::vector<BasicCellList<F>> m_grids;// Repulsion and attraction lists of the two-level grid, or the unit grid alone
+  BasicKdTree<F> m_tree;
+  unsigned int m_slack;// Free slots per cell for the fish entering it in between the rebuilds
+  unsigned int m_step = 0;// Steps taken so far
+  bool m_restored = false;// The lists are rebuilt at the next step whatever the interval
+  std::vector<std::pair<unsigned int, Observer>> m_observers;// Interval in steps and observer
+
+public:
+  // The stencils must have been made for the parameters
+  BasicSimulation(const SimParam &sim_param, const FishParam &fish_param, BasicSchool<F> fish, Stencils stencils);
+  BasicSimulation(const SimParam &sim_param, const FishParam &fish_param, BasicSchool<F> fish);
+
+  // The lists and the tree point into the school, which a copy would not own
+  BasicSimulation(const BasicSimulation &) = delete;
+  BasicSimulation &operator=(const BasicSimulation &) = delete;
+  BasicSimulation(BasicSimulation &&) = default;
+  BasicSimulation &operator=(BasicSimulation &&) = default;
+  ~BasicSimulation() = default;
+
+  [[nodiscard]] inline const SimParam &getSimParam() const { return m_sim_param; }
+  [[nodiscard]] inline const FishParam &getFishParam() const { return m_fish_param; }
+  [[nodiscard]] inline const BasicSchool<F> &getSchool() const { return m_fish; }
+  [[nodiscard]] inline unsigned int getStep() const { return m_step; }
+  [[nodiscard]] inline double getTime() const { return m_step * m_sim_param.delta_t; }
+
+  // Set the state of every fish and the step count, e.g. from a checkpoint. The school must have as many fish, which
+  // are copied in place so that their addresses do not change.
+  void restore(const BasicSchool<F> &fish, unsigned int step);
+
+  // Call the observer after the steps 0, interval, 2 * interval and so on, counted from 0 like the snapshots
+  void addObserver(unsigned int interval, Observer observer);
+
+  // Take n time steps
+  void step(unsigned int n = 1);
+
+  // Output the snapshot of the output mode, by default the fish positions and velocities, one fish per line
+  void writeSnapshot(std::ostream &output) const;
+};
+
+using Simulation = BasicSimulation<Fish>;
+
+// Run the simulation of the school, writing the snapshots every snapshot_interval steps, by default the positions and
+// velocities, one fish per line. The stencils must have been made for the parameters. Prints the time steps if
+// verbose. Unless observables_interval is 0, the school is analysed every observables_interval steps into the streams
+// of analysis. The fish are stored in sim_param.precision, and the school is left with their final positions and
+// velocities.
+void simulate(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const Stencils &stencils,
+  std::ostream &output,
+  bool verbose,
+  const AnalysisOutput &analysis = {});
+
+#endif// DRIVER_HPP
@@ -0,0 +1,59 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include "driver.hpp"
+#include "simulation.hpp"
+#include <cstddef>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+// One simulation of an ensemble
+struct Replica
+{
+  SimParam sim_param;
+  FishParam fish_param;
+  unsigned int seed;// Of the initial school
+  std::string label;// Configuration and swept values the replica was made from
+};
+
+struct Ensemble
+{
+  std::vector<Replica> replicas;
+  std::string output = "replica";// Optional, replica i writes <output>_<i>.txt
+  unsigned int parallel_below = 20000;// Optional, smaller replicas run side by side, one per thread
+  bool batch_replicas = true;// Optional, small all-pairs replicas of the same size run as lanes of a ReplicaBatch
+};
+
+// Read an ensemble file, whose keys are
+//   configs: configuration files, or configurations written out in the file
+//   sweep: optional, maps "simulation-params.<key>" or "fish-params.<key>" to a list of values. Every configuration
+//          is run with every combination of the values.
+//   seeds: optional, number of replicas of every combination, each starting from another school (default 1)
+//   seed: optional, seed of the first replica, the others counting up from it (default random)
+//   output, parallel-below, batch-replicas: see Ensemble
+int operator>>(const YAML::Node &node, Ensemble &ensemble);
+
+// Stencils of the replicas, made once for every set of radii
+class StencilCache
+{
+private:
+  // Whether cell lists are searched, the cell grid, the radii and, for the two-level grid, the length
+  using Key = std::tuple<bool, CellGrid, double, double, unsigned int>;
+  std::map<Key, Stencils> m_stencils;
+
+public:
+  const Stencils &get(const SimParam &sim_param, const FishParam &fish_param);
+  [[nodiscard]] inline std::size_t size() const { return m_stencils.size(); }
+};
+
+// Run the replicas, writing the snapshots of replica i to <output>_<i>.txt and listing the replicas in
+// <output>_index.txt. The small replicas run side by side, one per thread, which keeps the threads busy when each of
+// them would have too few fish to share out. The small replicas searching all pairs in double with the same box, number
+// of fish and steps are batched, up to ReplicaBatch::lanes at a time. The large ones run one after another, each on all
+// threads.
+void runEnsemble(const Ensemble &ensemble, StencilCache &cache);
+
+#endif// ENSEMBLE_HPP
@@ -2,13 +2,18 @@
 #define EOM_CPP
 
 #include "fish.hpp"
+#include "grid.hpp"
+#include "kdtree.hpp"
 #include <cassert>
+#include <cstddef>
 #include <tuple>
 #include <vector>
 
 double g(double distance, double body_length);
 
-Vect3 calcSelfPropulsion(const Fish &fish, const FishParam &fish_param);
+// The kernels templated on the fish are instantiated for Fish, FishF, MixedFish and FixedFish, and sum the interactions
+// in FishSum<F>. The displacements are taken between the positions the fish are stored in, see FishTraits.
+template<typename F> SumVect3<F> calcSelfPropulsion(const F &fish, const FishParam &fish_param);
 
 std::tuple<Vect3, unsigned int> calcRepulsion(const Fish &fish,
   const SimParam &sim_param,
@@ -24,4 +29,89 @@ std::tuple<Vect3, unsigned int> calcAttraction(const Fish &fish,
   const std::vector<std::array<int, 3>> &attractive_boundary,
   const std::vector<std::array<int, 3>> &attractive_inner);
 
+// Repulsion from the n_cog nearest fish within the repulsion radius, scanning the fish in the runs of the stencil
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcRepulsion(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &cells,
+  const std::vector<StencilRun> &repulsion_runs);
+
+// Attraction from the fish between the repulsion and attraction radii, scanning the fish in the runs of the stencil
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcAttraction(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &cells,
+  const std::vector<StencilRun> &attractive_runs);
+
+// Same as above, but approximates the cells that lie entirely between the repulsion and attraction radii and whose
+// diagonal is seen from the fish under less than the opening angle (in radians) by the count and centroid of their
+// fish. The centroids must be up to date, see BasicCellList::computeCentroids().
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcAttraction(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &cells,
+  const std::vector<StencilRun> &attractive_runs,
+  double opening_angle);
+
+// Repulsion from the n_cog nearest fish within the repulsion radius, found by a nearest neighbour query of the tree
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcRepulsion(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree);
+
+// Attraction from the fish between the repulsion and attraction radii, found by a radius query of the tree
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcAttraction(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree);
+
+// Store the change of velocity of every fish, each fish scanning the runs of the stencils around it.
+// The repulsion and attraction may be searched for in different cell lists, or in the same one.
+// The attraction is approximated if sim_param.attraction_opening_angle is positive.
+template<typename F>
+void calcDeltaVelocities(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<F> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+
+// Same as above, but iterates over the cells and scans the runs once for all the fish in the cell.
+// Each fish in a run is then interacted with the whole tile of fish in the home cell while it is in cache.
+template<typename F>
+void calcDeltaVelocitiesTiled(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<F> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+
+// Same as above, but searches the neighbours in a k-d tree instead of cell lists
+template<typename F>
+void calcDeltaVelocities(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree);
+
+// Same as above, but only for the first n_updated fish, the others being searched for as neighbours only
+template<typename F>
+void calcDeltaVelocities(BasicSchool<F> &fish,
+  std::size_t n_updated,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree);
+
+// Same as above, but checks every pair of fish, with the minimum image displacement as in vect12().
+// Needs no neighbour search, so it is the fastest for the smallest schools and serves as the reference for the others.
+// FishF and MixedFish compute the displacements in float.
+template<typename F>
+void calcDeltaVelocitiesAllPairs(BasicSchool<F> &fish, const SimParam &sim_param, const FishParam &fish_param);
+
 #endif// EOM_CPP
@@ -2,35 +2,151 @@
 #define FISH_HPP
 
 #include "coordinate.hpp"
+#include "memory.hpp"
 #include "simulation.hpp"
+#include <array>
 #include <cmath>
+#include <vector>
 
-class Fish
+// Fish whose state is stored in the scalar T, instantiated for double and float in fish.cpp
+template<typename T> class BasicFish
 {
 private:
-  Vect3 m_position;
-  Vect3 m_velocity;
+  BasicVect3<T> m_position;
+  BasicVect3<T> m_velocity;
+  BasicVect3<T> m_delta_velocity;
+  T m_lambda;
+
+public:
+  BasicFish();
+  BasicFish(BasicVect3<T> position, BasicVect3<T> velocity, BasicVect3<T> delta_velocity, T lambda);
+  template<typename U>
+  explicit BasicFish(const BasicFish<U> &other)
+    : m_position(castVect3<T>(other.getPosition())), m_velocity(castVect3<T>(other.getVelocity())),
+      m_delta_velocity(castVect3<T>(other.getDeltaVelocity())), m_lambda(static_cast<T>(other.getLambda()))
+  {}
+  ~BasicFish() = default;
+  void update(T delta_t, unsigned int len, T dldt);
+  void update(SimParam sim_param, FishParam fish_param);
+  void setLambda(T lambda);
+  void setPosition(T x, T y, T z);
+  void setPosition(BasicVect3<T> position);
+  void setVelocity(T vx, T vy, T vz);
+  void setVelocity(BasicVect3<T> velocity);
+  void setDeltaVelocity(T delta_vx, T delta_vy, T delta_vz);
+  void setDeltaVelocity(BasicVect3<T> delta_velocity);
+  [[nodiscard]] inline BasicVect3<T> getPosition() const { return m_position; }
+  [[nodiscard]] inline BasicVect3<T> getVelocity() const { return m_velocity; }
+  [[nodiscard]] inline BasicVect3<T> getDeltaVelocity() const { return m_delta_velocity; }
+  [[nodiscard]] inline T getLambda() const { return m_lambda; }
+  [[nodiscard]] T speed() const;
+
+  // First components of the vectors within the fish, through which the C interface views the school in place
+  [[nodiscard]] inline const T *getPositionData() const { return &m_position.x; }
+  [[nodiscard]] inline const T *getVelocityData() const { return &m_velocity.x; }
+};
+
+using Fish = BasicFish<double>;
+using FishF = BasicFish<float>;
+
+// Fish whose position is stored as the unit cell it is in and the float offset from the corner of that cell,
+// so that the resolution of the position does not depend on the length of the box.
+// The velocity is stored in float, while the delta velocity, which sums the interactions, stays double.
+class MixedFish
+{
+private:
+  std::array<int, 3> m_cell;
+  Vect3f m_offset;
+  Vect3f m_velocity;
   Vect3 m_delta_velocity;
   double m_lambda;
 
 public:
-  Fish();
-  Fish(Vect3 position, Vect3 velocity, Vect3 delta_velocity, double lambda);
-  ~Fish() = default;
+  MixedFish();
+  explicit MixedFish(const Fish &other);
+  ~MixedFish() = default;
   void update(double delta_t, unsigned int len, double dldt);
   void update(SimParam sim_param, FishParam fish_param);
   void setLambda(double lambda);
-  void setPosition(double x, double y, double z);
   void setPosition(Vect3 position);
-  void setVelocity(double vx, double vy, double vz);
   void setVelocity(Vect3 velocity);
-  void setDeltaVelocity(double delta_vx, double delta_vy, double delta_vz);
   void setDeltaVelocity(Vect3 delta_velocity);
-  [[nodiscard]] inline Vect3 getPosition() const { return m_position; }
+  [[nodiscard]] inline const std::array<int, 3> &getCell() const { return m_cell; }
+  [[nodiscard]] inline Vect3f getOffset() const { return m_offset; }
+  [[nodiscard]] inline MixedPosition getMixedPosition() const { return { .cell = m_cell, .offset = m_offset }; }
+  [[nodiscard]] inline Vect3 getPosition() const
+  {
+    return { .x = m_cell[0] + static_cast<double>(m_offset.x),
+      .y = m_cell[1] + static_cast<double>(m_offset.y),
+      .z = m_cell[2] + static_cast<double>(m_offset.z) };
+  }
+  [[nodiscard]] inline Vect3f getVelocity() const { return m_velocity; }
+  [[nodiscard]] inline Vect3 getDeltaVelocity() const { return m_delta_velocity; }
+  [[nodiscard]] inline double getLambda() const { return m_lambda; }
+  [[nodiscard]] double speed() const;
+};
+
+// Fish whose position is stored in fixed point, see toFixed(), so that the periodic boundary costs nothing.
+// The box length converts the position at the boundaries of the simulation. The velocities stay double.
+class FixedFish
+{
+private:
+  FixedVect3 m_position;
+  Vect3 m_velocity;
+  Vect3 m_delta_velocity;
+  double m_lambda;
+
+public:
+  FixedFish();
+  FixedFish(const Fish &other, unsigned int len);
+  ~FixedFish() = default;
+  void update(double delta_t, unsigned int len, double dldt);
+  void update(SimParam sim_param, FishParam fish_param);
+  void setLambda(double lambda);
+  void setPosition(Vect3 position, unsigned int len);
+  void setVelocity(Vect3 velocity);
+  void setDeltaVelocity(Vect3 delta_velocity);
+  [[nodiscard]] inline const FixedVect3 &getFixedPosition() const { return m_position; }
+  [[nodiscard]] inline Vect3 getPosition(unsigned int len) const { return fromFixed(m_position, len); }
   [[nodiscard]] inline Vect3 getVelocity() const { return m_velocity; }
   [[nodiscard]] inline Vect3 getDeltaVelocity() const { return m_delta_velocity; }
   [[nodiscard]] inline double getLambda() const { return m_lambda; }
   [[nodiscard]] double speed() const;
 };
 
+// Position by which each kind of fish is searched for, the scalar of the displacements between those positions, and the
+// scalar in which its interactions are summed, see the kernels in eom.cpp
+template<typename F> struct FishTraits;
+
+template<typename T> struct FishTraits<BasicFish<T>>
+{
+  using Position = BasicVect3<T>;
+  using Scalar = T;
+  using Sum = T;
+  [[nodiscard]] static inline Position getPosition(const BasicFish<T> &fish) { return fish.getPosition(); }
+};
+
+template<> struct FishTraits<MixedFish>
+{
+  using Position = MixedPosition;
+  using Scalar = float;
+  using Sum = double;
+  [[nodiscard]] static inline Position getPosition(const MixedFish &fish) { return fish.getMixedPosition(); }
+};
+
+template<> struct FishTraits<FixedFish>
+{
+  using Position = FixedVect3;
+  using Scalar = double;
+  using Sum = double;
+  [[nodiscard]] static inline const Position &getPosition(const FixedFish &fish) { return fish.getFixedPosition(); }
+};
+
+template<typename F> using FishSum = typename FishTraits<F>::Sum;
+template<typename F> using SumVect3 = BasicVect3<FishSum<F>>;
+
+// The fish of a simulation, each on the NUMA node of the thread that handles it in the loops over the fish
+template<typename F> using BasicSchool = std::vector<F, FirstTouchAllocator<F>>;
+using School = BasicSchool<Fish>;
+
 #endif// FISH_HPP
@@ -0,0 +1,60 @@
+#ifndef FISHSCHOOL_H
+#define FISHSCHOOL_H
+
+// C interface of libfishschool, for the tools written in other languages. The functions returning an int return 0 on
+// success. The errors are reported on the standard error, as by fish_schooling.
+
+#include <stddef.h>
+
+#if defined(FISHSCHOOL_BUILD)
+#define FISHSCHOOL_API __attribute__((visibility("default")))
+#else
+#define FISHSCHOOL_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FISHSCHOOL_CHECKPOINT_VERSION 1
+
+// A simulation of one school, see Simulation in driver.hpp
+typedef struct fishschool fishschool;
+
+// Vector of every fish stored in the simulation itself: component c (x, y, z) of fish i is at data[i * stride + c].
+// The data stays where it is for the life of the simulation, and is updated in place by each step.
+typedef struct fishschool_view
+{
+  const double *data;
+  size_t n_fish;
+  size_t stride;// In doubles
+} fishschool_view;
+
+// Simulation of the parameters of a configuration written as in config.yaml, with the fish in a sphere drawn from the
+// seed. NULL if the configuration is invalid or asks for a precision other than double.
+FISHSCHOOL_API fishschool *fishschool_create(const char *config, unsigned int seed);
+FISHSCHOOL_API void fishschool_destroy(fishschool *simulation);
+
+// Take n time steps
+FISHSCHOOL_API int fishschool_step(fishschool *simulation, unsigned int n);
+
+FISHSCHOOL_API size_t fishschool_fish_count(const fishschool *simulation);
+FISHSCHOOL_API unsigned int fishschool_step_count(const fishschool *simulation);
+FISHSCHOOL_API double fishschool_time(const fishschool *simulation);
+FISHSCHOOL_API unsigned int fishschool_length(const fishschool *simulation);
+
+FISHSCHOOL_API fishschool_view fishschool_positions(const fishschool *simulation);
+FISHSCHOOL_API fishschool_view fishschool_velocities(const fishschool *simulation);
+
+// Checkpoint of the step count and of the state of every fish, in a buffer of fishschool_checkpoint_size() bytes.
+// Restoring it into a simulation of as many fish resumes the run, exactly unless the cell lists are updated in between
+// rebuilds. The views stay valid.
+FISHSCHOOL_API size_t fishschool_checkpoint_size(const fishschool *simulation);
+FISHSCHOOL_API int fishschool_checkpoint(const fishschool *simulation, void *buffer, size_t size);
+FISHSCHOOL_API int fishschool_restore(fishschool *simulation, const void *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif// FISHSCHOOL_H
@@ -0,0 +1,271 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "memory.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+
+// Contiguous range [begin, end) of cells or fish in a BasicCellList
+struct IndexRange
+{
+  unsigned int begin;
+  unsigned int end;
+};
+
+// Fish that left one cell of a BasicCellList for another
+struct CellMove
+{
+  unsigned int fish_index;// Index of the fish in the original order
+  unsigned int from;
+  unsigned int to;
+};
+
+// Fish sorted by the cubic cell they are in, with z being the fastest varying cell index.
+// The cells along z are therefore stored back to back, so that a StencilRun maps to one contiguous range of fish.
+// When built with slack, each cell keeps free slots after its fish, so that update() can move the fish that changed
+// cells without sorting all of them again. The runs are then visited cell by cell to skip the free slots.
+// The fish are binned by their own position type, see FishTraits.
+// Instantiated for Fish, FishF, MixedFish and FixedFish.
+template<typename F> class BasicCellList
+{
+private:
+  static constexpr unsigned int bits_per_word = 64;
+  static constexpr unsigned int fixed_bits = 32;// Bits of a fixed-point coordinate, see toFixed()
+  static constexpr std::size_t move_batch_size = 64;// Moves a thread collects before appending them to m_moves
+
+  // Arrays swept by the threads in schedule(static) loops, spread over their NUMA nodes
+  template<typename T> using FirstTouchVector = std::vector<T, FirstTouchAllocator<T>>;
+
+public:
+  using Position = typename FishTraits<F>::Position;
+
+private:
+  unsigned int m_length;
+  unsigned int m_cells_per_side;
+  double m_cell_size;
+  double m_inverse_cell_size;
+  std::vector<unsigned int> m_wrap_table;// Periodic images of the cell coordinates within the reach
+  unsigned int m_slack = 0;// Free slots reserved in each cell by the last build
+  std::vector<unsigned int> m_cell_start;// Index of the first slot of each cell, followed by the number of slots
+  std::vector<unsigned int> m_cell_count;// Number of fish in each cell
+  std::vector<unsigned int> m_plane_count;// Number of fish in each yz plane of cells
+  std::vector<std::uint64_t> m_occupied;// One bit per cell, set if the cell holds any fish
+  FirstTouchVector<unsigned int> m_fish_cell;// Cell index of each fish, in the original order
+  std::vector<unsigned int> m_cursor;// Insertion point of each cell while building
+  std::vector<CellMove> m_moves;// Fish that changed cells since the last build or update
+  FirstTouchVector<const F *> m_fish;// Fish sorted by cell
+  FirstTouchVector<unsigned int> m_fish_index;// Index of the sorted fish in the original order
+  FirstTouchVector<Position> m_position;// Positions of the sorted fish
+  FirstTouchVector<Vect3> m_centroid;// Mean position of the fish in each cell, see computeCentroids()
+
+  void clear(std::size_t n_fish);
+  void bin(std::size_t index, const Position &position);
+  void scatter(const BasicSchool<F> &fish, unsigned int slack);
+
+public:
+  // The reach is the largest stencil offset (see getStencilReach) that will be used with this list
+  BasicCellList(unsigned int length, unsigned int reach);
+  // Same as above, but divides the box into cells_per_side^3 cells of the length / cells_per_side
+  BasicCellList(unsigned int length, unsigned int cells_per_side, unsigned int reach);
+  void build(const BasicSchool<F> &fish, unsigned int slack = 0);
+  // Same as build() on both lists, but bins each fish into both of them in one pass over the fish
+  static void build(const BasicSchool<F> &fish, BasicCellList &first, BasicCellList &second, unsigned int slack = 0);
+  // Refresh the positions after the fish moved and move the fish that changed cells into the free slots.
+  // Falls back to build() with the same slack when a cell runs out of free slots.
+  void update(const BasicSchool<F> &fish);
+  // Store the mean position of the fish in each occupied cell, after the list was built or updated
+  void computeCentroids();
+
+  [[nodiscard]] inline unsigned int getCellsPerSide() const { return m_cells_per_side; }
+  [[nodiscard]] inline double getCellSize() const { return m_cell_size; }
+  [[nodiscard]] inline unsigned int getReach() const
+  {
+    return static_cast<unsigned int>(m_wrap_table.size() - m_cells_per_side) / 2;
+  }
+  [[nodiscard]] inline unsigned int size() const { return static_cast<unsigned int>(m_fish_cell.size()); }
+  [[nodiscard]] inline const F *getFish(unsigned int index) const { return m_fish[index]; }
+  [[nodiscard]] inline unsigned int getFishIndex(unsigned int index) const { return m_fish_index[index]; }
+  [[nodiscard]] inline const Position &getPosition(unsigned int index) const { return m_position[index]; }
+
+  [[nodiscard]] inline std::array<unsigned int, 3> getCell(const Position &position) const
+  {
+    // The cell of a fixed-point coordinate is in its top bits, which are always within the box
+    if constexpr (std::is_same_v<Position, FixedVect3>) {
+      return { static_cast<unsigned int>((std::uint64_t{ position.x } * m_cells_per_side) >> fixed_bits),
+        static_cast<unsigned int>((std::uint64_t{ position.y } * m_cells_per_side) >> fixed_bits),
+        static_cast<unsigned int>((std::uint64_t{ position.z } * m_cells_per_side) >> fixed_bits) };
+    } else {
+      // Clamp, as the periodic boundary conditions may round a position up to exactly the length
+      const Vect3 vect = toVect3(position, m_length);
+      return { std::min(static_cast<unsigned int>(vect.x * m_inverse_cell_size), m_cells_per_side - 1),
+        std::min(static_cast<unsigned int>(vect.y * m_inverse_cell_size), m_cells_per_side - 1),
+        std::min(static_cast<unsigned int>(vect.z * m_inverse_cell_size), m_cells_per_side - 1) };
+    }
+  }
+
+  [[nodiscard]] inline unsigned int cellIndex(unsigned int x, unsigned int y, unsigned int z) const
+  {
+    return (x * m_cells_per_side + y) * m_cells_per_side + z;
+  }
+
+  [[nodiscard]] inline Vect3 getCellCentre(unsigned int cell_index) const
+  {
+    const unsigned int z = cell_index % m_cells_per_side;
+    const unsigned int y = cell_index / m_cells_per_side % m_cells_per_side;
+    const unsigned int x = cell_index / m_cells_per_side / m_cells_per_side;
+    return { .x = (x + 0.5) * m_cell_size, .y = (y + 0.5) * m_cell_size, .z = (z + 0.5) * m_cell_size };
+  }
+
+  [[nodiscard]] inline const Vect3 &getCentroid(unsigned int cell_index) const { return m_centroid[cell_index]; }
+
+  [[nodiscard]] inline unsigned int getCellCount(unsigned int cell_index) const { return m_cell_count[cell_index]; }
+
+  [[nodiscard]] inline IndexRange getCellRange(unsigned int cell_index) const
+  {
+    return { .begin = m_cell_start[cell_index], .end = m_cell_start[cell_index] + m_cell_count[cell_index] };
+  }
+
+  // Periodic image of the cell coordinate, which may lie up to the reach outside of the box
+  [[nodiscard]] inline unsigned int wrap(int coordinate) const
+  {
+    return m_wrap_table[static_cast<unsigned int>(coordinate + static_cast<int>(getReach()))];
+  }
+
+  // Ranges of cells covered by the run around the cell.
+  // The second range is empty unless the run wraps around the box along z.
+  [[nodiscard]] inline std::array<IndexRange, 2> getRunCells(const std::array<unsigned int, 3> &cell,
+    const StencilRun &run) const
+  {
+    assert(std::max({ std::abs(run.dx), std::abs(run.dy), std::abs(run.z_begin), std::abs(run.z_end) })
+           <= static_cast<int>(getReach()));
+
+    const unsigned int x = wrap(static_cast<int>(cell[0]) + run.dx);
+    const unsigned int y = wrap(static_cast<int>(cell[1]) + run.dy);
+    const unsigned int row = cellIndex(x, y, 0);
+
+    // A run covering the whole box visits each cell once
+    if (run.z_end - run.z_begin + 1 >= static_cast<int>(m_cells_per_side)) {
+      return { { { .begin = row, .end = row + m_cells_per_side }, { .begin = 0, .end = 0 } } };
+    }
+
+    const unsigned int z_begin = wrap(static_cast<int>(cell[2]) + run.z_begin);
+    const unsigned int z_end = wrap(static_cast<int>(cell[2]) + run.z_end);
+    if (z_begin <= z_end) {
+      return { { { .begin = row + z_begin, .end = row + z_end + 1 }, { .begin = 0, .end = 0 } } };
+    }
+    return { { { .begin = row + z_begin, .end = row + m_cells_per_side }, { .begin = row, .end = row + z_end + 1 } } };
+  }
+
+  // Whether any of the cells in the range holds a fish
+  [[nodiscard]] inline bool isOccupied(const IndexRange &cell_range) const
+  {
+    if (cell_range.begin >= cell_range.end) { return false; }
+
+    const unsigned int first_word = cell_range.begin / bits_per_word;
+    const unsigned int last_word = (cell_range.end - 1) / bits_per_word;
+    const std::uint64_t first_mask = ~std::uint64_t{ 0 } << (cell_range.begin % bits_per_word);
+    const std::uint64_t last_mask = ~std::uint64_t{ 0 } >> (bits_per_word - 1 - (cell_range.end - 1) % bits_per_word);
+
+    if (first_word == last_word) { return (m_occupied[first_word] & first_mask & last_mask) != 0; }
+    if ((m_occupied[first_word] & first_mask) != 0) { return true; }
+    for (unsigned int word = first_word + 1; word < last_word; word++) {
+      if (m_occupied[word] != 0) { return true; }
+    }
+    return (m_occupied[last_word] & last_mask) != 0;
+  }
+
+  // Number of fish in the yz plane of cells at x
+  [[nodiscard]] inline unsigned int getPlaneCount(unsigned int x) const { return m_plane_count[x]; }
+
+  // Call visit(run_cells) for every range of cells in the runs around the cell that holds any fish.
+  // Runs with the same dx share a plane of cells, so empty planes are skipped as a whole,
+  // and the occupancy bitmap skips the empty runs without touching the fish.
+  template<typename Visit>
+  inline void forEachOccupiedRun(const std::array<unsigned int, 3> &cell,
+    const std::vector<StencilRun> &runs,
+    Visit &&visit) const
+  {
+    bool plane_occupied = false;
+    for (std::size_t i = 0; i < runs.size(); i++) {
+      if (i == 0 || runs[i].dx != runs[i - 1].dx) {
+        plane_occupied = getPlaneCount(wrap(static_cast<int>(cell[0]) + runs[i].dx)) != 0;
+      }
+      if (!plane_occupied) { continue; }
+
+      for (const auto &run_cells : getRunCells(cell, runs[i])) {
+        if (isOccupied(run_cells)) { visit(run_cells); }
+      }
+    }
+  }
+
+  // Call visit(cell_index) for every occupied cell in the range, found from the set bits of the bitmap
+  template<typename Visit>
+  inline void forEachOccupiedCell(const IndexRange &cell_range, Visit &&visit) const
+  {
+    if (cell_range.begin >= cell_range.end) { return; }
+
+    const unsigned int first_word = cell_range.begin / bits_per_word;
+    const unsigned int last_word = (cell_range.end - 1) / bits_per_word;
+    for (unsigned int word = first_word; word <= last_word; word++) {
+      std::uint64_t bits = m_occupied[word];
+      if (word == first_word) { bits &= ~std::uint64_t{ 0 } << (cell_range.begin % bits_per_word); }
+      if (word == last_word) {
+        bits &= ~std::uint64_t{ 0 } >> (bits_per_word - 1 - (cell_range.end - 1) % bits_per_word);
+      }
+      while (bits != 0) {
+        visit(word * bits_per_word + static_cast<unsigned int>(std::countr_zero(bits)));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  // Call visit(range) for every non-empty range of fish in the runs around the cell, see forEachOccupiedRun().
+  // With slack, the free slots split the runs, so each occupied cell is visited on its own.
+  template<typename Visit>
+  inline void forEachRangeInRuns(const std::array<unsigned int, 3> &cell,
+    const std::vector<StencilRun> &runs,
+    Visit &&visit) const
+  {
+    forEachOccupiedRun(cell, runs, [&](const IndexRange &run_cells) {
+      if (m_slack == 0) {
+        visit(IndexRange{ .begin = m_cell_start[run_cells.begin], .end = m_cell_start[run_cells.end] });
+        return;
+      }
+      forEachOccupiedCell(run_cells, [&](unsigned int cell_index) { visit(getCellRange(cell_index)); });
+    });
+  }
+
+  // Call visit(cell_index) for every occupied cell in the runs around the cell, see forEachOccupiedRun()
+  template<typename Visit>
+  inline void forEachCellInRuns(const std::array<unsigned int, 3> &cell,
+    const std::vector<StencilRun> &runs,
+    Visit &&visit) const
+  {
+    forEachOccupiedRun(
+      cell, runs, [&](const IndexRange &run_cells) { forEachOccupiedCell(run_cells, visit); });
+  }
+
+  // Call visit(index) for every fish in the runs around the cell, see forEachRangeInRuns()
+  template<typename Visit>
+  inline void forEachInRuns(const std::array<unsigned int, 3> &cell,
+    const std::vector<StencilRun> &runs,
+    Visit &&visit) const
+  {
+    forEachRangeInRuns(cell, runs, [&visit](const IndexRange &range) {
+      for (unsigned int index = range.begin; index < range.end; index++) { visit(index); }
+    });
+  }
+};
+
+using CellList = BasicCellList<Fish>;
+
+#endif// GRID_HPP
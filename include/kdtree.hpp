@@ -0,0 +1,120 @@
+#ifndef KDTREE_HPP
+#define KDTREE_HPP
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Balanced k-d tree over the fish in the periodic box.
+// The tree is implicit: node i has the children 2i + 1 and 2i + 2, and the fish of a node are the contiguous range
+// between the medians of its ancestors, so that only the bounding box of each node is stored.
+// The fish are sorted by their positions in double, see toVect3().
+// Instantiated for Fish, FishF, MixedFish and FixedFish.
+template<typename F> class BasicKdTree
+{
+private:
+  static constexpr unsigned int leaf_size = 8;// Largest number of fish in a leaf
+  static constexpr unsigned int task_size = 4096;// Subtrees with more fish are built by a separate task
+
+  struct Entry
+  {
+    Vect3 position;
+    const F *fish;
+    unsigned int index;// Index of the fish in the original order
+  };
+
+  struct Box
+  {
+    Vect3 lower;
+    Vect3 upper;
+  };
+
+  unsigned int m_length = 0;
+  unsigned int m_depth = 0;// Level of the leaves, the root being level 0
+  std::vector<Entry> m_entries;
+  std::vector<Box> m_box;
+
+  void buildNode(std::size_t node, unsigned int begin, unsigned int end, unsigned int level);
+  void findNearest(std::size_t node,
+    unsigned int begin,
+    unsigned int end,
+    unsigned int level,
+    const Vect3 &position,
+    const F *exclude,
+    std::size_t n_nearest,
+    double &squared_radius,
+    std::vector<std::pair<double, unsigned int>> &nearest) const;
+
+  // Distance between a coordinate and an interval of the periodic box along one axis
+  [[nodiscard]] inline double intervalDistance(double coordinate, double lower, double upper) const
+  {
+    const auto length = static_cast<double>(m_length);
+    if (coordinate < lower) { return std::min(lower - coordinate, coordinate + length - upper); }
+    if (coordinate > upper) { return std::min(coordinate - upper, lower + length - coordinate); }
+    return 0.0;
+  }
+
+  [[nodiscard]] inline double squaredBoxDistance(const Vect3 &position, std::size_t node) const
+  {
+    const double dx = intervalDistance(position.x, m_box[node].lower.x, m_box[node].upper.x);
+    const double dy = intervalDistance(position.y, m_box[node].lower.y, m_box[node].upper.y);
+    const double dz = intervalDistance(position.z, m_box[node].lower.z, m_box[node].upper.z);
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  template<typename Visit>
+  void forEachWithin(std::size_t node,
+    unsigned int begin,
+    unsigned int end,
+    unsigned int level,
+    const Vect3 &position,
+    double radius,
+    Visit &visit) const
+  {
+    if (squaredBoxDistance(position, node) > radius * radius) { return; }
+
+    if (level == m_depth) {
+      for (unsigned int i = begin; i < end; i++) {
+        const double distance = absolute(vect12(position, m_entries[i].position, m_length));
+        if (distance <= radius) { visit(i, distance); }
+      }
+      return;
+    }
+
+    const unsigned int mid = begin + (end - begin) / 2;
+    forEachWithin(2 * node + 1, begin, mid, level + 1, position, radius, visit);
+    forEachWithin(2 * node + 2, mid, end, level + 1, position, radius, visit);
+  }
+
+public:
+  // Sort the fish into the tree, building the subtrees in parallel
+  void build(const BasicSchool<F> &fish, unsigned int length);
+
+  [[nodiscard]] inline unsigned int size() const { return static_cast<unsigned int>(m_entries.size()); }
+  [[nodiscard]] inline unsigned int getDepth() const { return m_depth; }
+  [[nodiscard]] inline const F *getFish(unsigned int index) const { return m_entries[index].fish; }
+  [[nodiscard]] inline unsigned int getFishIndex(unsigned int index) const { return m_entries[index].index; }
+  [[nodiscard]] inline const Vect3 &getPosition(unsigned int index) const { return m_entries[index].position; }
+
+  // Call visit(index, distance) for every fish within the radius of the position, using the minimum image distance
+  template<typename Visit>
+  inline void forEachWithin(const Vect3 &position, double radius, Visit &&visit) const
+  {
+    if (m_entries.empty()) { return; }
+    forEachWithin(0, 0, size(), 0, position, radius, visit);
+  }
+
+  // Store the distance to and index of up to n_nearest fish within the radius, nearest first, skipping exclude
+  void findNearest(const Vect3 &position,
+    std::size_t n_nearest,
+    double radius,
+    const F *exclude,
+    std::vector<std::pair<double, unsigned int>> &nearest) const;
+};
+
+using KdTree = BasicKdTree<Fish>;
+
+#endif// KDTREE_HPP
@@ -0,0 +1,33 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <cstddef>
+
+// Back the arrays allocated afterwards by FirstTouchAllocator with transparent huge pages, where they are large enough
+void setHugePages(bool enable);
+bool getHugePages();
+
+// Allocate n elements of element_size bytes. Large arrays are freshly mapped and zeroed by the OpenMP threads, each
+// thread zeroing the elements it is given by a schedule(static) loop over them. Their pages therefore land on the
+// NUMA node of the thread that handles the elements in the loops over the fish.
+void *allocateFirstTouch(std::size_t n, std::size_t element_size);
+void deallocateFirstTouch(void *pointer, std::size_t n, std::size_t element_size);
+
+// Allocator placing the arrays of per-fish data on the NUMA nodes of the threads that use them, see
+// allocateFirstTouch(). The vectors should be sized exactly, as a larger capacity shifts the partition.
+template<typename T> class FirstTouchAllocator
+{
+public:
+  using value_type = T;
+
+  FirstTouchAllocator() = default;
+  // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
+  template<typename U> FirstTouchAllocator(const FirstTouchAllocator<U> & /*other*/) {}
+
+  [[nodiscard]] inline T *allocate(std::size_t n) { return static_cast<T *>(allocateFirstTouch(n, sizeof(T))); }
+  inline void deallocate(T *pointer, std::size_t n) { deallocateFirstTouch(pointer, n, sizeof(T)); }
+
+  template<typename U> inline bool operator==(const FirstTouchAllocator<U> & /*other*/) const { return true; }
+};
+
+#endif// MEMORY_HPP
@@ -0,0 +1,61 @@
+#ifndef NEAREST_HPP
+#define NEAREST_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// The N nearest fish offered so far, nearest first, with ties broken by the smaller index as when sorting
+// (distance, index) pairs. The fixed size lets the compiler keep the buffer in registers and unroll the insertion.
+template<unsigned int N> class NearestBuffer
+{
+private:
+  std::array<double, N> m_distance{};
+  std::array<unsigned int, N> m_index{};
+  unsigned int m_size = 0;
+
+  [[nodiscard]] static inline bool isNearer(double distance, unsigned int index, double other, unsigned int other_index)
+  {
+    return distance < other || (distance == other && index < other_index);
+  }
+
+public:
+  inline void insert(double distance, unsigned int index)
+  {
+    if (m_size == N && !isNearer(distance, index, m_distance[N - 1], m_index[N - 1])) { return; }
+
+    // Shift the farther fish back by one, dropping the farthest if the buffer is full
+    unsigned int slot = m_size < N ? m_size++ : N - 1;
+    while (slot > 0 && isNearer(distance, index, m_distance[slot - 1], m_index[slot - 1])) {
+      m_distance[slot] = m_distance[slot - 1];
+      m_index[slot] = m_index[slot - 1];
+      slot--;
+    }
+    m_distance[slot] = distance;
+    m_index[slot] = index;
+  }
+
+  [[nodiscard]] inline unsigned int size() const { return m_size; }
+  [[nodiscard]] inline double getDistance(std::size_t k) const { return m_distance[k]; }
+  [[nodiscard]] inline unsigned int getIndex(std::size_t k) const { return m_index[k]; }
+};
+
+// Offer a fish to the n nearest offered so far, kept in a max-heap ordered by less. For an n_cog only known at run
+// time, and unlike collecting every fish offered, the heap never holds more than n of them, so that a vector reserved
+// for n is never reallocated. std::sort_heap() then orders them nearest first.
+template<typename T, typename Less = std::less<T>>
+inline void offerNearest(std::vector<T> &nearest, std::size_t n, const T &candidate, Less less = {})
+{
+  if (nearest.size() == n) {
+    if (n == 0 || !less(candidate, nearest.front())) { return; }
+    std::pop_heap(nearest.begin(), nearest.end(), less);
+    nearest.back() = candidate;
+  } else {
+    nearest.push_back(candidate);
+  }
+  std::push_heap(nearest.begin(), nearest.end(), less);
+}
+
+#endif// NEAREST_HPP
@@ -0,0 +1,106 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include "coordinate.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Rgb
+{
+  std::uint8_t r;
+  std::uint8_t g;
+  std::uint8_t b;
+};
+
+// Convert a colour whose hue, saturation and value are in [0, 1], as hsv2rgb() of gnuplot
+Rgb hsvToRgb(double hue, double saturation, double value);
+
+// Colour of a fish as drawn by create_movie.sh: the hue is the heading in the xy plane, the saturation grows with the
+// speed and the value with the velocity along z
+Rgb fishColour(const Vect3 &velocity, double vel_standard);
+
+// Orthographic projection of the box onto the frame, as "set view rot_x, rot_z" of gnuplot
+class Projection
+{
+private:
+  double m_length;
+  double m_scale;// Pixels per unit of the box
+  double m_centre_x;
+  double m_centre_y;
+  double m_cos_x;
+  double m_sin_x;
+  double m_cos_z;
+  double m_sin_z;
+
+public:
+  Projection(unsigned int length, unsigned int width, unsigned int height, double rot_x, double rot_z);
+
+  // Pixel coordinates of the position, and its depth which grows towards the viewer
+  [[nodiscard]] Vect3 project(const Vect3 &position) const;
+};
+
+// RGB image, stored row by row from the top
+class Frame
+{
+private:
+  unsigned int m_width;
+  unsigned int m_height;
+  std::vector<std::uint8_t> m_pixels;
+
+  inline void setPixel(std::size_t x, std::size_t y, Rgb colour)
+  {
+    const std::size_t pixel = 3 * (y * m_width + x);
+    m_pixels[pixel] = colour.r;
+    m_pixels[pixel + 1] = colour.g;
+    m_pixels[pixel + 2] = colour.b;
+  }
+
+public:
+  Frame(unsigned int width, unsigned int height);
+
+  [[nodiscard]] inline unsigned int getWidth() const { return m_width; }
+  [[nodiscard]] inline unsigned int getHeight() const { return m_height; }
+  [[nodiscard]] inline const std::vector<std::uint8_t> &getPixels() const { return m_pixels; }
+  [[nodiscard]] Rgb getPixel(unsigned int x, unsigned int y) const;
+
+  void fill(Rgb colour);
+  // The parts outside of the frame are clipped
+  void fillCircle(double x, double y, double radius, Rgb colour);
+  void drawLine(double x1, double y1, double x2, double y2, Rgb colour);
+  // Text of the digits, '.', '=', '-', 't' and spaces in a 3x5 pixel font magnified by scale, from its top left corner
+  void drawText(unsigned int x, unsigned int y, std::string_view text, unsigned int scale, Rgb colour);
+};
+
+// Positions and velocities of the fish in one snapshot of output.txt
+struct Snapshot
+{
+  std::vector<Vect3> positions;
+  std::vector<Vect3> velocities;
+};
+
+// Append the next n_fish lines of the stream to text, which is cleared first. False if the stream ends before.
+bool readSnapshotText(std::istream &input, unsigned int n_fish, std::string &text);
+
+// Parse the lines read by readSnapshotText(), each holding x y z vx vy vz. False if a line is malformed.
+bool parseSnapshot(std::string_view text, Snapshot &snapshot);
+
+struct RenderParam
+{
+  unsigned int length;
+  double vel_standard;
+  double point_radius = 2.5;// In pixels
+  std::string title;// Drawn at the top left if not empty
+};
+
+// Draw the box and the fish, the farther ones first, as create_movie.sh plots them with "set view 60,30"
+void renderSnapshot(Frame &frame, const Projection &projection, const Snapshot &snapshot, const RenderParam &param);
+
+// Write the frame as a PNG file, whose image data is stored without compression
+void writePng(std::ostream &output, const Frame &frame);
+
+#endif// RENDER_HPP
@@ -0,0 +1,44 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include "cpu.hpp"
+
+// Copies of a kernel compiled for each SIMD level, the kernel being a class whose static member function run() is
+// always inlined, so that each copy is vectorized for its own instruction set. Select the copy once before the loops
+// that call it, as the selection reads the level in use.
+template<typename Kernel, typename Signature = decltype(Kernel::run)> struct SimdCopies;
+
+template<typename Kernel, typename Result, typename... Args> struct SimdCopies<Kernel, Result(Args...)>
+{
+  using Copy = Result (*)(Args...);
+
+  static Result generic(Args... args) { return Kernel::run(args...); }
+
+#if defined(__x86_64__) || defined(__i386__)
+  [[gnu::target("sse4.2")]] static Result sse42(Args... args) { return Kernel::run(args...); }
+
+  [[gnu::target("avx2")]] static Result avx2(Args... args) { return Kernel::run(args...); }
+
+  [[gnu::target("avx512f")]] static Result avx512(Args... args) { return Kernel::run(args...); }
+#endif
+
+  // Copy compiled for the SIMD level in use
+  static Copy select()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (getSimdLevel()) {
+    case SimdLevel::AVX512:
+      return avx512;
+    case SimdLevel::AVX2:
+      return avx2;
+    case SimdLevel::SSE42:
+      return sse42;
+    default:
+      break;
+    }
+#endif
+    return generic;
+  }
+};
+
+#endif// SIMD_HPP
@@ -2,6 +2,41 @@
 #define SIMULATION_HPP
 
 
+// How the interactions between the fish are evaluated
+enum class NeighbourSearch {
+  Cell,// Each fish scans the cells of the stencil around it
+  Tiled,// The fish of each cell scan the cells of the stencil around it together
+  KdTree,// Each fish queries a k-d tree, which does not degrade when the fish crowd into a few cells
+  AllPairs,// Each fish checks every other fish, which is the fastest for the smallest schools
+};
+
+// Cells in which the neighbours of the fish are searched for
+enum class CellGrid {
+  Unit,// One grid of unit cells with spherical stencils for both interactions
+  TwoLevel,// Cells sized to the repulsion and attraction radii, each with a 27-cell stencil
+};
+
+// Scalar in which the state of the fish is stored and the interactions are computed
+enum class Precision {
+  Double,// Everything in double
+  Float,// Everything in float, which halves the memory traffic and doubles the SIMD width
+  Mixed,// Positions as float offsets within unit cells and velocities in float, with the interactions summed in double
+  Fixed,// Positions as unsigned 32-bit fractions of the box length, which wrap around it for free
+};
+
+// How the OpenMP threads are pinned to the processors
+enum class ThreadAffinity {
+  None,// Left to the OpenMP runtime, e.g. OMP_PROC_BIND and OMP_PLACES
+  Close,// Thread i on the i-th processor the process may run on, filling one socket first
+  Spread,// The threads evenly spread over the processors the process may run on, and so over the sockets
+};
+
+// What the snapshots hold
+enum class OutputMode {
+  Fish,// The position and velocity of every fish
+  Voxels,// The number of fish and their mean velocity in each occupied voxel, and optionally a sample of the fish
+};
+
 struct SimParam
 {
   unsigned int length;
@@ -9,6 +44,24 @@ struct SimParam
   unsigned int max_steps;
   double delta_t;
   unsigned int snapshot_interval;
+  NeighbourSearch neighbour_search = NeighbourSearch::Cell;// Optional
+  CellGrid cell_grid = CellGrid::Unit;// Optional
+  unsigned int rebuild_interval = 1;// Optional, steps between full rebuilds of the cell lists
+  double attraction_opening_angle = 0.0;// Optional, far cells seen under a smaller angle are approximated if positive
+  unsigned int all_pairs_threshold = 150;// Optional, schools with fewer fish default to the all-pairs search
+  unsigned int kd_tree_threshold = 4000;// Optional, larger schools with fewer fish default to the k-d tree search
+  Precision precision = Precision::Double;// Optional
+  ThreadAffinity thread_affinity = ThreadAffinity::None;// Optional
+  bool huge_pages = false;// Optional, back the large arrays with transparent huge pages
+  double load_imbalance = 1.2;// Optional, MPI ranks are rebalanced once one holds this many times the mean of fish
+  unsigned int rebalance_interval = 10;// Optional, fewest steps between two rebalances of the MPI ranks
+  unsigned int observables_interval = 0;// Optional, steps between the rows of the observables, none if 0
+  double cluster_radius = 0.0;// Optional, fish closer than this are in the same cluster, no clusters if 0
+  unsigned int rdf_bins = 0;// Optional, bins of the radial distribution function up to the attraction radius, none if 0
+  unsigned int field_resolution = 0;// Optional, voxels per side of the density and velocity field, none if 0
+  OutputMode output_mode = OutputMode::Fish;// Optional
+  unsigned int output_resolution = 32;// Optional, voxels per side of the snapshots in the voxels output mode
+  unsigned int output_sample = 0;// Optional, fish written along with the voxels of each snapshot
 };
 
 struct FishParam
@@ -0,0 +1,244 @@
+#include "eom.hpp"
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "nearest.hpp"
+#include "simd.hpp"
+#include "simulation.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// This file alone is compiled without contracting to FMA (see src/CMakeLists.txt), so that the sweep rounds the same
+// at every SIMD level and the all-pairs search stays the reference to the last bit
+
+constexpr std::size_t all_pairs_tile_size = 512;// Fish whose displacements are computed in one vectorized sweep
+
+// Positions of the fish as separate arrays, so that the displacements to a tile of fish vectorize.
+// For mixed fish these are the offsets within the cells, and the difference of the cells, which is exact,
+// is added to the difference of the offsets. Fixed-point fish keep their integer coordinates.
+template<typename Scalar> struct AllPairsPositions
+{
+  std::vector<Scalar> pos_x;
+  std::vector<Scalar> pos_y;
+  std::vector<Scalar> pos_z;
+  std::vector<Scalar> cell_x;
+  std::vector<Scalar> cell_y;
+  std::vector<Scalar> cell_z;
+  std::vector<std::uint32_t> fixed_x;
+  std::vector<std::uint32_t> fixed_y;
+  std::vector<std::uint32_t> fixed_z;
+  Scalar length;
+  Scalar half_length;
+  Scalar fixed_scale;// Box length per fixed-point step
+};
+
+// Displacements from one fish to a tile of fish, and their squared norms
+template<typename Scalar> struct AllPairsTile
+{
+  std::array<Scalar, all_pairs_tile_size> rel_x;
+  std::array<Scalar, all_pairs_tile_size> rel_y;
+  std::array<Scalar, all_pairs_tile_size> rel_z;
+  std::array<Scalar, all_pairs_tile_size> squared_distance;
+};
+
+// Minimum image displacements from fish i to the count fish from first, shifting the other fish by the length as
+// vect12() does, without branches so that the sweep vectorizes
+template<typename F, typename Scalar> struct SweepTile
+{
+  [[gnu::always_inline]] static void run(const AllPairsPositions<Scalar> &positions,
+    std::size_t i,
+    std::size_t first,
+    std::size_t count,
+    AllPairsTile<Scalar> &tile)
+  {
+    constexpr bool is_mixed = std::is_same_v<F, MixedFish>;
+    constexpr bool is_fixed = std::is_same_v<F, FixedFish>;
+    const auto &[pos_x, pos_y, pos_z, cell_x, cell_y, cell_z, fixed_x, fixed_y, fixed_z, length, half_length,
+      fixed_scale] = positions;
+    auto &[rel_x, rel_y, rel_z, squared_distance] = tile;
+
+#pragma omp simd
+    for (std::size_t k = 0; k < count; k++) {
+      if constexpr (is_fixed) {
+        // The signed difference of the coordinates is already the minimum image
+        rel_x[k] = static_cast<std::int32_t>(fixed_x[first + k] - fixed_x[i]) * fixed_scale;
+        rel_y[k] = static_cast<std::int32_t>(fixed_y[first + k] - fixed_y[i]) * fixed_scale;
+        rel_z[k] = static_cast<std::int32_t>(fixed_z[first + k] - fixed_z[i]) * fixed_scale;
+      } else {
+        Scalar dx = pos_x[first + k] - pos_x[i];
+        Scalar dy = pos_y[first + k] - pos_y[i];
+        Scalar dz = pos_z[first + k] - pos_z[i];
+        if constexpr (is_mixed) {
+          dx += cell_x[first + k] - cell_x[i];
+          dy += cell_y[first + k] - cell_y[i];
+          dz += cell_z[first + k] - cell_z[i];
+        }
+        const Scalar shift_x = dx > half_length ? -length : (dx < -half_length ? length : 0);
+        const Scalar shift_y = dy > half_length ? -length : (dy < -half_length ? length : 0);
+        const Scalar shift_z = dz > half_length ? -length : (dz < -half_length ? length : 0);
+        if constexpr (is_mixed) {
+          rel_x[k] = dx + shift_x;
+          rel_y[k] = dy + shift_y;
+          rel_z[k] = dz + shift_z;
+        } else {
+          rel_x[k] = (pos_x[first + k] + shift_x) - pos_x[i];
+          rel_y[k] = (pos_y[first + k] + shift_y) - pos_y[i];
+          rel_z[k] = (pos_z[first + k] + shift_z) - pos_z[i];
+        }
+      }
+      squared_distance[k] = (rel_x[k] * rel_x[k]) + (rel_y[k] * rel_y[k]) + (rel_z[k] * rel_z[k]);
+    }
+  }
+};
+
+template<typename Scalar> AllPairsPositions<Scalar> &getThreadAllPairsPositions()
+{
+  thread_local AllPairsPositions<Scalar> positions{};
+  return positions;
+}
+
+// Distance to, index of and displacement to one of the nearest fish
+template<typename Sum> using AllPairsNeighbour = std::tuple<Sum, unsigned int, BasicVect3<Sum>>;
+
+template<typename Sum> std::vector<AllPairsNeighbour<Sum>> &getThreadAllPairsNeighbours()
+{
+  thread_local std::vector<AllPairsNeighbour<Sum>> neighbours{};
+  return neighbours;
+}
+
+template<typename F>
+void calcDeltaVelocitiesAllPairs(BasicSchool<F> &fish, const SimParam &sim_param, const FishParam &fish_param)
+{
+  // The displacements are computed in the scalar of the positions, and the interactions are summed in double
+  // unless the whole fish is float
+  constexpr bool is_mixed = std::is_same_v<F, MixedFish>;
+  constexpr bool is_fixed = std::is_same_v<F, FixedFish>;
+  using Scalar = typename FishTraits<F>::Scalar;
+  using Sum = FishSum<F>;
+
+  const std::size_t n_fish = fish.size();
+  const auto length = static_cast<Scalar>(sim_param.length);
+
+  // Kept from one call to the next by the calling thread, so that the steps of a school allocate nothing
+  auto &positions = getThreadAllPairsPositions<Scalar>();
+  positions.pos_x.resize(is_fixed ? 0 : n_fish);
+  positions.pos_y.resize(is_fixed ? 0 : n_fish);
+  positions.pos_z.resize(is_fixed ? 0 : n_fish);
+  positions.cell_x.resize(is_mixed ? n_fish : 0);
+  positions.cell_y.resize(is_mixed ? n_fish : 0);
+  positions.cell_z.resize(is_mixed ? n_fish : 0);
+  positions.fixed_x.resize(is_fixed ? n_fish : 0);
+  positions.fixed_y.resize(is_fixed ? n_fish : 0);
+  positions.fixed_z.resize(is_fixed ? n_fish : 0);
+  positions.length = length;
+  positions.half_length = length / 2;
+  positions.fixed_scale = length / static_cast<Scalar>(fixed_steps);
+  for (std::size_t i = 0; i < n_fish; i++) {
+    if constexpr (is_mixed) {
+      positions.pos_x[i] = fish[i].getOffset().x;
+      positions.pos_y[i] = fish[i].getOffset().y;
+      positions.pos_z[i] = fish[i].getOffset().z;
+      positions.cell_x[i] = static_cast<Scalar>(fish[i].getCell()[0]);
+      positions.cell_y[i] = static_cast<Scalar>(fish[i].getCell()[1]);
+      positions.cell_z[i] = static_cast<Scalar>(fish[i].getCell()[2]);
+    } else if constexpr (is_fixed) {
+      positions.fixed_x[i] = fish[i].getFixedPosition().x;
+      positions.fixed_y[i] = fish[i].getFixedPosition().y;
+      positions.fixed_z[i] = fish[i].getFixedPosition().z;
+    } else {
+      positions.pos_x[i] = fish[i].getPosition().x;
+      positions.pos_y[i] = fish[i].getPosition().y;
+      positions.pos_z[i] = fish[i].getPosition().z;
+    }
+  }
+
+  const auto sweep_tile = SimdCopies<SweepTile<F, Scalar>>::select();
+  const auto squared_repulsion_radius = static_cast<Scalar>(fish_param.repulsion_radius * fish_param.repulsion_radius);
+  const auto squared_attraction_radius =
+    static_cast<Scalar>(fish_param.attraction_radius * fish_param.attraction_radius);
+  const auto vel_escape = static_cast<Sum>(fish_param.vel_escape);
+  const auto vel_repulsion = static_cast<Sum>(fish_param.vel_repulsion);
+  const auto vel_standard = static_cast<Sum>(fish_param.vel_standard);
+
+#pragma omp parallel default(none) shared(fish, fish_param, n_fish, positions, sweep_tile, squared_repulsion_radius, \
+    squared_attraction_radius, vel_escape, vel_repulsion, vel_standard)
+  {
+    AllPairsTile<Scalar> tile{};
+    const auto &[rel_x, rel_y, rel_z, squared_distance] = tile;
+    const auto nearer = [](const AllPairsNeighbour<Sum> &lhs, const AllPairsNeighbour<Sum> &rhs) {
+      return std::tie(std::get<0>(lhs), std::get<1>(lhs)) < std::tie(std::get<0>(rhs), std::get<1>(rhs));
+    };
+    auto &neighbours = getThreadAllPairsNeighbours<Sum>();
+    neighbours.reserve(fish_param.n_cog);
+
+#pragma omp for schedule(static)
+    for (std::size_t i = 0; i < n_fish; i++) {
+      F &one_fish = fish[i];
+      const auto velocity = castVect3<Sum>(one_fish.getVelocity());
+      BasicVect3<Sum> delta_v_attraction{ .x = 0, .y = 0, .z = 0 };
+      unsigned int n_attraction = 0;
+      neighbours.clear();
+
+      for (std::size_t first = 0; first < n_fish; first += all_pairs_tile_size) {
+        const std::size_t count = n_fish - first < all_pairs_tile_size ? n_fish - first : all_pairs_tile_size;
+        sweep_tile(positions, i, first, count, tile);
+
+        // Few fish are within the attraction radius, so the square roots are only taken for them
+        for (std::size_t k = 0; k < count; k++) {
+          if (squared_distance[k] > squared_attraction_radius) { continue; }
+          const Sum distance = std::sqrt(static_cast<Sum>(squared_distance[k]));
+          const BasicVect3<Sum> rel{ .x = rel_x[k], .y = rel_y[k], .z = rel_z[k] };
+          if (squared_distance[k] >= squared_repulsion_radius) {
+            delta_v_attraction += (vel_escape / distance) * rel - velocity;
+            n_attraction++;
+          } else if (first + k != i) {
+            offerNearest(neighbours, fish_param.n_cog, { distance, static_cast<unsigned int>(first + k), rel }, nearer);
+          }
+        }
+      }
+
+      // Repulsion with up to n_cog nearest fish, as in calcDeltaVRepulsion()
+      const std::size_t n_nearest = neighbours.size();
+      std::sort_heap(neighbours.begin(), neighbours.end(), nearer);
+      BasicVect3<Sum> delta_v_repulsion{ .x = 0, .y = 0, .z = 0 };
+      for (std::size_t k = 0; k < n_nearest; k++) {
+        const auto &[distance, index, rel] = neighbours[k];
+        const auto g_factor = static_cast<Sum>(g(static_cast<double>(distance), fish_param.body_length));
+        delta_v_repulsion += g_factor * (castVect3<Sum>(fish[index].getVelocity()) - velocity);
+        delta_v_repulsion += g_factor * ((vel_repulsion / distance) * (Sum{ -1 } * rel) - velocity);
+      }
+      if (n_nearest != 0) { delta_v_repulsion = delta_v_repulsion / static_cast<Sum>(n_nearest); }
+
+      const BasicVect3<Sum> delta_v_self = (vel_standard / absolute(velocity) - 1) * velocity;
+
+      if (n_nearest < fish_param.n_cog) { one_fish.setLambda(static_cast<Sum>(fish_param.attraction_str)); }
+
+      if (one_fish.getLambda() > 0 && n_attraction != 0) {
+        one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion
+                                  + static_cast<Sum>(one_fish.getLambda()) * delta_v_attraction
+                                      / static_cast<Sum>(n_attraction));
+      } else {
+        one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion);
+      }
+    }
+  }
+}
+
+template void calcDeltaVelocitiesAllPairs(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param);
+template void calcDeltaVelocitiesAllPairs(BasicSchool<FishF> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param);
+template void calcDeltaVelocitiesAllPairs(BasicSchool<MixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param);
+template void calcDeltaVelocitiesAllPairs(BasicSchool<FixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param);
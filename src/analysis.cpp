@@ -0,0 +1,351 @@
+#include "analysis.hpp"
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "grid.hpp"
+#include "kdtree.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <numeric>
+#include <numbers>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Circular mean of the coordinates whose mean cosine and sine of 2 pi x / length are given, in [0, length)
+double circularMean(double mean_cos, double mean_sin, unsigned int length)
+{
+  double angle = std::atan2(mean_sin, mean_cos);
+  if (angle < 0) { angle += 2 * std::numbers::pi; }
+  const double mean = angle / (2 * std::numbers::pi) * length;
+  return mean < length ? mean : 0.0;
+}
+
+// Root of the tree of the element, halving the path to it on the way. The parents only ever decrease, so that a
+// parent read while another thread links or halves is still an ancestor.
+unsigned int findRoot(std::vector<unsigned int> &parent, unsigned int element)
+{
+  while (true) {
+    std::atomic_ref<unsigned int> link(parent[element]);
+    const unsigned int above = link.load(std::memory_order_relaxed);
+    if (above == element) { return element; }
+    const unsigned int grandparent = std::atomic_ref<unsigned int>(parent[above]).load(std::memory_order_relaxed);
+    if (grandparent != above) {
+      unsigned int expected = above;
+      link.compare_exchange_weak(expected, grandparent, std::memory_order_relaxed);
+    }
+    element = grandparent;
+  }
+}
+
+// Merge the trees of the two elements by linking the larger root under the smaller one, retrying if another thread
+// linked the root in between
+void unite(std::vector<unsigned int> &parent, unsigned int first, unsigned int second)
+{
+  while (true) {
+    first = findRoot(parent, first);
+    second = findRoot(parent, second);
+    if (first == second) { return; }
+    if (first < second) { std::swap(first, second); }
+    unsigned int expected = first;
+    if (std::atomic_ref<unsigned int>(parent[first])
+          .compare_exchange_strong(expected, second, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+// Call visit(other, distance) for every fish in a slot after the given one and within the radius of it, searching the
+// runs around its cell, so that each pair of fish is visited once
+template<typename Visit>
+void forEachLaterWithin(const CellList &grid,
+  const std::vector<StencilRun> &runs,
+  unsigned int length,
+  double radius,
+  unsigned int slot,
+  Visit &&visit)
+{
+  const Vect3 &position = grid.getPosition(slot);
+  grid.forEachOccupiedRun(grid.getCell(position), runs, [&](const IndexRange &run_cells) {
+    const unsigned int end = grid.getCellRange(run_cells.end - 1).end;
+    for (unsigned int other = std::max(grid.getCellRange(run_cells.begin).begin, slot + 1); other < end; other++) {
+      const double distance = absolute(vect12(position, grid.getPosition(other), length));
+      if (distance <= radius) { visit(other, distance); }
+    }
+  });
+}
+
+}// namespace
+
+Observables computeObservables(const School &fish, unsigned int length)
+{
+  Observables observables{};
+  const std::size_t n_fish = fish.size();
+  if (n_fish == 0) { return observables; }
+
+  // Sums of the unit velocities, and of the positions mapped onto a circle along each axis so that a school across the
+  // boundary has its centre of mass inside it
+  const double to_angle = 2 * std::numbers::pi / length;
+  double heading_x = 0.0;
+  double heading_y = 0.0;
+  double heading_z = 0.0;
+  double cos_x = 0.0;
+  double cos_y = 0.0;
+  double cos_z = 0.0;
+  double sin_x = 0.0;
+  double sin_y = 0.0;
+  double sin_z = 0.0;
+#pragma omp parallel for default(none) shared(fish, n_fish, to_angle) schedule(static) \
+  reduction(+ : heading_x, heading_y, heading_z, cos_x, cos_y, cos_z, sin_x, sin_y, sin_z)
+  for (std::size_t i = 0; i < n_fish; i++) {
+    const Vect3 velocity = fish[i].getVelocity();
+    const double speed = absolute(velocity);
+    if (speed > 0) {
+      heading_x += velocity.x / speed;
+      heading_y += velocity.y / speed;
+      heading_z += velocity.z / speed;
+    }
+    const Vect3 position = fish[i].getPosition();
+    cos_x += std::cos(position.x * to_angle);
+    cos_y += std::cos(position.y * to_angle);
+    cos_z += std::cos(position.z * to_angle);
+    sin_x += std::sin(position.x * to_angle);
+    sin_y += std::sin(position.y * to_angle);
+    sin_z += std::sin(position.z * to_angle);
+  }
+  const auto count = static_cast<double>(n_fish);
+  observables.polarization = absolute(Vect3{ .x = heading_x, .y = heading_y, .z = heading_z }) / count;
+  const Vect3 centre{ .x = circularMean(cos_x / count, sin_x / count, length),
+    .y = circularMean(cos_y / count, sin_y / count, length),
+    .z = circularMean(cos_z / count, sin_z / count, length) };
+  observables.centre_of_mass = centre;
+
+  // Moments about the centre of mass, and the distances to the nearest neighbours
+  KdTree tree{};
+  tree.build(fish, length);
+  double momentum_x = 0.0;
+  double momentum_y = 0.0;
+  double momentum_z = 0.0;
+  double squared_radius = 0.0;
+  double nearest_distance = 0.0;
+  unsigned int n_nearest = 0;
+#pragma omp parallel default(none) shared(fish, n_fish, length, centre, tree) \
+  reduction(+ : momentum_x, momentum_y, momentum_z, squared_radius, nearest_distance, n_nearest)
+  {
+    std::vector<std::pair<double, unsigned int>> nearest{};
+    nearest.reserve(1);
+
+#pragma omp for schedule(dynamic, 64)
+    for (std::size_t i = 0; i < n_fish; i++) {
+      const Vect3 position = fish[i].getPosition();
+      const Vect3 velocity = fish[i].getVelocity();
+      const Vect3 radius = vect12(centre, position, length);
+      momentum_x += radius.y * velocity.z - radius.z * velocity.y;
+      momentum_y += radius.z * velocity.x - radius.x * velocity.z;
+      momentum_z += radius.x * velocity.y - radius.y * velocity.x;
+      squared_radius += radius.x * radius.x + radius.y * radius.y + radius.z * radius.z;
+
+      // Every other fish is within the length of the box
+      tree.findNearest(position, 1, static_cast<double>(length), &fish[i], nearest);
+      if (!nearest.empty()) {
+        nearest_distance += nearest.front().first;
+        n_nearest++;
+      }
+    }
+  }
+  observables.angular_momentum = { .x = momentum_x / count, .y = momentum_y / count, .z = momentum_z / count };
+  observables.extent = std::sqrt(squared_radius / count);
+  observables.nearest_distance = n_nearest > 0 ? nearest_distance / n_nearest : 0.0;
+  return observables;
+}
+
+Clusters findClusters(const School &fish, unsigned int length, double radius)
+{
+  Clusters clusters{};
+  const auto n_fish = static_cast<unsigned int>(fish.size());
+  if (n_fish == 0) { return clusters; }
+
+  const unsigned int cells_per_side = getCellsPerSide(length, radius);
+  CellList grid(length, cells_per_side, 1);
+  grid.build(fish);
+  const std::vector<StencilRun> runs = getNeighbourRuns(cells_per_side);
+
+  // Each fish its own cluster, then each pair within the radius merged once, from the fish later in the list
+  std::vector<unsigned int> parent(n_fish);
+  std::iota(parent.begin(), parent.end(), 0U);
+#pragma omp parallel for default(none) shared(grid, runs, parent, n_fish, length, radius) schedule(dynamic, 64)
+  for (unsigned int slot = 0; slot < n_fish; slot++) {
+    const unsigned int index = grid.getFishIndex(slot);
+    forEachLaterWithin(grid, runs, length, radius, slot, [&](unsigned int other, double /*distance*/) {
+      unite(parent, index, grid.getFishIndex(other));
+    });
+  }
+
+  // The root of each cluster is its first fish, which is labelled before the others
+  clusters.labels.resize(n_fish);
+  for (unsigned int i = 0; i < n_fish; i++) {
+    const unsigned int root = findRoot(parent, i);
+    if (root == i) {
+      clusters.labels[i] = static_cast<unsigned int>(clusters.sizes.size());
+      clusters.sizes.push_back(0);
+    } else {
+      clusters.labels[i] = clusters.labels[root];
+    }
+    clusters.sizes[clusters.labels[i]]++;
+  }
+  return clusters;
+}
+
+VoxelField computeVoxelField(const School &fish, unsigned int length, unsigned int resolution)
+{
+  const unsigned int n_voxels = resolution * resolution * resolution;
+  VoxelField field{ .resolution = resolution,
+    .counts = std::vector<unsigned int>(n_voxels, 0),
+    .mean_velocities = std::vector<Vect3>(n_voxels, Vect3{}) };
+  CellList grid(length, resolution, 1);
+  grid.build(fish);
+
+#pragma omp parallel for default(none) shared(grid, field, n_voxels) schedule(static)
+  for (unsigned int voxel = 0; voxel < n_voxels; voxel++) {
+    const auto [begin, end] = grid.getCellRange(voxel);
+    if (begin == end) { continue; }
+    Vect3 sum{};
+    for (unsigned int slot = begin; slot < end; slot++) { sum += grid.getFish(slot)->getVelocity(); }
+    field.counts[voxel] = end - begin;
+    field.mean_velocities[voxel] = sum / (end - begin);
+  }
+  return field;
+}
+
+RadialDistribution::RadialDistribution(double radius, unsigned int n_bins) : m_radius(radius), m_pairs(n_bins, 0.0)
+{}
+
+void RadialDistribution::accumulate(const School &fish, unsigned int length)
+{
+  const auto n_fish = static_cast<unsigned int>(fish.size());
+  const auto n_bins = static_cast<unsigned int>(m_pairs.size());
+  const double inverse_width = 1.0 / getBinWidth();
+  const double radius = m_radius;
+  const unsigned int cells_per_side = getCellsPerSide(length, radius);
+  CellList grid(length, cells_per_side, 1);
+  grid.build(fish);
+  const std::vector<StencilRun> runs = getNeighbourRuns(cells_per_side);
+
+  // Each thread fills its own histogram, added to the total once it is done
+  std::vector<double> &pairs = m_pairs;
+#pragma omp parallel default(none) shared(grid, runs, pairs, n_fish, n_bins, inverse_width, length, radius)
+  {
+    std::vector<double> thread_pairs(n_bins, 0.0);
+#pragma omp for schedule(dynamic, 64) nowait
+    for (unsigned int slot = 0; slot < n_fish; slot++) {
+      forEachLaterWithin(grid, runs, length, radius, slot, [&](unsigned int /*other*/, double distance) {
+        thread_pairs[std::min(static_cast<unsigned int>(distance * inverse_width), n_bins - 1)] += 1.0;
+      });
+    }
+#pragma omp critical
+    for (unsigned int bin = 0; bin < n_bins; bin++) { pairs[bin] += thread_pairs[bin]; }
+  }
+
+  const double volume = static_cast<double>(length) * length * length;
+  m_ideal_pairs += 0.5 * n_fish * (n_fish - 1.0) / volume;
+}
+
+std::vector<double> RadialDistribution::compute() const
+{
+  std::vector<double> distribution(m_pairs.size(), 0.0);
+  if (m_ideal_pairs <= 0) { return distribution; }
+  const double width = getBinWidth();
+  for (std::size_t bin = 0; bin < m_pairs.size(); bin++) {
+    const double inner = static_cast<double>(bin) * width;
+    const double outer = inner + width;
+    const double shell = 4.0 / 3.0 * std::numbers::pi * (outer * outer * outer - inner * inner * inner);
+    distribution[bin] = m_pairs[bin] / (m_ideal_pairs * shell);
+  }
+  return distribution;
+}
+
+void RadialDistribution::write(std::ostream &output) const
+{
+  const std::vector<double> distribution = compute();
+  output << "# r g(r)" << '\n';
+  for (std::size_t bin = 0; bin < distribution.size(); bin++) {
+    output << (static_cast<double>(bin) + 0.5) * getBinWidth() << " " << distribution[bin] << '\n';
+  }
+}
+
+void writeObservablesHeader(std::ostream &output)
+{
+  output << "# step time polarization com_x com_y com_z angular_momentum_x angular_momentum_y angular_momentum_z "
+            "nearest_distance extent"
+         << '\n';
+}
+
+void writeObservables(std::ostream &output, unsigned int step, double time, const Observables &observables)
+{
+  const auto [com_x, com_y, com_z] = observables.centre_of_mass;
+  const auto [lx, ly, lz] = observables.angular_momentum;
+  output << step << " " << time << " " << observables.polarization << " " << com_x << " " << com_y << " " << com_z
+         << " " << lx << " " << ly << " " << lz << " " << observables.nearest_distance << " " << observables.extent
+         << '\n';
+}
+
+void writeClustersHeader(std::ostream &output) { output << "# step time n_clusters size:count..." << '\n'; }
+
+void writeClusters(std::ostream &output, unsigned int step, double time, const Clusters &clusters)
+{
+  std::map<unsigned int, unsigned int> histogram{};
+  for (const auto size : clusters.sizes) { histogram[size]++; }
+  output << step << " " << time << " " << clusters.sizes.size();
+  for (const auto &[size, count] : histogram) { output << " " << size << ":" << count; }
+  output << '\n';
+}
+
+void writeClusterLabels(std::ostream &output, const Clusters &clusters)
+{
+  for (std::size_t i = 0; i < clusters.labels.size(); i++) { output << (i == 0 ? "" : " ") << clusters.labels[i]; }
+  output << '\n';
+}
+
+void writeVoxelField(std::ostream &output, unsigned int step, double time, const VoxelField &field)
+{
+  const auto n_occupied = std::count_if(field.counts.begin(), field.counts.end(), [](unsigned int count) {
+    return count > 0;
+  });
+  output << "# " << step << " " << time << " " << n_occupied << '\n';
+  const unsigned int resolution = field.resolution;
+  for (std::size_t voxel = 0; voxel < field.counts.size(); voxel++) {
+    if (field.counts[voxel] == 0) { continue; }
+    const auto [vx, vy, vz] = field.mean_velocities[voxel];
+    output << voxel / resolution / resolution << " " << voxel / resolution % resolution << " " << voxel % resolution
+           << " " << field.counts[voxel] << " " << vx << " " << vy << " " << vz << '\n';
+  }
+}
+
+void writeAnalysisHeaders(const AnalysisOutput &output)
+{
+  if (output.observables != nullptr) { writeObservablesHeader(*output.observables); }
+  if (output.clusters != nullptr) { writeClustersHeader(*output.clusters); }
+}
+
+void analyse(const School &fish, const SimParam &sim_param, unsigned int step, const AnalysisOutput &output)
+{
+  const double time = step * sim_param.delta_t;
+  if (output.observables != nullptr) {
+    writeObservables(*output.observables, step, time, computeObservables(fish, sim_param.length));
+  }
+  if (sim_param.cluster_radius > 0 && (output.clusters != nullptr || output.cluster_labels != nullptr)) {
+    const Clusters clusters = findClusters(fish, sim_param.length, sim_param.cluster_radius);
+    if (output.clusters != nullptr) { writeClusters(*output.clusters, step, time, clusters); }
+    if (output.cluster_labels != nullptr) { writeClusterLabels(*output.cluster_labels, clusters); }
+  }
+  if (sim_param.field_resolution > 0 && output.field != nullptr) {
+    writeVoxelField(*output.field, step, time, computeVoxelField(fish, sim_param.length, sim_param.field_resolution));
+  }
+  if (output.radial_distribution != nullptr) { output.radial_distribution->accumulate(fish, sim_param.length); }
+}
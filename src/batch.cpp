@@ -0,0 +1,344 @@
+#include "batch.hpp"
+
+#include "coordinate.hpp"
+#include "cpu.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t lanes = ReplicaBatch::lanes;
+using LaneParams = ReplicaBatch::LaneParams;
+using State = ReplicaBatch::State;
+using Nearest = ReplicaBatch::Nearest;
+template<typename T> using LaneArray = ReplicaBatch::LaneArray<T>;
+
+// Minimum image displacement from a to b along one axis, shifting b by the length as the all-pairs sweep does.
+// The shift is the length times -1, 0 or 1, which is exact, as chained selects of the shift itself are turned back
+// into branches by the compiler.
+[[gnu::always_inline]] inline double displacement(double a, double b, double length, double half_length)
+{
+  const double d = b - a;
+  const double up = d < -half_length ? 1.0 : 0.0;
+  const double direction = d > half_length ? -1.0 : up;
+  return (b + length * direction) - a;
+}
+
+// The interactions of every fish with every other fish of its lane, each step of calcDeltaVelocitiesAllPairs()
+// written for all the lanes at once with the branches turned into selects. Adding a zero in the lanes the step does
+// not apply to leaves their sums unchanged.
+// Always inlined, so that each of the copies below is vectorized for its own instruction set.
+[[gnu::always_inline]] inline void calcDeltaVelocitiesLanes(State &state,
+  Nearest &nearest,
+  const LaneParams &params,
+  std::size_t n_fish,
+  unsigned int max_cog,
+  double length)
+{
+  const double half_length = length / 2;
+  constexpr double infinity = std::numeric_limits<double>::infinity();
+  auto &[pos_x, pos_y, pos_z, vel_x, vel_y, vel_z, delta_x, delta_y, delta_z, lambda] = state;
+  auto &[nearest_distance, nearest_index] = nearest;
+
+  for (std::size_t i = 0; i < n_fish; i++) {
+    const std::size_t io = i * lanes;
+    LaneArray<double> att_x{};
+    LaneArray<double> att_y{};
+    LaneArray<double> att_z{};
+    LaneArray<double> n_attraction{};
+    std::fill(nearest_distance.begin(), nearest_distance.end(), infinity);
+    std::fill(nearest_index.begin(), nearest_index.end(), 0.0);
+
+    for (std::size_t j = 0; j < n_fish; j++) {
+      const std::size_t jo = j * lanes;
+      LaneArray<double> candidate_distance{};
+      LaneArray<double> candidate_index{};
+
+#pragma omp simd
+      for (std::size_t l = 0; l < lanes; l++) {
+        const double rx = displacement(pos_x[io + l], pos_x[jo + l], length, half_length);
+        const double ry = displacement(pos_y[io + l], pos_y[jo + l], length, half_length);
+        const double rz = displacement(pos_z[io + l], pos_z[jo + l], length, half_length);
+        const double squared_distance = (rx * rx) + (ry * ry) + (rz * rz);
+        const double distance = std::sqrt(squared_distance);
+
+        const bool within = squared_distance <= params.squared_attraction_radius[l];
+        const bool attracts = within & (squared_distance >= params.squared_repulsion_radius[l]);
+        // Weighted rather than selected, which the compiler would turn back into branches. The weighted terms are
+        // finite, so that a zero weight adds a zero.
+        const double weight = attracts ? 1.0 : 0.0;
+        const double scale = params.vel_escape[l] / (attracts ? distance : 1.0);
+        att_x[l] += weight * ((scale * rx) - vel_x[io + l]);
+        att_y[l] += weight * ((scale * ry) - vel_y[io + l]);
+        att_z[l] += weight * ((scale * rz) - vel_z[io + l]);
+        n_attraction[l] += weight;
+
+        const bool repels = within & (squared_distance < params.squared_repulsion_radius[l]) & (j != i);
+        candidate_distance[l] = repels ? distance : infinity;
+        candidate_index[l] = static_cast<double>(j);
+      }
+
+      // Insert the candidates into the sorted nearest fish, swapping them down past the farther ones. Few pairs are
+      // within the repulsion radius in any lane.
+      if (std::none_of(candidate_distance.begin(), candidate_distance.end(), [](double d) { return d < infinity; })) {
+        continue;
+      }
+      for (std::size_t k = 0; k < max_cog; k++) {
+#pragma omp simd
+        for (std::size_t l = 0; l < lanes; l++) {
+          const double distance = nearest_distance[k * lanes + l];
+          const double index = nearest_index[k * lanes + l];
+          const bool nearer = (candidate_distance[l] < distance)
+                              | ((candidate_distance[l] == distance) & (candidate_index[l] < index));
+          nearest_distance[k * lanes + l] = nearer ? candidate_distance[l] : distance;
+          nearest_index[k * lanes + l] = nearer ? candidate_index[l] : index;
+          candidate_distance[l] = nearer ? distance : candidate_distance[l];
+          candidate_index[l] = nearer ? index : candidate_index[l];
+        }
+      }
+    }
+
+    // Repulsion with up to n_cog nearest fish, in the order of their distance
+    LaneArray<double> rep_x{};
+    LaneArray<double> rep_y{};
+    LaneArray<double> rep_z{};
+    LaneArray<double> n_nearest{};
+    for (std::size_t k = 0; k < max_cog; k++) {
+#pragma omp simd
+      for (std::size_t l = 0; l < lanes; l++) {
+        const double distance = nearest_distance[k * lanes + l];
+        const bool active = (static_cast<double>(k) < params.n_cog[l]) & (distance < infinity);
+        const std::size_t jo = static_cast<std::size_t>(nearest_index[k * lanes + l]) * lanes;
+        const double rx = displacement(pos_x[io + l], pos_x[jo + l], length, half_length);
+        const double ry = displacement(pos_y[io + l], pos_y[jo + l], length, half_length);
+        const double rz = displacement(pos_z[io + l], pos_z[jo + l], length, half_length);
+        const double g_factor = distance <= params.body_length[l] ? params.body_length[l] / distance : 1.;
+        const double scale = params.vel_repulsion[l] / distance;
+        rep_x[l] += active ? g_factor * (vel_x[jo + l] - vel_x[io + l]) : 0.0;
+        rep_y[l] += active ? g_factor * (vel_y[jo + l] - vel_y[io + l]) : 0.0;
+        rep_z[l] += active ? g_factor * (vel_z[jo + l] - vel_z[io + l]) : 0.0;
+        rep_x[l] += active ? g_factor * ((scale * -rx) - vel_x[io + l]) : 0.0;
+        rep_y[l] += active ? g_factor * ((scale * -ry) - vel_y[io + l]) : 0.0;
+        rep_z[l] += active ? g_factor * ((scale * -rz) - vel_z[io + l]) : 0.0;
+        n_nearest[l] += active ? 1.0 : 0.0;
+      }
+    }
+
+#pragma omp simd
+    for (std::size_t l = 0; l < lanes; l++) {
+      const double vx = vel_x[io + l];
+      const double vy = vel_y[io + l];
+      const double vz = vel_z[io + l];
+      const bool any_nearest = n_nearest[l] != 0;
+      const double repulsion_x = any_nearest ? rep_x[l] / n_nearest[l] : rep_x[l];
+      const double repulsion_y = any_nearest ? rep_y[l] / n_nearest[l] : rep_y[l];
+      const double repulsion_z = any_nearest ? rep_z[l] / n_nearest[l] : rep_z[l];
+
+      const double self_scale = params.vel_standard[l] / std::sqrt((vx * vx) + (vy * vy) + (vz * vz)) - 1;
+      const double fish_lambda = n_nearest[l] < params.n_cog[l] ? params.attraction_str[l] : lambda[io + l];
+      lambda[io + l] = fish_lambda;
+
+      const bool attracted = (fish_lambda > 0) & (n_attraction[l] != 0);
+      const double sum_x = (self_scale * vx) + repulsion_x;
+      const double sum_y = (self_scale * vy) + repulsion_y;
+      const double sum_z = (self_scale * vz) + repulsion_z;
+      delta_x[io + l] = attracted ? sum_x + ((fish_lambda * att_x[l]) / n_attraction[l]) : sum_x;
+      delta_y[io + l] = attracted ? sum_y + ((fish_lambda * att_y[l]) / n_attraction[l]) : sum_y;
+      delta_z[io + l] = attracted ? sum_z + ((fish_lambda * att_z[l]) / n_attraction[l]) : sum_z;
+    }
+  }
+}
+
+using CalcDeltaVelocitiesLanes =
+  void (*)(State &, Nearest &, const LaneParams &, std::size_t, unsigned int, double);
+
+void calcDeltaVelocitiesGeneric(State &state,
+  Nearest &nearest,
+  const LaneParams &params,
+  std::size_t n_fish,
+  unsigned int max_cog,
+  double length)
+{
+  calcDeltaVelocitiesLanes(state, nearest, params, n_fish, max_cog, length);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+[[gnu::target("avx2")]] void calcDeltaVelocitiesAVX2(State &state,
+  Nearest &nearest,
+  const LaneParams &params,
+  std::size_t n_fish,
+  unsigned int max_cog,
+  double length)
+{
+  calcDeltaVelocitiesLanes(state, nearest, params, n_fish, max_cog, length);
+}
+
+[[gnu::target("avx512f")]] void calcDeltaVelocitiesAVX512(State &state,
+  Nearest &nearest,
+  const LaneParams &params,
+  std::size_t n_fish,
+  unsigned int max_cog,
+  double length)
+{
+  calcDeltaVelocitiesLanes(state, nearest, params, n_fish, max_cog, length);
+}
+#endif
+
+// Copy of the kernel compiled for the SIMD level in use. The 8 lanes fill two AVX2 or one AVX-512 register, and
+// SSE4.2 adds nothing over the SSE2 of the generic copy for doubles.
+CalcDeltaVelocitiesLanes selectCalcDeltaVelocities()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  switch (getSimdLevel()) {
+  case SimdLevel::AVX512:
+    return calcDeltaVelocitiesAVX512;
+  case SimdLevel::AVX2:
+    return calcDeltaVelocitiesAVX2;
+  default:
+    break;
+  }
+#endif
+  return calcDeltaVelocitiesGeneric;
+}
+
+}// namespace
+
+ReplicaBatch::ReplicaBatch(const SimParam &sim_param, const std::vector<FishParam> &fish_params)
+  : m_sim_param(sim_param), m_n_replicas(fish_params.size()), m_n_fish(sim_param.n_fish), m_max_cog(0)
+{
+  assert(!fish_params.empty() && fish_params.size() <= lanes);
+  for (std::size_t l = 0; l < lanes; l++) {
+    const FishParam &fish_param = fish_params[std::min(l, m_n_replicas - 1)];
+    m_params.vel_standard[l] = fish_param.vel_standard;
+    m_params.vel_repulsion[l] = fish_param.vel_repulsion;
+    m_params.vel_escape[l] = fish_param.vel_escape;
+    m_params.body_length[l] = fish_param.body_length;
+    m_params.squared_repulsion_radius[l] = fish_param.repulsion_radius * fish_param.repulsion_radius;
+    m_params.squared_attraction_radius[l] = fish_param.attraction_radius * fish_param.attraction_radius;
+    m_params.n_cog[l] = fish_param.n_cog;
+    m_params.attraction_str[l] = fish_param.attraction_str;
+    m_params.lambda_rate[l] = fish_param.attraction_str / fish_param.attraction_duration;
+    m_max_cog = std::max(m_max_cog, fish_param.n_cog);
+  }
+
+  const std::size_t size = m_n_fish * lanes;
+  for (auto *array : { &m_state.pos_x,
+         &m_state.pos_y,
+         &m_state.pos_z,
+         &m_state.vel_x,
+         &m_state.vel_y,
+         &m_state.vel_z,
+         &m_state.delta_x,
+         &m_state.delta_y,
+         &m_state.delta_z,
+         &m_state.lambda }) {
+    array->assign(size, 0.0);
+  }
+  m_nearest.distance.resize(static_cast<std::size_t>(m_max_cog) * lanes);
+  m_nearest.index.resize(static_cast<std::size_t>(m_max_cog) * lanes);
+}
+
+void ReplicaBatch::setSchool(std::size_t replica, const School &fish)
+{
+  assert(replica < m_n_replicas && fish.size() == m_n_fish);
+
+  // The last replica also fills the lanes beyond the replicas, which keeps their arithmetic finite
+  const std::size_t last_lane = replica + 1 == m_n_replicas ? lanes : replica + 1;
+  for (std::size_t l = replica; l < last_lane; l++) {
+    for (std::size_t i = 0; i < m_n_fish; i++) {
+      const std::size_t index = i * lanes + l;
+      m_state.pos_x[index] = fish[i].getPosition().x;
+      m_state.pos_y[index] = fish[i].getPosition().y;
+      m_state.pos_z[index] = fish[i].getPosition().z;
+      m_state.vel_x[index] = fish[i].getVelocity().x;
+      m_state.vel_y[index] = fish[i].getVelocity().y;
+      m_state.vel_z[index] = fish[i].getVelocity().z;
+      m_state.delta_x[index] = fish[i].getDeltaVelocity().x;
+      m_state.delta_y[index] = fish[i].getDeltaVelocity().y;
+      m_state.delta_z[index] = fish[i].getDeltaVelocity().z;
+      m_state.lambda[index] = fish[i].getLambda();
+    }
+  }
+}
+
+School ReplicaBatch::getSchool(std::size_t replica) const
+{
+  assert(replica < m_n_replicas);
+  School fish(m_n_fish, Fish{});
+  for (std::size_t i = 0; i < m_n_fish; i++) {
+    const std::size_t index = i * lanes + replica;
+    fish[i] = Fish({ .x = m_state.pos_x[index], .y = m_state.pos_y[index], .z = m_state.pos_z[index] },
+      { .x = m_state.vel_x[index], .y = m_state.vel_y[index], .z = m_state.vel_z[index] },
+      { .x = m_state.delta_x[index], .y = m_state.delta_y[index], .z = m_state.delta_z[index] },
+      m_state.lambda[index]);
+  }
+  return fish;
+}
+
+void ReplicaBatch::calcDeltaVelocities()
+{
+  selectCalcDeltaVelocities()(
+    m_state, m_nearest, m_params, m_n_fish, m_max_cog, static_cast<double>(m_sim_param.length));
+}
+
+void ReplicaBatch::update()
+{
+  const double delta_t = m_sim_param.delta_t;
+  const auto length = static_cast<double>(m_sim_param.length);
+  auto &[pos_x, pos_y, pos_z, vel_x, vel_y, vel_z, delta_x, delta_y, delta_z, lambda] = m_state;
+
+  for (std::size_t i = 0; i < m_n_fish; i++) {
+#pragma omp simd
+    for (std::size_t l = 0; l < lanes; l++) {
+      const std::size_t index = i * lanes + l;
+      vel_x[index] += delta_t * delta_x[index];
+      vel_y[index] += delta_t * delta_y[index];
+      vel_z[index] += delta_t * delta_z[index];
+      delta_x[index] = 0;
+      delta_y[index] = 0;
+      delta_z[index] = 0;
+
+      // Account for the periodic boundary conditions, as periodic()
+      const double x = pos_x[index] + delta_t * vel_x[index];
+      const double y = pos_y[index] + delta_t * vel_y[index];
+      const double z = pos_z[index] + delta_t * vel_z[index];
+      pos_x[index] = x < 0 ? x + length : (x >= length ? x - length : x);
+      pos_y[index] = y < 0 ? y + length : (y >= length ? y - length : y);
+      pos_z[index] = z < 0 ? z + length : (z >= length ? z - length : z);
+
+      const double decayed = lambda[index] - m_params.lambda_rate[l] * delta_t;
+      lambda[index] = decayed > 0 ? decayed : 0;
+    }
+  }
+}
+
+void ReplicaBatch::writeSnapshot(std::size_t replica, std::ostream &output) const
+{
+  for (std::size_t i = 0; i < m_n_fish; i++) {
+    const std::size_t index = i * lanes + replica;
+    output << m_state.pos_x[index] << " " << m_state.pos_y[index] << " " << m_state.pos_z[index] << " "
+           << m_state.vel_x[index] << " " << m_state.vel_y[index] << " " << m_state.vel_z[index] << '\n';
+  }
+}
+
+void simulate(ReplicaBatch &batch, const std::vector<std::ostream *> &outputs)
+{
+  const SimParam &sim_param = batch.getSimParam();
+  for (unsigned int time_step = 0; time_step < sim_param.max_steps; time_step++) {
+    batch.calcDeltaVelocities();
+    batch.update();
+
+    if (time_step % sim_param.snapshot_interval == 0) {
+      for (std::size_t replica = 0; replica < batch.getReplicaCount(); replica++) {
+        batch.writeSnapshot(replica, *outputs[replica]);
+      }
+    }
+  }
+}
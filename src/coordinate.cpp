@@ -2,35 +2,38 @@
 
 #include <algorithm>
 #include <array>
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <vector>
 
-Vect3 operator+(const Vect3 &lhs, const Vect3 &rhs)
+template<typename T> BasicVect3<T> operator+(const BasicVect3<T> &lhs, const BasicVect3<T> &rhs)
 {
   return { .x = lhs.x + rhs.x, .y = lhs.y + rhs.y, .z = lhs.z + rhs.z };
 }
 
-Vect3 operator-(const Vect3 &lhs, const Vect3 &rhs)
+template<typename T> BasicVect3<T> operator-(const BasicVect3<T> &lhs, const BasicVect3<T> &rhs)
 {
   return { .x = lhs.x - rhs.x, .y = lhs.y - rhs.y, .z = lhs.z - rhs.z };
 }
 
-Vect3 operator*(double scalar, const Vect3 &rhs)
+template<typename T> BasicVect3<T> operator*(std::type_identity_t<T> scalar, const BasicVect3<T> &rhs)
 {
   return { .x = scalar * rhs.x, .y = scalar * rhs.y, .z = scalar * rhs.z };
 }
 
-Vect3 operator*(const Vect3 &lhs, double scalar)
+template<typename T> BasicVect3<T> operator*(const BasicVect3<T> &lhs, std::type_identity_t<T> scalar)
 {
   return { .x = scalar * lhs.x, .y = scalar * lhs.y, .z = scalar * lhs.z };
 }
 
-Vect3 operator/(const Vect3 &lhs, double scalar)
+template<typename T> BasicVect3<T> operator/(const BasicVect3<T> &lhs, std::type_identity_t<T> scalar)
 {
   return { .x = lhs.x / scalar, .y = lhs.y / scalar, .z = lhs.z / scalar };
 }
 
-Vect3 operator+=(Vect3 &lhs, const Vect3 &rhs)
+template<typename T> BasicVect3<T> operator+=(BasicVect3<T> &lhs, const BasicVect3<T> &rhs)
 {
   lhs.x += rhs.x;
   lhs.y += rhs.y;
@@ -38,7 +41,7 @@ Vect3 operator+=(Vect3 &lhs, const Vect3 &rhs)
   return lhs;
 }
 
-Vect3 operator-=(Vect3 &lhs, const Vect3 &rhs)
+template<typename T> BasicVect3<T> operator-=(BasicVect3<T> &lhs, const BasicVect3<T> &rhs)
 {
   lhs.x -= rhs.x;
   lhs.y -= rhs.y;
@@ -46,7 +49,7 @@ Vect3 operator-=(Vect3 &lhs, const Vect3 &rhs)
   return lhs;
 }
 
-Vect3 operator*=(Vect3 &lhs, double scalar)
+template<typename T> BasicVect3<T> operator*=(BasicVect3<T> &lhs, std::type_identity_t<T> scalar)
 {
   lhs.x *= scalar;
   lhs.y *= scalar;
@@ -54,7 +57,7 @@ Vect3 operator*=(Vect3 &lhs, double scalar)
   return lhs;
 }
 
-Vect3 operator/=(Vect3 &lhs, double scalar)
+template<typename T> BasicVect3<T> operator/=(BasicVect3<T> &lhs, std::type_identity_t<T> scalar)
 {
   lhs.x /= scalar;
   lhs.y /= scalar;
@@ -62,24 +65,24 @@ Vect3 operator/=(Vect3 &lhs, double scalar)
   return lhs;
 }
 
-Vect3 periodic(const Vect3 &vect, unsigned int len)
+template<typename T> BasicVect3<T> periodic(const BasicVect3<T> &vect, unsigned int len)
 {
-  auto len_f = static_cast<double>(len);
-  double x = vect.x;
+  auto len_f = static_cast<T>(len);
+  T x = vect.x;
   if (x < 0) {
     x += len_f;
   } else if (x >= len_f) {
     x -= len_f;
   }
 
-  double y = vect.y;
+  T y = vect.y;
   if (y < 0) {
     y += len_f;
   } else if (y >= len_f) {
     y -= len_f;
   }
 
-  double z = vect.z;
+  T z = vect.z;
   if (z < 0) {
     z += len_f;
   } else if (z >= len_f) {
@@ -89,42 +92,64 @@ Vect3 periodic(const Vect3 &vect, unsigned int len)
   return { .x = x, .y = y, .z = z };
 }
 
-double absolute(const Vect3 &vect) { return std::sqrt((vect.x * vect.x) + (vect.y * vect.y) + (vect.z * vect.z)); }
+template<typename T> T absolute(const BasicVect3<T> &vect)
+{
+  return std::sqrt((vect.x * vect.x) + (vect.y * vect.y) + (vect.z * vect.z));
+}
 
-Vect3 normalize(const Vect3 &vect)
+template<typename T> BasicVect3<T> normalize(const BasicVect3<T> &vect)
 {
   if (vect.x == 0 && vect.y == 0 && vect.z == 0) { return vect; }
 
-  const double magnitude = absolute(vect);
+  const T magnitude = absolute(vect);
   return { .x = vect.x / magnitude, .y = vect.y / magnitude, .z = vect.z / magnitude };
 }
 
-Vect3 vect12(const Vect3 &vect1, const Vect3 &vect2)
+template<typename T> BasicVect3<T> vect12(const BasicVect3<T> &vect1, const BasicVect3<T> &vect2)
 {
   return { .x = vect2.x - vect1.x, .y = vect2.y - vect1.y, .z = vect2.z - vect1.z };
 }
 
-Vect3 vect12(const Vect3 &vect1, Vect3 vect2, unsigned int len)
+// Instantiate the vector operations for the scalars that the fish are stored in
+template BasicVect3<double> operator+(const BasicVect3<double> &lhs, const BasicVect3<double> &rhs);
+template BasicVect3<double> operator-(const BasicVect3<double> &lhs, const BasicVect3<double> &rhs);
+template BasicVect3<double> operator*(double scalar, const BasicVect3<double> &rhs);
+template BasicVect3<double> operator*(const BasicVect3<double> &lhs, double scalar);
+template BasicVect3<double> operator/(const BasicVect3<double> &lhs, double scalar);
+template BasicVect3<double> operator+=(BasicVect3<double> &lhs, const BasicVect3<double> &rhs);
+template BasicVect3<double> operator-=(BasicVect3<double> &lhs, const BasicVect3<double> &rhs);
+template BasicVect3<double> operator*=(BasicVect3<double> &lhs, double scalar);
+template BasicVect3<double> operator/=(BasicVect3<double> &lhs, double scalar);
+template BasicVect3<double> periodic(const BasicVect3<double> &vect, unsigned int len);
+template double absolute(const BasicVect3<double> &vect);
+template BasicVect3<double> normalize(const BasicVect3<double> &vect);
+
+template BasicVect3<float> operator+(const BasicVect3<float> &lhs, const BasicVect3<float> &rhs);
+template BasicVect3<float> operator-(const BasicVect3<float> &lhs, const BasicVect3<float> &rhs);
+template BasicVect3<float> operator*(float scalar, const BasicVect3<float> &rhs);
+template BasicVect3<float> operator*(const BasicVect3<float> &lhs, float scalar);
+template BasicVect3<float> operator/(const BasicVect3<float> &lhs, float scalar);
+template BasicVect3<float> operator+=(BasicVect3<float> &lhs, const BasicVect3<float> &rhs);
+template BasicVect3<float> operator-=(BasicVect3<float> &lhs, const BasicVect3<float> &rhs);
+template BasicVect3<float> operator*=(BasicVect3<float> &lhs, float scalar);
+template BasicVect3<float> operator/=(BasicVect3<float> &lhs, float scalar);
+template BasicVect3<float> periodic(const BasicVect3<float> &vect, unsigned int len);
+template float absolute(const BasicVect3<float> &vect);
+template BasicVect3<float> normalize(const BasicVect3<float> &vect);
+
+FixedVect3 toFixed(const Vect3 &vect, unsigned int len)
 {
-  const Vect3 temp_vect = vect12(vect1, vect2);
-
-  if (temp_vect.x > static_cast<double>(len) / 2) {
-    vect2.x -= len;
-  } else if (temp_vect.x < -static_cast<double>(len) / 2) {
-    vect2.x += len;
-  }
-  if (temp_vect.y > static_cast<double>(len) / 2) {
-    vect2.y -= len;
-  } else if (temp_vect.y < -static_cast<double>(len) / 2) {
-    vect2.y += len;
-  }
-  if (temp_vect.z > static_cast<double>(len) / 2) {
-    vect2.z -= len;
-  } else if (temp_vect.z < -static_cast<double>(len) / 2) {
-    vect2.z += len;
-  }
+  // Rounding to a 64-bit integer and keeping the lower 32 bits wraps the coordinate around the box
+  const double scale = fixed_steps / static_cast<double>(len);
+  return { .x = static_cast<std::uint32_t>(std::llround(vect.x * scale)),
+    .y = static_cast<std::uint32_t>(std::llround(vect.y * scale)),
+    .z = static_cast<std::uint32_t>(std::llround(vect.z * scale)) };
+}
 
-  return vect12(vect1, vect2);
+Vect3 fromFixed(const FixedVect3 &vect, unsigned int len)
+{
+  const double scale = static_cast<double>(len) / fixed_steps;
+  return { .x = vect.x * scale, .y = vect.y * scale, .z = vect.z * scale };
 }
 
 unsigned int countInside(const std::array<int, 3> &cell, double radius, const Vect3 &center, bool count_boundary)
@@ -413,3 +438,60 @@ std::vector<std::array<int, 3>> getInnerBetween(double radius1, double radius2)
 
   return inner_2;
 }
+
+std::vector<StencilRun> getStencilRuns(const std::vector<std::array<int, 3>> &cells)
+{
+  auto sorted_cells = cells;
+  std::sort(sorted_cells.begin(), sorted_cells.end());
+  sorted_cells.erase(std::unique(sorted_cells.begin(), sorted_cells.end()), sorted_cells.end());
+
+  std::vector<StencilRun> runs{};
+  for (const auto &cell : sorted_cells) {
+    // Extend the last run if the cell directly follows it along z
+    if (!runs.empty() && runs.back().dx == cell[0] && runs.back().dy == cell[1] && runs.back().z_end + 1 == cell[2]) {
+      runs.back().z_end = cell[2];
+    } else {
+      runs.push_back({ .dx = cell[0], .dy = cell[1], .z_begin = cell[2], .z_end = cell[2] });
+    }
+  }
+
+  return runs;
+}
+
+unsigned int getStencilReach(const std::vector<std::array<int, 3>> &cells)
+{
+  int reach = 0;
+  for (const auto &cell : cells) {
+    for (const auto offset : cell) { reach = std::max(reach, std::abs(offset)); }
+  }
+  return static_cast<unsigned int>(reach);
+}
+
+std::vector<unsigned int> getWrapTable(unsigned int len, unsigned int reach)
+{
+  assert(len > 0);
+
+  std::vector<unsigned int> wrap_table(len + 2 * reach);
+  // Shift by a multiple of len so that the operand stays non-negative even when reach > len
+  const unsigned int shift = len - reach % len;
+  for (unsigned int i = 0; i < wrap_table.size(); i++) { wrap_table[i] = (i + shift) % len; }
+
+  return wrap_table;
+}
+
+unsigned int getCellsPerSide(unsigned int length, double min_cell_size)
+{
+  assert(min_cell_size > 0);
+  return std::max(1U, static_cast<unsigned int>(static_cast<double>(length) / min_cell_size));
+}
+
+std::vector<StencilRun> getNeighbourRuns(unsigned int cells_per_side)
+{
+  const int last = std::min(1, static_cast<int>(cells_per_side) - 2);
+
+  std::vector<StencilRun> runs{};
+  for (int dx = -1; dx <= last; dx++) {
+    for (int dy = -1; dy <= last; dy++) { runs.push_back({ .dx = dx, .dy = dy, .z_begin = -1, .z_end = last }); }
+  }
+  return runs;
+}
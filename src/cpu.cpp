@@ -0,0 +1,109 @@
+#include "cpu.hpp"
+
+#include "simulation.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <omp.h>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+
+SimdLevel detectSimdLevel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") != 0) { return SimdLevel::AVX512; }
+  if (__builtin_cpu_supports("avx2") != 0) { return SimdLevel::AVX2; }
+  if (__builtin_cpu_supports("sse4.2") != 0) { return SimdLevel::SSE42; }
+#endif
+  return SimdLevel::Generic;
+}
+
+SimdLevel &activeSimdLevel()
+{
+  static SimdLevel level = getSupportedSimdLevel();
+  return level;
+}
+
+}// namespace
+
+SimdLevel getSupportedSimdLevel()
+{
+  static const SimdLevel supported = detectSimdLevel();
+  return supported;
+}
+
+SimdLevel getSimdLevel() { return activeSimdLevel(); }
+
+int setSimdLevel(SimdLevel level)
+{
+  if (level > getSupportedSimdLevel()) { return EXIT_FAILURE; }
+  activeSimdLevel() = level;
+  return EXIT_SUCCESS;
+}
+
+int parseSimdLevel(const std::string &name, SimdLevel &level)
+{
+  if (name == "generic") {
+    level = SimdLevel::Generic;
+  } else if (name == "sse4.2") {
+    level = SimdLevel::SSE42;
+  } else if (name == "avx2") {
+    level = SimdLevel::AVX2;
+  } else if (name == "avx512") {
+    level = SimdLevel::AVX512;
+  } else {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+std::string toString(SimdLevel level)
+{
+  switch (level) {
+  case SimdLevel::SSE42:
+    return "sse4.2";
+  case SimdLevel::AVX2:
+    return "avx2";
+  case SimdLevel::AVX512:
+    return "avx512";
+  default:
+    return "generic";
+  }
+}
+
+int pinThreads(ThreadAffinity affinity)
+{
+  if (affinity == ThreadAffinity::None) { return EXIT_SUCCESS; }
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) { return EXIT_FAILURE; }
+  std::vector<std::size_t> processors{};
+  for (std::size_t processor = 0; processor < static_cast<std::size_t>(CPU_SETSIZE); processor++) {
+    if (CPU_ISSET(processor, &allowed)) { processors.push_back(processor); }
+  }
+
+  int failures = 0;
+#pragma omp parallel default(none) shared(affinity, processors) reduction(+ : failures)
+  {
+    const auto thread = static_cast<std::size_t>(omp_get_thread_num());
+    const auto n_threads = static_cast<std::size_t>(omp_get_num_threads());
+    const std::size_t slot =
+      affinity == ThreadAffinity::Close ? thread % processors.size() : thread * processors.size() / n_threads;
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(processors[slot], &pinned);
+    if (sched_setaffinity(0, sizeof(pinned), &pinned) != 0) { failures++; }
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+#else
+  return EXIT_FAILURE;
+#endif
+}
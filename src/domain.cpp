@@ -0,0 +1,170 @@
+#include "domain.hpp"
+
+#include "fish.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <mpi.h>
+#include <vector>
+
+SlabDecomposition::SlabDecomposition(MPI_Comm comm, unsigned int length, double halo_width)
+  : m_comm(comm), m_length(length), m_halo_width(halo_width)
+{
+  MPI_Comm_rank(m_comm, &m_rank);
+  MPI_Comm_size(m_comm, &m_size);
+  const auto size = static_cast<std::size_t>(m_size);
+
+  // The fish are sent as raw bytes, which is fine as every rank runs the same binary
+  MPI_Type_contiguous(static_cast<int>(sizeof(Fish)), MPI_BYTE, &m_fish_type);
+  MPI_Type_commit(&m_fish_type);
+
+  m_bounds.resize(size + 1);
+  for (std::size_t rank = 0; rank <= size; rank++) {
+    m_bounds[rank] = static_cast<double>(m_length) * static_cast<double>(rank) / static_cast<double>(size);
+  }
+
+  m_leaving.resize(size);
+  m_send_counts.resize(size);
+  m_send_displacements.resize(size);
+  m_receive_counts.resize(size);
+  m_receive_displacements.resize(size);
+}
+
+SlabDecomposition::~SlabDecomposition() { MPI_Type_free(&m_fish_type); }
+
+int SlabDecomposition::getOwner(double x) const
+{
+  // The first bound above x is the upper bound of its slab
+  const auto upper = std::upper_bound(m_bounds.begin() + 1, m_bounds.end() - 1, x);
+  return static_cast<int>(upper - m_bounds.begin() - 1);
+}
+
+double SlabDecomposition::distanceToSlab(double x, int rank) const
+{
+  const auto length = static_cast<double>(m_length);
+  const double lower = m_bounds[static_cast<std::size_t>(rank)];
+  const double upper = m_bounds[static_cast<std::size_t>(rank) + 1];
+  if (lower >= upper) { return length; }// Empty slab
+  const double right = std::fmod(lower - x + length, length);
+  const double left = std::fmod(x - upper + length, length);
+  return std::min(right, left);
+}
+
+void SlabDecomposition::exchange()
+{
+  const auto size = static_cast<std::size_t>(m_size);
+  MPI_Alltoall(m_send_counts.data(), 1, MPI_INT, m_receive_counts.data(), 1, MPI_INT, m_comm);
+
+  int n_send = 0;
+  int n_receive = 0;
+  for (std::size_t rank = 0; rank < size; rank++) {
+    m_send_displacements[rank] = n_send;
+    m_receive_displacements[rank] = n_receive;
+    n_send += m_send_counts[rank];
+    n_receive += m_receive_counts[rank];
+  }
+  m_receive.resize(static_cast<std::size_t>(n_receive));
+
+  MPI_Alltoallv(m_send.data(),
+    m_send_counts.data(),
+    m_send_displacements.data(),
+    m_fish_type,
+    m_receive.data(),
+    m_receive_counts.data(),
+    m_receive_displacements.data(),
+    m_fish_type,
+    m_comm);
+}
+
+void SlabDecomposition::migrate(School &fish)
+{
+  const auto size = static_cast<std::size_t>(m_size);
+  std::fill(m_send_counts.begin(), m_send_counts.end(), 0);
+  m_send.clear();
+
+  // Move the fish that stay to the front, and sort the others by their new owner
+  for (auto &leaving : m_leaving) { leaving.clear(); }
+  std::size_t n_staying = 0;
+  for (const auto &one_fish : fish) {
+    const int owner = getOwner(one_fish.getPosition().x);
+    if (owner == m_rank) {
+      fish[n_staying++] = one_fish;
+    } else {
+      m_leaving[static_cast<std::size_t>(owner)].push_back(one_fish);
+    }
+  }
+  for (std::size_t rank = 0; rank < size; rank++) {
+    m_send_counts[rank] = static_cast<int>(m_leaving[rank].size());
+    m_send.insert(m_send.end(), m_leaving[rank].begin(), m_leaving[rank].end());
+  }
+  fish.resize(n_staying);
+
+  exchange();
+  fish.insert(fish.end(), m_receive.begin(), m_receive.end());
+}
+
+std::size_t SlabDecomposition::appendHalo(School &fish)
+{
+  const auto size = static_cast<std::size_t>(m_size);
+  std::fill(m_send_counts.begin(), m_send_counts.end(), 0);
+  m_send.clear();
+
+  // A fish may be in the halo of several slabs, which are narrower than the halo or at both ends of the box
+  for (std::size_t rank = 0; rank < size; rank++) {
+    if (static_cast<int>(rank) == m_rank) { continue; }
+    for (const auto &one_fish : fish) {
+      if (distanceToSlab(one_fish.getPosition().x, static_cast<int>(rank)) <= m_halo_width) {
+        m_send.push_back(one_fish);
+        m_send_counts[rank]++;
+      }
+    }
+  }
+
+  exchange();
+  const std::size_t n_owned = fish.size();
+  fish.insert(fish.end(), m_receive.begin(), m_receive.end());
+  return n_owned;
+}
+
+double SlabDecomposition::getImbalance(const School &fish) const
+{
+  auto n_fish = static_cast<unsigned long long>(fish.size());
+  unsigned long long most = 0;
+  unsigned long long total = 0;
+  MPI_Allreduce(&n_fish, &most, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, m_comm);
+  MPI_Allreduce(&n_fish, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, m_comm);
+  if (total == 0) { return 1.0; }
+  return static_cast<double>(most) * m_size / static_cast<double>(total);
+}
+
+void SlabDecomposition::rebalance(School &fish)
+{
+  const auto size = static_cast<std::size_t>(m_size);
+
+  // Histogram of the fish along x over the whole box
+  const std::size_t n_bins = std::size_t{ m_length } * bins_per_unit;
+  std::vector<unsigned long long> histogram(n_bins, 0);
+  for (const auto &one_fish : fish) {
+    const auto bin = static_cast<std::size_t>(one_fish.getPosition().x * bins_per_unit);
+    histogram[std::min(bin, n_bins - 1)]++;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, histogram.data(), static_cast<int>(n_bins), MPI_UNSIGNED_LONG_LONG, MPI_SUM, m_comm);
+
+  unsigned long long total = 0;
+  for (const auto count : histogram) { total += count; }
+
+  // Cut the box at the edge of the bin nearest to where the running count passes each multiple of the mean
+  std::size_t rank = 1;
+  unsigned long long running = 0;
+  for (std::size_t bin = 0; bin < n_bins && rank < size; bin++) {
+    const unsigned long long before = running * size;
+    running += histogram[bin];
+    while (rank < size && running * size >= total * rank) {
+      const bool nearer_before = total * rank - std::min(before, total * rank) < running * size - total * rank;
+      m_bounds[rank++] = static_cast<double>(nearer_before ? bin : bin + 1) / bins_per_unit;
+    }
+  }
+  for (; rank < size; rank++) { m_bounds[rank] = static_cast<double>(m_length); }
+
+  migrate(fish);
+}
@@ -0,0 +1,327 @@
+#include "driver.hpp"
+
+#include "analysis.hpp"
+#include "coordinate.hpp"
+#include "eom.hpp"
+#include "fish.hpp"
+#include "grid.hpp"
+#include "kdtree.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+#include <ostream>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Output the position and velocity of the fish on one line
+template<typename F> void writeFish(std::ostream &output, const F &one_fish, unsigned int length)
+{
+  Vect3 position{};
+  if constexpr (std::is_same_v<F, FixedFish>) {
+    position = one_fish.getPosition(length);
+  } else {
+    position = castVect3<double>(one_fish.getPosition());
+  }
+  auto [x, y, z] = position;
+  auto [vx, vy, vz] = one_fish.getVelocity();
+  output << x << " " << y << " " << z << " " << vx << " " << vy << " " << vz << '\n';
+}
+
+// Output the fish positions and velocities, one fish per line
+template<typename F> void writeSnapshot(std::ostream &output, const BasicSchool<F> &fish, unsigned int length)
+{
+  for (const auto &one_fish : fish) { writeFish(output, one_fish, length); }
+}
+
+// Copy of the school in double, whose observables are computed as those of the other schools
+template<typename F> School toSchool(const BasicSchool<F> &fish, unsigned int length)
+{
+  School copy(fish.size(), Fish{});
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    if constexpr (std::is_same_v<F, FixedFish>) {
+      copy[i].setPosition(fish[i].getPosition(length));
+    } else {
+      copy[i].setPosition(castVect3<double>(fish[i].getPosition()));
+    }
+    copy[i].setVelocity(castVect3<double>(fish[i].getVelocity()));
+  }
+  return copy;
+}
+
+// Output the snapshot after the given number of steps in the output mode of the parameters
+template<typename F>
+void writeSnapshot(std::ostream &output, const BasicSchool<F> &fish, const SimParam &sim_param, unsigned int step)
+{
+  if (sim_param.output_mode == OutputMode::Fish) {
+    writeSnapshot(output, fish, sim_param.length);
+    return;
+  }
+
+  // The occupied voxels, then every n_fish / output_sample-th fish, which are the same fish in every snapshot
+  const double time = step * sim_param.delta_t;
+  if constexpr (std::is_same_v<F, Fish>) {
+    writeVoxelField(output, step, time, computeVoxelField(fish, sim_param.length, sim_param.output_resolution));
+  } else {
+    writeVoxelField(output,
+      step,
+      time,
+      computeVoxelField(toSchool(fish, sim_param.length), sim_param.length, sim_param.output_resolution));
+  }
+  const std::size_t n_sampled = std::min<std::size_t>(sim_param.output_sample, fish.size());
+  output << "# sample " << n_sampled << '\n';
+  for (std::size_t i = 0; i < n_sampled; i++) {
+    writeFish(output, fish[i * fish.size() / n_sampled], sim_param.length);
+  }
+}
+
+// Copy of the school stored as F, or the school itself for Fish
+template<typename F> BasicSchool<F> fromSchool(School fish, unsigned int length)
+{
+  if constexpr (std::is_same_v<F, Fish>) {
+    return fish;
+  } else {
+    BasicSchool<F> copy{};
+    copy.reserve(fish.size());
+    for (const auto &one_fish : fish) {
+      if constexpr (std::is_same_v<F, FixedFish>) {
+        copy.emplace_back(one_fish, length);
+      } else {
+        copy.emplace_back(one_fish);
+      }
+    }
+    return copy;
+  }
+}
+
+// Run the simulation of the school stored as F, see simulate()
+template<typename F>
+void simulateAs(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const Stencils &stencils,
+  std::ostream &output,
+  bool verbose,
+  const AnalysisOutput &analysis)
+{
+  BasicSimulation<F> simulation(sim_param, fish_param, fromSchool<F>(std::move(fish), sim_param.length), stencils);
+  simulation.addObserver(sim_param.snapshot_interval, [&output](const BasicSimulation<F> &observed) {
+    observed.writeSnapshot(output);
+  });
+  if (sim_param.observables_interval > 0) {
+    simulation.addObserver(sim_param.observables_interval, [&analysis](const BasicSimulation<F> &observed) {
+      if constexpr (std::is_same_v<F, Fish>) {
+        analyse(observed.getSchool(), observed.getSimParam(), observed.getStep(), analysis);
+      } else {
+        analyse(toSchool(observed.getSchool(), observed.getSimParam().length),
+          observed.getSimParam(),
+          observed.getStep(),
+          analysis);
+      }
+    });
+  }
+  for (unsigned int time_step = 0; time_step < sim_param.max_steps; time_step++) {
+    if (verbose) { std::cout << "Time step: " << time_step << '\n'; }
+    simulation.step();
+  }
+  if constexpr (std::is_same_v<F, Fish>) {
+    fish = simulation.getSchool();
+  } else {
+    fish = toSchool(simulation.getSchool(), sim_param.length);
+  }
+}
+
+}// namespace
+
+Stencils makeStencils(const SimParam &sim_param, const FishParam &fish_param)
+{
+  // The k-d tree and the all-pairs search need neither the lists nor the stencils
+  Stencils stencils{};
+  if (sim_param.neighbour_search != NeighbourSearch::Cell && sim_param.neighbour_search != NeighbourSearch::Tiled) {
+    return stencils;
+  }
+
+  if (sim_param.cell_grid == CellGrid::TwoLevel) {
+    // Cells at least as wide as the radius, so that the 27 cells around a fish cover the whole zone
+    stencils.fine_side = getCellsPerSide(sim_param.length, fish_param.repulsion_radius);
+    stencils.coarse_side = getCellsPerSide(sim_param.length, fish_param.attraction_radius);
+    stencils.repulsion_runs = getNeighbourRuns(stencils.fine_side);
+    stencils.attractive_runs = getNeighbourRuns(stencils.coarse_side);
+    return stencils;
+  }
+
+  // Pre-generate the relative positions of the neighboring cells
+  auto repulsion_cells = getBoundaryCells(fish_param.repulsion_radius);
+  const auto repulsion_inner = getInnerCells(fish_param.repulsion_radius);
+  repulsion_cells.insert(repulsion_cells.end(), repulsion_inner.begin(), repulsion_inner.end());
+
+  auto attractive_cells = getBoundaryBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
+  const auto attractive_inner = getInnerBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
+  attractive_cells.insert(attractive_cells.end(), attractive_inner.begin(), attractive_inner.end());
+
+  // Compress the stencils into runs along z, each of which is a contiguous range of fish in the cell list
+  stencils.repulsion_runs = getStencilRuns(repulsion_cells);
+  stencils.attractive_runs = getStencilRuns(attractive_cells);
+  stencils.reach = std::max(getStencilReach(repulsion_cells), getStencilReach(attractive_cells));
+  return stencils;
+}
+
+School makeSphere(const SimParam &sim_param, const FishParam &fish_param, std::mt19937 &gen)
+{
+  const double init_r = fish_param.repulsion_radius * cbrt(sim_param.n_fish);
+  std::uniform_real_distribution<double> dis_r(0.0, init_r);
+  std::uniform_real_distribution<double> dis_theta(0.0, 2 * std::numbers::pi);
+  std::uniform_real_distribution<double> dis_phi(0.0, std::numbers::pi);
+
+  // The school is allocated with the pages zeroed by the threads that will handle its fish, so the serial set-up
+  // below does not move them
+  School fish(sim_param.n_fish, Fish{});
+  for (auto &one_fish : fish) {
+    const double r_init = dis_r(gen);
+    const double theta = dis_theta(gen);
+    const double phi = dis_phi(gen);
+    one_fish.setPosition({ .x = r_init * std::sin(phi) * std::cos(theta) + static_cast<double>(sim_param.length) / 2,
+      .y = r_init * std::sin(phi) * std::sin(theta) + static_cast<double>(sim_param.length) / 2,
+      .z = r_init * std::cos(phi) + static_cast<double>(sim_param.length) / 2 });
+    one_fish.setVelocity({ .x = fish_param.vel_standard, .y = 0, .z = 0 });
+  }
+  return fish;
+}
+
+template<typename F>
+BasicSimulation<F>::BasicSimulation(const SimParam &sim_param,
+  const FishParam &fish_param,
+  BasicSchool<F> fish,
+  Stencils stencils)
+  : m_sim_param(sim_param), m_fish_param(fish_param), m_fish(std::move(fish)), m_stencils(std::move(stencils)),
+    m_slack(sim_param.rebuild_interval > 1 ? rebuild_slack : 0)
+{
+  // Cell lists searched for the repulsion and attraction, which are the same list on the unit grid
+  if (sim_param.neighbour_search != NeighbourSearch::Cell && sim_param.neighbour_search != NeighbourSearch::Tiled) {
+    return;
+  }
+  if (m_stencils.fine_side > 0) {
+    m_grids.emplace_back(sim_param.length, m_stencils.fine_side, 1);
+    m_grids.emplace_back(sim_param.length, m_stencils.coarse_side, 1);
+  } else {
+    m_grids.emplace_back(sim_param.length, m_stencils.reach);
+  }
+}
+
+template<typename F>
+BasicSimulation<F>::BasicSimulation(const SimParam &sim_param, const FishParam &fish_param, BasicSchool<F> fish)
+  : BasicSimulation(sim_param, fish_param, std::move(fish), makeStencils(sim_param, fish_param))
+{}
+
+template<typename F> void BasicSimulation<F>::restore(const BasicSchool<F> &fish, unsigned int step)
+{
+  assert(fish.size() == m_fish.size());
+  std::copy(fish.begin(), fish.end(), m_fish.begin());
+  m_step = step;
+  m_restored = true;
+}
+
+template<typename F> void BasicSimulation<F>::addObserver(unsigned int interval, Observer observer)
+{
+  m_observers.emplace_back(interval, std::move(observer));
+}
+
+template<typename F> void BasicSimulation<F>::step(unsigned int n)
+{
+  for (unsigned int i = 0; i < n; i++) {
+    if (m_sim_param.neighbour_search == NeighbourSearch::AllPairs) {
+      calcDeltaVelocitiesAllPairs(m_fish, m_sim_param, m_fish_param);
+    } else if (m_sim_param.neighbour_search == NeighbourSearch::KdTree) {
+      // Sort the fish into the tree and store the delta velocity of every fish
+      m_tree.build(m_fish, m_sim_param.length);
+      calcDeltaVelocities(m_fish, m_sim_param, m_fish_param, m_tree);
+    } else {
+      // Sort the fish into the grid cells, or only move the fish that changed cells in between the rebuilds
+      if (m_restored || m_step % m_sim_param.rebuild_interval == 0) {
+        m_restored = false;
+        if (m_grids.size() == 2) {
+          BasicCellList<F>::build(m_fish, m_grids[0], m_grids[1], m_slack);
+        } else {
+          m_grids[0].build(m_fish, m_slack);
+        }
+      } else {
+        for (auto &grid : m_grids) { grid.update(m_fish); }
+      }
+      if (m_sim_param.attraction_opening_angle > 0) { m_grids.back().computeCentroids(); }
+
+      // Store the delta velocity of every fish
+      if (m_sim_param.neighbour_search == NeighbourSearch::Tiled) {
+        calcDeltaVelocitiesTiled(m_fish,
+          m_sim_param,
+          m_fish_param,
+          m_grids.front(),
+          m_stencils.repulsion_runs,
+          m_grids.back(),
+          m_stencils.attractive_runs);
+      } else {
+        calcDeltaVelocities(m_fish,
+          m_sim_param,
+          m_fish_param,
+          m_grids.front(),
+          m_stencils.repulsion_runs,
+          m_grids.back(),
+          m_stencils.attractive_runs);
+      }
+    }
+
+    // Update the fish positions and velocities, each thread the fish whose pages it touched first
+    BasicSchool<F> &fish = m_fish;
+    const SimParam &sim_param = m_sim_param;
+    const FishParam &fish_param = m_fish_param;
+#pragma omp parallel for default(none) shared(fish, sim_param, fish_param) schedule(static)
+    for (auto &one_fish : fish) { one_fish.update(sim_param, fish_param); }
+
+    const unsigned int time_step = m_step++;
+    for (const auto &[interval, observer] : m_observers) {
+      if (time_step % interval == 0) { observer(*this); }
+    }
+  }
+}
+
+template<typename F> void BasicSimulation<F>::writeSnapshot(std::ostream &output) const
+{
+  ::writeSnapshot(output, m_fish, m_sim_param, m_step);
+}
+
+template class BasicSimulation<Fish>;
+template class BasicSimulation<FishF>;
+template class BasicSimulation<MixedFish>;
+template class BasicSimulation<FixedFish>;
+
+void simulate(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const Stencils &stencils,
+  std::ostream &output,
+  bool verbose,
+  const AnalysisOutput &analysis)
+{
+  // The school is only analysed if asked for
+  if (sim_param.observables_interval > 0) { writeAnalysisHeaders(analysis); }
+
+  switch (sim_param.precision) {
+  case Precision::Float:
+    simulateAs<FishF>(fish, sim_param, fish_param, stencils, output, verbose, analysis);
+    break;
+  case Precision::Mixed:
+    simulateAs<MixedFish>(fish, sim_param, fish_param, stencils, output, verbose, analysis);
+    break;
+  case Precision::Fixed:
+    simulateAs<FixedFish>(fish, sim_param, fish_param, stencils, output, verbose, analysis);
+    break;
+  case Precision::Double:
+    simulateAs<Fish>(fish, sim_param, fish_param, stencils, output, verbose, analysis);
+    break;
+  }
+}
@@ -0,0 +1,229 @@
+#include "ensemble.hpp"
+
+#include "batch.hpp"
+#include "driver.hpp"
+#include "fish.hpp"
+#include "io.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <omp.h>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+namespace {
+
+// Replicas a ReplicaBatch can run together have the same length, number of fish, steps, time step and snapshot interval
+using BatchKey = std::tuple<unsigned int, unsigned int, unsigned int, double, unsigned int>;
+
+struct SweepAxis
+{
+  std::string section;
+  std::string key;
+  YAML::Node values;
+};
+
+// Split "section.key" at the first dot
+int readSweepAxis(const std::string &name, const YAML::Node &values, SweepAxis &axis)
+{
+  const auto dot = name.find('.');
+  if (dot == std::string::npos) {
+    std::cerr << "Swept parameters are written <section>.<key>, not " << name << '\n';
+    return EXIT_FAILURE;
+  }
+  axis.section = name.substr(0, dot);
+  axis.key = name.substr(dot + 1);
+  if (axis.section != "simulation-params" && axis.section != "fish-params") {
+    std::cerr << "Unknown section of the swept parameter " << name << '\n';
+    return EXIT_FAILURE;
+  }
+  if (!values.IsSequence() || values.size() == 0) {
+    std::cerr << "The swept parameter " << name << " needs a list of values" << '\n';
+    return EXIT_FAILURE;
+  }
+  axis.values = values;
+  return EXIT_SUCCESS;
+}
+
+}// namespace
+
+int operator>>(const YAML::Node &node, Ensemble &ensemble)
+{
+  try {
+    if (!node["configs"] || !node["configs"].IsSequence()) {
+      std::cerr << "The ensemble needs a list of configs" << '\n';
+      return EXIT_FAILURE;
+    }
+
+    std::vector<SweepAxis> axes{};
+    if (node["sweep"]) {
+      for (const auto &entry : node["sweep"]) {
+        SweepAxis axis{};
+        if (readSweepAxis(entry.first.as<std::string>(), entry.second, axis) == EXIT_FAILURE) { return EXIT_FAILURE; }
+        axes.push_back(axis);
+      }
+    }
+    const unsigned int n_seeds = node["seeds"] ? node["seeds"].as<unsigned int>() : 1;
+    unsigned int seed = node["seed"] ? node["seed"].as<unsigned int>() : std::random_device{}();
+    if (node["output"]) { ensemble.output = node["output"].as<std::string>(); }
+    if (node["parallel-below"]) { ensemble.parallel_below = node["parallel-below"].as<unsigned int>(); }
+    if (node["batch-replicas"]) { ensemble.batch_replicas = node["batch-replicas"].as<bool>(); }
+
+    ensemble.replicas.clear();
+    for (std::size_t i_config = 0; i_config < node["configs"].size(); i_config++) {
+      // Each file is parsed once, and cloned for every combination of the swept values
+      const YAML::Node entry = node["configs"][i_config];
+      const YAML::Node base = entry.IsScalar() ? YAML::LoadFile(entry.as<std::string>()) : entry;
+      const std::string name = entry.IsScalar() ? entry.as<std::string>() : "configs[" + std::to_string(i_config) + "]";
+
+      // Count through the combinations, the last axis fastest
+      std::vector<std::size_t> index(axes.size(), 0);
+      bool done = false;
+      while (!done) {
+        YAML::Node config = YAML::Clone(base);
+        std::string label = name;
+        for (std::size_t axis = 0; axis < axes.size(); axis++) {
+          const YAML::Node value = axes[axis].values[index[axis]];
+          config[axes[axis].section][axes[axis].key] = value;
+          label += " " + axes[axis].key + "=" + YAML::Dump(value);
+        }
+
+        Replica replica{};
+        if ((config >> replica.sim_param) == EXIT_FAILURE || (config >> replica.fish_param) == EXIT_FAILURE) {
+          std::cerr << "Invalid parameters in " << label << '\n';
+          return EXIT_FAILURE;
+        }
+        replica.label = label;
+        for (unsigned int i_seed = 0; i_seed < n_seeds; i_seed++) {
+          replica.seed = seed++;
+          ensemble.replicas.push_back(replica);
+        }
+
+        done = true;
+        for (std::size_t axis = axes.size(); axis-- > 0;) {
+          if (++index[axis] < axes[axis].values.size()) {
+            done = false;
+            break;
+          }
+          index[axis] = 0;
+        }
+      }
+    }
+  } catch (const YAML::Exception &err) {
+    std::cerr << err.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+const Stencils &StencilCache::get(const SimParam &sim_param, const FishParam &fish_param)
+{
+  const bool use_grid = sim_param.neighbour_search == NeighbourSearch::Cell
+                        || sim_param.neighbour_search == NeighbourSearch::Tiled;
+  const Key key{ use_grid,
+    use_grid ? sim_param.cell_grid : CellGrid::Unit,
+    use_grid ? fish_param.repulsion_radius : 0.0,
+    use_grid ? fish_param.attraction_radius : 0.0,
+    use_grid && sim_param.cell_grid == CellGrid::TwoLevel ? sim_param.length : 0 };
+
+  auto found = m_stencils.find(key);
+  if (found == m_stencils.end()) { found = m_stencils.emplace(key, makeStencils(sim_param, fish_param)).first; }
+  return found->second;
+}
+
+void runEnsemble(const Ensemble &ensemble, StencilCache &cache)
+{
+  const auto &replicas = ensemble.replicas;
+
+  // Make the stencils up front, as the replicas share them read-only
+  std::vector<const Stencils *> stencils(replicas.size());
+  std::ofstream index_file(ensemble.output + "_index.txt");
+  for (std::size_t i = 0; i < replicas.size(); i++) {
+    stencils[i] = &cache.get(replicas[i].sim_param, replicas[i].fish_param);
+    index_file << i << " " << replicas[i].seed << " " << replicas[i].label << '\n';
+  }
+  index_file.close();
+
+  auto run = [&](const std::vector<std::size_t> &job) {
+    std::vector<std::ofstream> output_files{};
+    for (const auto i : job) { output_files.emplace_back(ensemble.output + "_" + std::to_string(i) + ".txt"); }
+    if (job.size() == 1) {
+      const Replica &replica = replicas[job.front()];
+      std::mt19937 gen(replica.seed);
+      School fish = makeSphere(replica.sim_param, replica.fish_param, gen);
+      simulate(fish, replica.sim_param, replica.fish_param, *stencils[job.front()], output_files.front(), false);
+      return;
+    }
+
+    std::vector<FishParam> fish_params{};
+    for (const auto i : job) { fish_params.push_back(replicas[i].fish_param); }
+    ReplicaBatch batch(replicas[job.front()].sim_param, fish_params);
+    std::vector<std::ostream *> outputs{};
+    for (std::size_t lane = 0; lane < job.size(); lane++) {
+      std::mt19937 gen(replicas[job[lane]].seed);
+      batch.setSchool(lane, makeSphere(replicas[job[lane]].sim_param, replicas[job[lane]].fish_param, gen));
+      outputs.push_back(&output_files[lane]);
+    }
+    simulate(batch, outputs);
+  };
+
+  // Batch the small replicas a ReplicaBatch can run, in the order of the replicas
+  std::vector<std::vector<std::size_t>> small{};
+  std::vector<std::size_t> large{};
+  std::map<BatchKey, std::size_t> open_batches{};// Job still taking replicas of the same size
+  for (std::size_t i = 0; i < replicas.size(); i++) {
+    const SimParam &sim_param = replicas[i].sim_param;
+    if (sim_param.n_fish >= ensemble.parallel_below) {
+      large.push_back(i);
+      continue;
+    }
+    if (!ensemble.batch_replicas || sim_param.neighbour_search != NeighbourSearch::AllPairs
+        || sim_param.precision != Precision::Double || sim_param.output_mode != OutputMode::Fish) {
+      small.push_back({ i });
+      continue;
+    }
+
+    const BatchKey key{
+      sim_param.length, sim_param.n_fish, sim_param.max_steps, sim_param.delta_t, sim_param.snapshot_interval
+    };
+    const auto found = open_batches.find(key);
+    if (found != open_batches.end() && small[found->second].size() < ReplicaBatch::lanes) {
+      small[found->second].push_back(i);
+    } else {
+      open_batches[key] = small.size();
+      small.push_back({ i });
+    }
+  }
+
+  // The most work first, so that the threads finish the small replicas together
+  auto work = [&replicas](const std::vector<std::size_t> &job) {
+    const SimParam &sim_param = replicas[job.front()].sim_param;
+    return static_cast<double>(sim_param.n_fish) * sim_param.max_steps * static_cast<double>(job.size());
+  };
+  std::stable_sort(small.begin(), small.end(), [&work](const auto &a, const auto &b) { return work(a) > work(b); });
+
+  // The parallel loops of the small replicas run on the thread of the replica
+  omp_set_max_active_levels(1);
+#pragma omp parallel for default(none) shared(small, run, replicas, std::cout) schedule(dynamic, 1)
+  for (std::size_t i = 0; i < small.size(); i++) {
+    run(small[i]);
+#pragma omp critical
+    for (const auto replica : small[i]) {
+      std::cout << "Replica " << replica << " of " << replicas.size() << " done" << '\n';
+    }
+  }
+
+  for (const auto i : large) {
+    run({ i });
+    std::cout << "Replica " << i << " of " << replicas.size() << " done" << '\n';
+  }
+}
@@ -0,0 +1,47 @@
+#include "cpu.hpp"
+#include "ensemble.hpp"
+#include <argparse/argparse.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <omp.h>
+#include <stdexcept>
+#include <string>
+#include <yaml-cpp/node/node.h>
+#include <yaml-cpp/node/parse.h>
+
+int main(int argc, char *argv[])
+{
+  argparse::ArgumentParser program("fish_ensemble");
+  program.add_argument("-e", "--ensemble").help("The path to the ensemble file").required();
+  program.add_argument("--simd")
+    .help("Force the vector instructions of the kernels: generic, sse4.2, avx2 or avx512")
+    .default_value(std::string("auto"));
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << '\n';
+    std::cerr << program;
+    return 1;
+  }
+
+  const auto simd = program.get<std::string>("--simd");
+  if (simd != "auto") {
+    SimdLevel simd_level{};
+    if (parseSimdLevel(simd, simd_level) == EXIT_FAILURE || setSimdLevel(simd_level) == EXIT_FAILURE) {
+      std::cerr << "Unknown or unsupported vector instructions: " << simd << '\n';
+      return 1;
+    }
+  }
+
+  Ensemble ensemble{};
+  if ((YAML::LoadFile(program.get<std::string>("--ensemble")) >> ensemble) == EXIT_FAILURE) {
+    std::cerr << "Error reading the ensemble" << '\n';
+    return 1;
+  }
+
+  StencilCache cache{};
+  std::cout << "Replicas: " << ensemble.replicas.size() << ", threads: " << omp_get_max_threads() << '\n';
+  runEnsemble(ensemble, cache);
+  std::cout << "Stencils made: " << cache.size() << '\n';
+  return EXIT_SUCCESS;
+}
@@ -2,31 +2,45 @@
 
 #include "coordinate.hpp"
 #include "fish.hpp"
+#include "grid.hpp"
+#include "kdtree.hpp"
+#include "nearest.hpp"
+#include "simd.hpp"
 #include "simulation.hpp"
 
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-Vect3 calcDeltaVRepulsion(const Fish &fish,
-  const Fish &other_fish,
+template<typename F>
+[[gnu::always_inline]] inline SumVect3<F> calcDeltaVRepulsion(const F &fish,
+  const F &other_fish,
   const SimParam &sim_param,
   const FishParam &fish_param)
 {
-  Vect3 delta_v_repulsion{ .x = 0.0, .y = 0.0, .z = 0.0 };
+  using Sum = FishSum<F>;
+  const auto &position = FishTraits<F>::getPosition(fish);
+  const auto &other_position = FishTraits<F>::getPosition(other_fish);
+  const auto velocity = castVect3<Sum>(fish.getVelocity());
+  const Sum distance = absolute(castVect3<Sum>(vect12(position, other_position, sim_param.length)));
+  const auto g_factor = static_cast<Sum>(g(static_cast<double>(distance), fish_param.body_length));
+  SumVect3<F> delta_v_repulsion{ .x = 0, .y = 0, .z = 0 };
 
   // Orientational interaction
-  delta_v_repulsion +=
-    g(absolute(vect12(fish.getPosition(), other_fish.getPosition(), sim_param.length)), fish_param.body_length)
-    * vect12(fish.getVelocity(), other_fish.getVelocity(), sim_param.length);
+  delta_v_repulsion += g_factor * vect12(velocity, castVect3<Sum>(other_fish.getVelocity()), sim_param.length);
 
   // Repulsion interaction
-  delta_v_repulsion +=
-    g(absolute(vect12(fish.getPosition(), other_fish.getPosition(), sim_param.length)), fish_param.body_length)
-    * (fish_param.vel_repulsion / absolute(vect12(fish.getPosition(), other_fish.getPosition(), sim_param.length))
-         * vect12(other_fish.getPosition(), fish.getPosition(), sim_param.length)
-       - fish.getVelocity());
+  delta_v_repulsion += g_factor
+                       * (static_cast<Sum>(fish_param.vel_repulsion) / distance
+                            * castVect3<Sum>(vect12(other_position, position, sim_param.length))
+                          - velocity);
 
   return delta_v_repulsion;
 }
@@ -49,9 +63,11 @@ Vect3 calcDeltaVAttraction(const Fish &fish,
 
 double g(double distance, double body_length) { return distance <= body_length ? body_length / distance : 1.; }
 
-Vect3 calcSelfPropulsion(const Fish &fish, const FishParam &fish_param)
+template<typename F> SumVect3<F> calcSelfPropulsion(const F &fish, const FishParam &fish_param)
 {
-  return (fish_param.vel_standard / fish.speed() - 1) * fish.getVelocity();
+  using Sum = FishSum<F>;
+  return (static_cast<Sum>(fish_param.vel_standard) / static_cast<Sum>(fish.speed()) - 1)
+         * castVect3<Sum>(fish.getVelocity());
 }
 
 
@@ -223,3 +239,888 @@ std::tuple<Vect3, unsigned int> calcAttraction(const Fish &fish,
                                 : Vect3{ .x = 0.0, .y = 0.0, .z = 0.0 },
     neighbour_count };
 }
+
+// Distance to and index of the nearest fish of the fish handled by the thread, kept from one call to the next so that
+// the steps allocate nothing once it has room for n_cog of them
+std::vector<std::pair<double, unsigned int>> &getThreadNeighbours()
+{
+  thread_local std::vector<std::pair<double, unsigned int>> neighbours{};
+  return neighbours;
+}
+
+// The kernels below are classes whose run() is always inlined into the copies of SimdCopies, see simd.hpp.
+// The drivers select the copies before their parallel regions and call them for each fish or home cell.
+
+// Repulsion from the n_cog nearest fish within the repulsion radius, scanning the fish in the runs of the stencil
+template<typename F> struct RepulsionInRuns
+{
+  [[gnu::always_inline]] static std::tuple<SumVect3<F>, unsigned int> run(const F &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &cells,
+    const std::vector<StencilRun> &repulsion_runs)
+  {
+    using Sum = FishSum<F>;
+    const auto &position = FishTraits<F>::getPosition(fish);
+    const auto cell = cells.getCell(position);
+
+    // Distance to and index of up to n_cog nearest fish within the repulsion radius
+    auto &neighbours = getThreadNeighbours();
+    neighbours.clear();
+    neighbours.reserve(fish_param.n_cog);
+    cells.forEachInRuns(cell, repulsion_runs, [&](unsigned int i) {
+      // Skip the fish itself
+      if (cells.getFish(i) == &fish) { return; }
+
+      const auto distance = static_cast<double>(absolute(vect12(position, cells.getPosition(i), sim_param.length)));
+      if (distance > fish_param.repulsion_radius) { return; }
+      offerNearest(neighbours, fish_param.n_cog, { distance, i });
+    });
+
+    // Calculate the repulsion with up to n_cog nearest fish
+    const std::size_t n_nearest = neighbours.size();
+    std::sort_heap(neighbours.begin(), neighbours.end());
+
+    SumVect3<F> delta_v_repulsion{ .x = 0, .y = 0, .z = 0 };
+    for (std::size_t i = 0; i < n_nearest; i++) {
+      delta_v_repulsion += calcDeltaVRepulsion(fish, *cells.getFish(neighbours[i].second), sim_param, fish_param);
+    }
+
+    const auto neighbour_count = static_cast<unsigned int>(n_nearest);
+    return { neighbour_count != 0 ? delta_v_repulsion / static_cast<Sum>(neighbour_count)
+                                  : SumVect3<F>{ .x = 0, .y = 0, .z = 0 },
+      neighbour_count };
+  }
+};
+
+// Same as above for n_cog = NCog, keeping the nearest fish in a fixed-size buffer instead of sorting a vector of them
+template<unsigned int NCog, typename F> struct NearestRepulsionInRuns
+{
+  [[gnu::always_inline]] static std::tuple<SumVect3<F>, unsigned int> run(const F &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &cells,
+    const std::vector<StencilRun> &repulsion_runs)
+  {
+    using Sum = FishSum<F>;
+    const auto &position = FishTraits<F>::getPosition(fish);
+    const auto cell = cells.getCell(position);
+
+    NearestBuffer<NCog> nearest{};
+    cells.forEachInRuns(cell, repulsion_runs, [&](unsigned int i) {
+      // Skip the fish itself
+      if (cells.getFish(i) == &fish) { return; }
+
+      const auto distance = static_cast<double>(absolute(vect12(position, cells.getPosition(i), sim_param.length)));
+      if (distance > fish_param.repulsion_radius) { return; }
+      nearest.insert(distance, i);
+    });
+
+    SumVect3<F> delta_v_repulsion{ .x = 0, .y = 0, .z = 0 };
+    for (unsigned int k = 0; k < nearest.size(); k++) {
+      delta_v_repulsion += calcDeltaVRepulsion(fish, *cells.getFish(nearest.getIndex(k)), sim_param, fish_param);
+    }
+
+    const unsigned int neighbour_count = nearest.size();
+    return { neighbour_count != 0 ? delta_v_repulsion / static_cast<Sum>(neighbour_count)
+                                  : SumVect3<F>{ .x = 0, .y = 0, .z = 0 },
+      neighbour_count };
+  }
+};
+
+// Attraction from the fish between the repulsion and attraction radii, scanning the fish in the runs of the stencil
+template<typename F> struct AttractionInRuns
+{
+  [[gnu::always_inline]] static std::tuple<SumVect3<F>, unsigned int> run(const F &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &cells,
+    const std::vector<StencilRun> &attractive_runs)
+  {
+    using Sum = FishSum<F>;
+    const auto &position = FishTraits<F>::getPosition(fish);
+    const auto velocity = castVect3<Sum>(fish.getVelocity());
+    const auto attraction_radius = static_cast<Sum>(fish_param.attraction_radius);
+    const auto repulsion_radius = static_cast<Sum>(fish_param.repulsion_radius);
+    const auto vel_escape = static_cast<Sum>(fish_param.vel_escape);
+    SumVect3<F> delta_v_attraction{ .x = 0, .y = 0, .z = 0 };
+    unsigned int neighbour_count = 0;// Number of neighboring fish
+    const auto cell = cells.getCell(position);
+
+    cells.forEachInRuns(cell, attractive_runs, [&](unsigned int i) {
+      // Skip the fish itself
+      if (cells.getFish(i) == &fish) { return; }
+
+      const auto relative_position = castVect3<Sum>(vect12(position, cells.getPosition(i), sim_param.length));
+      const Sum distance = absolute(relative_position);
+      if (distance > attraction_radius || distance < repulsion_radius) { return; }
+
+      // Attraction interaction
+      delta_v_attraction += (vel_escape / distance) * relative_position - velocity;
+      neighbour_count++;
+    });
+
+    return { neighbour_count != 0
+               ? static_cast<Sum>(fish.getLambda()) * delta_v_attraction / static_cast<Sum>(neighbour_count)
+               : SumVect3<F>{ .x = 0, .y = 0, .z = 0 },
+      neighbour_count };
+  }
+};
+
+// Same as above, approximating the far cells by their centroids
+template<typename F> struct ApproximateAttractionInRuns
+{
+  [[gnu::always_inline]] static std::tuple<SumVect3<F>, unsigned int> run(const F &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &cells,
+    const std::vector<StencilRun> &attractive_runs,
+    double opening_angle)
+  {
+    using Sum = FishSum<F>;
+    const auto &position = FishTraits<F>::getPosition(fish);
+    const Vect3 vect = toVect3(position, sim_param.length);
+    const auto velocity = castVect3<Sum>(fish.getVelocity());
+    const auto attraction_radius = static_cast<Sum>(fish_param.attraction_radius);
+    const auto repulsion_radius = static_cast<Sum>(fish_param.repulsion_radius);
+    const auto vel_escape = static_cast<Sum>(fish_param.vel_escape);
+    SumVect3<F> delta_v_attraction{ .x = 0, .y = 0, .z = 0 };
+    unsigned int neighbour_count = 0;// Number of neighboring fish
+    const auto cell = cells.getCell(position);
+    const double half_diagonal = std::sqrt(3.0) / 2 * cells.getCellSize();
+
+    cells.forEachCellInRuns(cell, attractive_runs, [&](unsigned int cell_index) {
+      // Far cells within the attraction zone act as all of their fish sitting at the centroid
+      const double centre_distance = absolute(vect12(vect, cells.getCellCentre(cell_index), sim_param.length));
+      if (2 * half_diagonal < opening_angle * centre_distance
+          && centre_distance - half_diagonal >= fish_param.repulsion_radius
+          && centre_distance + half_diagonal <= fish_param.attraction_radius) {
+        const auto relative_position = castVect3<Sum>(vect12(vect, cells.getCentroid(cell_index), sim_param.length));
+        const unsigned int count = cells.getCellCount(cell_index);
+        delta_v_attraction +=
+          static_cast<Sum>(count) * ((vel_escape / absolute(relative_position)) * relative_position - velocity);
+        neighbour_count += count;
+        return;
+      }
+
+      const IndexRange range = cells.getCellRange(cell_index);
+      for (unsigned int i = range.begin; i < range.end; i++) {
+        // Skip the fish itself
+        if (cells.getFish(i) == &fish) { continue; }
+
+        const auto relative_position = castVect3<Sum>(vect12(position, cells.getPosition(i), sim_param.length));
+        const Sum distance = absolute(relative_position);
+        if (distance > attraction_radius || distance < repulsion_radius) { continue; }
+
+        delta_v_attraction += (vel_escape / distance) * relative_position - velocity;
+        neighbour_count++;
+      }
+    });
+
+    return { neighbour_count != 0
+               ? static_cast<Sum>(fish.getLambda()) * delta_v_attraction / static_cast<Sum>(neighbour_count)
+               : SumVect3<F>{ .x = 0, .y = 0, .z = 0 },
+      neighbour_count };
+  }
+};
+
+// Repulsion from the n_cog nearest fish within the repulsion radius, found by a nearest neighbour query of the tree
+template<typename F> struct RepulsionInTree
+{
+  [[gnu::always_inline]] static std::tuple<SumVect3<F>, unsigned int> run(const F &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicKdTree<F> &tree)
+  {
+    using Sum = FishSum<F>;
+
+    // Distance to and index of up to n_cog nearest fish within the repulsion radius
+    auto &neighbours = getThreadNeighbours();
+    neighbours.reserve(fish_param.n_cog);
+    tree.findNearest(toVect3(FishTraits<F>::getPosition(fish), sim_param.length),
+      fish_param.n_cog,
+      fish_param.repulsion_radius,
+      &fish,
+      neighbours);
+
+    SumVect3<F> delta_v_repulsion{ .x = 0, .y = 0, .z = 0 };
+    for (const auto &neighbour : neighbours) {
+      delta_v_repulsion += calcDeltaVRepulsion(fish, *tree.getFish(neighbour.second), sim_param, fish_param);
+    }
+
+    const auto neighbour_count = static_cast<unsigned int>(neighbours.size());
+    return { neighbour_count != 0 ? delta_v_repulsion / static_cast<Sum>(neighbour_count)
+                                  : SumVect3<F>{ .x = 0, .y = 0, .z = 0 },
+      neighbour_count };
+  }
+};
+
+// Attraction from the fish between the repulsion and attraction radii, found by a radius query of the tree
+template<typename F> struct AttractionInTree
+{
+  [[gnu::always_inline]] static std::tuple<SumVect3<F>, unsigned int> run(const F &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicKdTree<F> &tree)
+  {
+    // The tree holds the positions in double, so the displacements are taken in double
+    using Sum = FishSum<F>;
+    const Vect3 position = toVect3(FishTraits<F>::getPosition(fish), sim_param.length);
+    const auto velocity = castVect3<Sum>(fish.getVelocity());
+    const auto vel_escape = static_cast<Sum>(fish_param.vel_escape);
+    SumVect3<F> delta_v_attraction{ .x = 0, .y = 0, .z = 0 };
+    unsigned int neighbour_count = 0;// Number of neighboring fish
+
+    tree.forEachWithin(position, fish_param.attraction_radius, [&](unsigned int i, double distance) {
+      // Skip the fish itself
+      if (tree.getFish(i) == &fish || distance < fish_param.repulsion_radius) { return; }
+
+      const auto relative_position = castVect3<Sum>(vect12(position, tree.getPosition(i), sim_param.length));
+      delta_v_attraction += (vel_escape / static_cast<Sum>(distance)) * relative_position - velocity;
+      neighbour_count++;
+    });
+
+    return { neighbour_count != 0
+               ? static_cast<Sum>(fish.getLambda()) * delta_v_attraction / static_cast<Sum>(neighbour_count)
+               : SumVect3<F>{ .x = 0, .y = 0, .z = 0 },
+      neighbour_count };
+  }
+};
+
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcRepulsion(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &cells,
+  const std::vector<StencilRun> &repulsion_runs)
+{
+  return SimdCopies<RepulsionInRuns<F>>::select()(fish, sim_param, fish_param, cells, repulsion_runs);
+}
+
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcAttraction(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &cells,
+  const std::vector<StencilRun> &attractive_runs)
+{
+  return SimdCopies<AttractionInRuns<F>>::select()(fish, sim_param, fish_param, cells, attractive_runs);
+}
+
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcAttraction(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &cells,
+  const std::vector<StencilRun> &attractive_runs,
+  double opening_angle)
+{
+  return SimdCopies<ApproximateAttractionInRuns<F>>::select()(
+    fish, sim_param, fish_param, cells, attractive_runs, opening_angle);
+}
+
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcRepulsion(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree)
+{
+  return SimdCopies<RepulsionInTree<F>>::select()(fish, sim_param, fish_param, tree);
+}
+
+template<typename F>
+std::tuple<SumVect3<F>, unsigned int> calcAttraction(const F &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree)
+{
+  return SimdCopies<AttractionInTree<F>>::select()(fish, sim_param, fish_param, tree);
+}
+
+// Change of velocity of one fish, specialised on n_cog, NCog = 0 being the generic one, and on the approximation of
+// the attraction
+template<typename F, unsigned int NCog, bool Approximate> struct UpdateFishInRuns
+{
+  [[gnu::always_inline]] static void run(F &one_fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &repulsion_cells,
+    const std::vector<StencilRun> &repulsion_runs,
+    const BasicCellList<F> &attractive_cells,
+    const std::vector<StencilRun> &attractive_runs)
+  {
+    // Calculate the self-propulsion
+    auto delta_v_self = calcSelfPropulsion(one_fish, fish_param);
+
+    std::tuple<SumVect3<F>, unsigned int> repulsion{};
+    if constexpr (NCog == 0) {
+      repulsion = RepulsionInRuns<F>::run(one_fish, sim_param, fish_param, repulsion_cells, repulsion_runs);
+    } else {
+      repulsion =
+        NearestRepulsionInRuns<NCog, F>::run(one_fish, sim_param, fish_param, repulsion_cells, repulsion_runs);
+    }
+    auto [delta_v_repulsion, n_fish_repulsion] = repulsion;
+
+    if (n_fish_repulsion < fish_param.n_cog) { one_fish.setLambda(static_cast<FishSum<F>>(fish_param.attraction_str)); }
+
+    if (one_fish.getLambda() > 0) {
+      std::tuple<SumVect3<F>, unsigned int> attraction{};
+      if constexpr (Approximate) {
+        attraction = ApproximateAttractionInRuns<F>::run(
+          one_fish, sim_param, fish_param, attractive_cells, attractive_runs, sim_param.attraction_opening_angle);
+      } else {
+        attraction = AttractionInRuns<F>::run(one_fish, sim_param, fish_param, attractive_cells, attractive_runs);
+      }
+      auto [delta_v_attraction, n_fish_attrac] = attraction;
+
+      one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion + delta_v_attraction);
+    } else {
+      one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion);
+    }
+  }
+};
+
+// Per-fish driver specialised on n_cog and on the approximation of the attraction, see UpdateFishInRuns
+template<typename F, unsigned int NCog, bool Approximate>
+void calcDeltaVelocitiesPerFish(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<F> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs)
+{
+  const auto update_fish = SimdCopies<UpdateFishInRuns<F, NCog, Approximate>>::select();
+
+#pragma omp parallel for default(none) \
+  shared(fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs, update_fish) \
+  schedule(static)
+  for (auto &one_fish : fish) {
+    update_fish(one_fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+  }
+}
+
+// Dispatch to the driver specialised on n_cog, or to the generic one for the rarer values
+template<typename F, bool Approximate>
+void dispatchNCog(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<F> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs)
+{
+  // NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  switch (fish_param.n_cog) {
+  case 1:
+    calcDeltaVelocitiesPerFish<F, 1, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 2:
+    calcDeltaVelocitiesPerFish<F, 2, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 3:
+    calcDeltaVelocitiesPerFish<F, 3, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 4:
+    calcDeltaVelocitiesPerFish<F, 4, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 5:
+    calcDeltaVelocitiesPerFish<F, 5, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 6:
+    calcDeltaVelocitiesPerFish<F, 6, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 7:
+    calcDeltaVelocitiesPerFish<F, 7, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  case 8:
+    calcDeltaVelocitiesPerFish<F, 8, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  default:
+    calcDeltaVelocitiesPerFish<F, 0, Approximate>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+    break;
+  }
+  // NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+}
+
+template<typename F>
+void calcDeltaVelocities(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<F> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs)
+{
+  if (sim_param.attraction_opening_angle > 0) {
+    dispatchNCog<F, true>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+  } else {
+    dispatchNCog<F, false>(
+      fish, sim_param, fish_param, repulsion_cells, repulsion_runs, attractive_cells, attractive_runs);
+  }
+}
+
+// Tile of the fish in a home cell, kept by each thread from one call to the next
+template<typename F> struct HomeTile
+{
+  std::vector<typename FishTraits<F>::Position> position;
+  std::vector<SumVect3<F>> velocity;
+  std::vector<std::vector<std::pair<double, unsigned int>>> neighbours;
+  std::vector<SumVect3<F>> attraction;
+  std::vector<unsigned int> attraction_count;
+  std::vector<unsigned int> active;// Tile indices of the fish feeling the attraction
+};
+
+template<typename F> HomeTile<F> &getThreadTile()
+{
+  thread_local HomeTile<F> tile{};
+  return tile;
+}
+
+
+// Repulsion on the fish of the home cell (x, y, z) from up to n_cog nearest fish, which decides whether they feel the
+// attraction
+template<typename F> struct RepelTile
+{
+  [[gnu::always_inline]] static void run(BasicSchool<F> &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &repulsion_cells,
+    const std::vector<StencilRun> &repulsion_runs,
+    unsigned int x,
+    unsigned int y,
+    unsigned int z,
+    HomeTile<F> &tile)
+  {
+    using Sum = FishSum<F>;
+    auto &[home_position, home_velocity, home_neighbours, home_attraction, home_attraction_count, active] = tile;
+    const IndexRange home = repulsion_cells.getCellRange(repulsion_cells.cellIndex(x, y, z));
+    if (home.begin == home.end) { return; }
+
+    // Load the home tile
+    const unsigned int tile_size = home.end - home.begin;
+    home_position.resize(tile_size);
+    for (unsigned int h = 0; h < tile_size; h++) {
+      home_position[h] = repulsion_cells.getPosition(home.begin + h);
+      home_neighbours[h].clear();
+    }
+
+    // Distance to and index of the fish within the repulsion radius of each fish in the tile
+    repulsion_cells.forEachRangeInRuns({ x, y, z }, repulsion_runs, [&](const IndexRange &range) {
+      for (unsigned int i = range.begin; i < range.end; i++) {
+        const auto &position = repulsion_cells.getPosition(i);
+        for (unsigned int h = 0; h < tile_size; h++) {
+          // Skip the fish itself
+          if (home.begin + h == i) { continue; }
+
+          const auto distance = static_cast<double>(absolute(vect12(home_position[h], position, sim_param.length)));
+          if (distance > fish_param.repulsion_radius) { continue; }
+          offerNearest(home_neighbours[h], fish_param.n_cog, { distance, i });
+        }
+      }
+    });
+
+    for (unsigned int h = 0; h < tile_size; h++) {
+      F &one_fish = fish[repulsion_cells.getFishIndex(home.begin + h)];
+      auto &neighbours = home_neighbours[h];
+      const std::size_t n_nearest = neighbours.size();
+      std::sort_heap(neighbours.begin(), neighbours.end());
+
+      SumVect3<F> delta_v_repulsion{ .x = 0, .y = 0, .z = 0 };
+      for (std::size_t i = 0; i < n_nearest; i++) {
+        delta_v_repulsion +=
+          calcDeltaVRepulsion(one_fish, *repulsion_cells.getFish(neighbours[i].second), sim_param, fish_param);
+      }
+      if (n_nearest != 0) { delta_v_repulsion = delta_v_repulsion / static_cast<Sum>(n_nearest); }
+
+      one_fish.setDeltaVelocity(calcSelfPropulsion(one_fish, fish_param) + delta_v_repulsion);
+
+      if (n_nearest < fish_param.n_cog) { one_fish.setLambda(static_cast<Sum>(fish_param.attraction_str)); }
+    }
+  }
+};
+
+// Attraction on the fish of the home cell (x, y, z) from the fish between the repulsion and attraction radii, once
+// every lambda is settled
+template<typename F> struct AttractTile
+{
+  [[gnu::always_inline]] static void run(BasicSchool<F> &fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicCellList<F> &attractive_cells,
+    const std::vector<StencilRun> &attractive_runs,
+    unsigned int x,
+    unsigned int y,
+    unsigned int z,
+    HomeTile<F> &tile)
+  {
+    using Sum = FishSum<F>;
+    const auto attraction_radius = static_cast<Sum>(fish_param.attraction_radius);
+    const auto repulsion_radius = static_cast<Sum>(fish_param.repulsion_radius);
+    const auto vel_escape = static_cast<Sum>(fish_param.vel_escape);
+    auto &[home_position, home_velocity, home_neighbours, home_attraction, home_attraction_count, active] = tile;
+    const IndexRange home = attractive_cells.getCellRange(attractive_cells.cellIndex(x, y, z));
+
+    // Load the tile of the fish in the home cell feeling the attraction
+    active.clear();
+    for (unsigned int h = 0; h < home.end - home.begin; h++) {
+      if (attractive_cells.getFish(home.begin + h)->getLambda() > 0) { active.push_back(h); }
+    }
+    if (active.empty()) { return; }
+
+    const unsigned int tile_size = home.end - home.begin;
+    home_position.resize(tile_size);
+    home_velocity.resize(tile_size);
+    for (const unsigned int h : active) {
+      home_position[h] = attractive_cells.getPosition(home.begin + h);
+      home_velocity[h] = castVect3<Sum>(attractive_cells.getFish(home.begin + h)->getVelocity());
+    }
+    home_attraction.assign(tile_size, SumVect3<F>{ .x = 0, .y = 0, .z = 0 });
+    home_attraction_count.assign(tile_size, 0);
+
+    attractive_cells.forEachRangeInRuns({ x, y, z }, attractive_runs, [&](const IndexRange &range) {
+      for (unsigned int i = range.begin; i < range.end; i++) {
+        const auto &position = attractive_cells.getPosition(i);
+        for (const unsigned int h : active) {
+          // Skip the fish itself
+          if (home.begin + h == i) { continue; }
+
+          const auto relative_position = castVect3<Sum>(vect12(home_position[h], position, sim_param.length));
+          const Sum distance = absolute(relative_position);
+          if (distance > attraction_radius || distance < repulsion_radius) { continue; }
+
+          home_attraction[h] += (vel_escape / distance) * relative_position - home_velocity[h];
+          home_attraction_count[h]++;
+        }
+      }
+    });
+
+    for (const unsigned int h : active) {
+      if (home_attraction_count[h] == 0) { continue; }
+      F &one_fish = fish[attractive_cells.getFishIndex(home.begin + h)];
+      one_fish.setDeltaVelocity(one_fish.getDeltaVelocity()
+                                + static_cast<Sum>(one_fish.getLambda()) * home_attraction[h]
+                                    / static_cast<Sum>(home_attraction_count[h]));
+    }
+  }
+};
+
+template<typename F>
+void calcDeltaVelocitiesTiled(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<F> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<F> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs)
+{
+  const unsigned int repulsion_side = repulsion_cells.getCellsPerSide();
+  const unsigned int attractive_side = attractive_cells.getCellsPerSide();
+  const unsigned int repulsion_cell_count = repulsion_side * repulsion_side * repulsion_side;
+  const unsigned int attractive_cell_count = attractive_side * attractive_side * attractive_side;
+  const auto repel_tile = SimdCopies<RepelTile<F>>::select();
+  const auto attract_tile = SimdCopies<AttractTile<F>>::select();
+  unsigned int max_tile_size = 0;
+
+#pragma omp parallel default(none) shared(fish, sim_param, fish_param, repulsion_cells, repulsion_runs, \
+    attractive_cells, attractive_runs, repulsion_side, attractive_side, repulsion_cell_count, attractive_cell_count, \
+    repel_tile, attract_tile, max_tile_size)
+  {
+    // Tile of the fish in the home cell, reused for every cell handled by the thread.
+    // The fish in the runs are already stored contiguously by the cell list.
+    auto &tile = getThreadTile<F>();
+    auto &[home_position, home_velocity, home_neighbours, home_attraction, home_attraction_count, active] = tile;
+
+    // Grow the tile to the fullest cell up front, so that the buffers only grow when a cell holds more fish than
+    // any did before, whichever thread handles it
+#pragma omp for reduction(max : max_tile_size) schedule(static) nowait
+    for (unsigned int cell_index = 0; cell_index < repulsion_cell_count; cell_index++) {
+      max_tile_size = std::max(max_tile_size, repulsion_cells.getCellCount(cell_index));
+    }
+#pragma omp for reduction(max : max_tile_size) schedule(static)
+    for (unsigned int cell_index = 0; cell_index < attractive_cell_count; cell_index++) {
+      max_tile_size = std::max(max_tile_size, attractive_cells.getCellCount(cell_index));
+    }
+    home_position.reserve(max_tile_size);
+    home_velocity.reserve(max_tile_size);
+    home_attraction.reserve(max_tile_size);
+    home_attraction_count.reserve(max_tile_size);
+    active.reserve(max_tile_size);
+    if (home_neighbours.size() < max_tile_size) { home_neighbours.resize(max_tile_size); }
+    for (auto &neighbours : home_neighbours) { neighbours.reserve(fish_param.n_cog); }
+
+#pragma omp for collapse(3) schedule(dynamic)
+    for (unsigned int x = 0; x < repulsion_side; x++) {
+      for (unsigned int y = 0; y < repulsion_side; y++) {
+        for (unsigned int z = 0; z < repulsion_side; z++) {
+          repel_tile(fish, sim_param, fish_param, repulsion_cells, repulsion_runs, x, y, z, tile);
+        }
+      }
+    }
+
+#pragma omp for collapse(3) schedule(dynamic)
+    for (unsigned int x = 0; x < attractive_side; x++) {
+      for (unsigned int y = 0; y < attractive_side; y++) {
+        for (unsigned int z = 0; z < attractive_side; z++) {
+          attract_tile(fish, sim_param, fish_param, attractive_cells, attractive_runs, x, y, z, tile);
+        }
+      }
+    }
+  }
+}
+
+template<typename F>
+void calcDeltaVelocities(BasicSchool<F> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree)
+{
+  calcDeltaVelocities(fish, fish.size(), sim_param, fish_param, tree);
+}
+
+// Change of velocity of one fish, searching its neighbours in the tree
+template<typename F> struct UpdateFishInTree
+{
+  [[gnu::always_inline]] static void run(F &one_fish,
+    const SimParam &sim_param,
+    const FishParam &fish_param,
+    const BasicKdTree<F> &tree)
+  {
+    // Calculate the self-propulsion
+    auto delta_v_self = calcSelfPropulsion(one_fish, fish_param);
+
+    auto [delta_v_repulsion, n_fish_repulsion] = RepulsionInTree<F>::run(one_fish, sim_param, fish_param, tree);
+
+    if (n_fish_repulsion < fish_param.n_cog) { one_fish.setLambda(static_cast<FishSum<F>>(fish_param.attraction_str)); }
+
+    if (one_fish.getLambda() > 0) {
+      auto [delta_v_attraction, n_fish_attrac] = AttractionInTree<F>::run(one_fish, sim_param, fish_param, tree);
+
+      one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion + delta_v_attraction);
+    } else {
+      one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion);
+    }
+  }
+};
+
+template<typename F>
+void calcDeltaVelocities(BasicSchool<F> &fish,
+  std::size_t n_updated,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<F> &tree)
+{
+  const auto update_fish = SimdCopies<UpdateFishInTree<F>>::select();
+
+#pragma omp parallel default(none) shared(fish, n_updated, sim_param, fish_param, tree, update_fish)
+  {
+    // Room for the nearest fish in every thread, including those the dynamic schedule gives no fish this time
+    getThreadNeighbours().reserve(fish_param.n_cog);
+
+#pragma omp for schedule(dynamic, 64)
+    for (std::size_t i = 0; i < n_updated; i++) { update_fish(fish[i], sim_param, fish_param, tree); }
+  }
+}
+
+template SumVect3<Fish> calcSelfPropulsion(const Fish &fish, const FishParam &fish_param);
+template std::tuple<SumVect3<Fish>, unsigned int> calcRepulsion(const Fish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<Fish> &cells,
+  const std::vector<StencilRun> &repulsion_runs);
+template std::tuple<SumVect3<Fish>, unsigned int> calcAttraction(const Fish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<Fish> &cells,
+  const std::vector<StencilRun> &attractive_runs);
+template std::tuple<SumVect3<Fish>, unsigned int> calcAttraction(const Fish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<Fish> &cells,
+  const std::vector<StencilRun> &attractive_runs,
+  double opening_angle);
+template std::tuple<SumVect3<Fish>, unsigned int> calcRepulsion(const Fish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<Fish> &tree);
+template std::tuple<SumVect3<Fish>, unsigned int> calcAttraction(const Fish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<Fish> &tree);
+template void calcDeltaVelocities(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<Fish> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<Fish> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocitiesTiled(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<Fish> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<Fish> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocities(School &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<Fish> &tree);
+template void calcDeltaVelocities(School &fish,
+  std::size_t n_updated,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<Fish> &tree);
+template SumVect3<FishF> calcSelfPropulsion(const FishF &fish, const FishParam &fish_param);
+template std::tuple<SumVect3<FishF>, unsigned int> calcRepulsion(const FishF &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FishF> &cells,
+  const std::vector<StencilRun> &repulsion_runs);
+template std::tuple<SumVect3<FishF>, unsigned int> calcAttraction(const FishF &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FishF> &cells,
+  const std::vector<StencilRun> &attractive_runs);
+template std::tuple<SumVect3<FishF>, unsigned int> calcAttraction(const FishF &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FishF> &cells,
+  const std::vector<StencilRun> &attractive_runs,
+  double opening_angle);
+template std::tuple<SumVect3<FishF>, unsigned int> calcRepulsion(const FishF &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FishF> &tree);
+template std::tuple<SumVect3<FishF>, unsigned int> calcAttraction(const FishF &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FishF> &tree);
+template void calcDeltaVelocities(BasicSchool<FishF> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FishF> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<FishF> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocitiesTiled(BasicSchool<FishF> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FishF> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<FishF> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocities(BasicSchool<FishF> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FishF> &tree);
+template void calcDeltaVelocities(BasicSchool<FishF> &fish,
+  std::size_t n_updated,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FishF> &tree);
+template SumVect3<MixedFish> calcSelfPropulsion(const MixedFish &fish, const FishParam &fish_param);
+template std::tuple<SumVect3<MixedFish>, unsigned int> calcRepulsion(const MixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<MixedFish> &cells,
+  const std::vector<StencilRun> &repulsion_runs);
+template std::tuple<SumVect3<MixedFish>, unsigned int> calcAttraction(const MixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<MixedFish> &cells,
+  const std::vector<StencilRun> &attractive_runs);
+template std::tuple<SumVect3<MixedFish>, unsigned int> calcAttraction(const MixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<MixedFish> &cells,
+  const std::vector<StencilRun> &attractive_runs,
+  double opening_angle);
+template std::tuple<SumVect3<MixedFish>, unsigned int> calcRepulsion(const MixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<MixedFish> &tree);
+template std::tuple<SumVect3<MixedFish>, unsigned int> calcAttraction(const MixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<MixedFish> &tree);
+template void calcDeltaVelocities(BasicSchool<MixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<MixedFish> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<MixedFish> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocitiesTiled(BasicSchool<MixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<MixedFish> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<MixedFish> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocities(BasicSchool<MixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<MixedFish> &tree);
+template void calcDeltaVelocities(BasicSchool<MixedFish> &fish,
+  std::size_t n_updated,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<MixedFish> &tree);
+template SumVect3<FixedFish> calcSelfPropulsion(const FixedFish &fish, const FishParam &fish_param);
+template std::tuple<SumVect3<FixedFish>, unsigned int> calcRepulsion(const FixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FixedFish> &cells,
+  const std::vector<StencilRun> &repulsion_runs);
+template std::tuple<SumVect3<FixedFish>, unsigned int> calcAttraction(const FixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FixedFish> &cells,
+  const std::vector<StencilRun> &attractive_runs);
+template std::tuple<SumVect3<FixedFish>, unsigned int> calcAttraction(const FixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FixedFish> &cells,
+  const std::vector<StencilRun> &attractive_runs,
+  double opening_angle);
+template std::tuple<SumVect3<FixedFish>, unsigned int> calcRepulsion(const FixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FixedFish> &tree);
+template std::tuple<SumVect3<FixedFish>, unsigned int> calcAttraction(const FixedFish &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FixedFish> &tree);
+template void calcDeltaVelocities(BasicSchool<FixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FixedFish> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<FixedFish> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocitiesTiled(BasicSchool<FixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicCellList<FixedFish> &repulsion_cells,
+  const std::vector<StencilRun> &repulsion_runs,
+  const BasicCellList<FixedFish> &attractive_cells,
+  const std::vector<StencilRun> &attractive_runs);
+template void calcDeltaVelocities(BasicSchool<FixedFish> &fish,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FixedFish> &tree);
+template void calcDeltaVelocities(BasicSchool<FixedFish> &fish,
+  std::size_t n_updated,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  const BasicKdTree<FixedFish> &tree);
@@ -2,17 +2,21 @@
 
 #include "coordinate.hpp"
 #include "simulation.hpp"
+#include <array>
+#include <cmath>
 
-Fish::Fish()
+template<typename T>
+BasicFish<T>::BasicFish()
   : m_position({ .x = 0, .y = 0, .z = 0 }), m_velocity({ .x = 0, .y = 0, .z = 0 }),
     m_delta_velocity({ .x = 0, .y = 0, .z = 0 }), m_lambda(0)
 {}
 
-Fish::Fish(Vect3 position, Vect3 velocity, Vect3 delta_velocity, double lambda)
+template<typename T>
+BasicFish<T>::BasicFish(BasicVect3<T> position, BasicVect3<T> velocity, BasicVect3<T> delta_velocity, T lambda)
   : m_position(position), m_velocity(velocity), m_delta_velocity(delta_velocity), m_lambda(lambda)
 {}
 
-void Fish::update(double delta_t, unsigned int len, double dldt)
+template<typename T> void BasicFish<T>::update(T delta_t, unsigned int len, T dldt)
 {
   // TODO: Significant digits may be lost here
   m_velocity += m_delta_velocity * delta_t;
@@ -25,29 +29,142 @@ void Fish::update(double delta_t, unsigned int len, double dldt)
   // Account for the periodic boundary conditions
   m_position = periodic(m_position, len);
 
+  m_lambda - dldt *delta_t > 0 ? m_lambda -= dldt *delta_t : m_lambda = 0;
+}
+
+template<typename T> void BasicFish<T>::update(SimParam sim_param, FishParam fish_param)
+{
+  update(static_cast<T>(sim_param.delta_t),
+    sim_param.length,
+    static_cast<T>(fish_param.attraction_str / fish_param.attraction_duration));
+}
+
+template<typename T> T BasicFish<T>::speed() const { return absolute(m_velocity); }
+
+template<typename T> void BasicFish<T>::setPosition(T x, T y, T z) { m_position = { .x = x, .y = y, .z = z }; }
+
+template<typename T> void BasicFish<T>::setPosition(BasicVect3<T> position) { m_position = position; }
+
+template<typename T> void BasicFish<T>::setLambda(T lambda) { m_lambda = lambda; }
+
+template<typename T> void BasicFish<T>::setVelocity(T vx, T vy, T vz) { m_velocity = { .x = vx, .y = vy, .z = vz }; }
+
+template<typename T> void BasicFish<T>::setVelocity(BasicVect3<T> velocity) { m_velocity = velocity; }
+
+template<typename T> void BasicFish<T>::setDeltaVelocity(T delta_vx, T delta_vy, T delta_vz)
+{
+  m_delta_velocity = { .x = delta_vx, .y = delta_vy, .z = delta_vz };
+}
+
+template<typename T> void BasicFish<T>::setDeltaVelocity(BasicVect3<T> delta_velocity)
+{
+  m_delta_velocity = delta_velocity;
+}
+
+template class BasicFish<double>;
+template class BasicFish<float>;
+
+// Move the whole cells of the offset into the cell, wrapping the cell around the box
+void carryOffset(int &cell, float &offset, unsigned int len)
+{
+  float whole = std::floor(offset);
+  if (whole == 0) { return; }
+  offset -= whole;
+  // A tiny negative offset rounds up to a whole cell, which is the cell it started from
+  if (offset >= 1.0F) {
+    offset = 0;
+    whole += 1;
+  }
+  const auto length = static_cast<int>(len);
+  cell = ((cell + static_cast<int>(whole)) % length + length) % length;
+}
+
+MixedFish::MixedFish()
+  : m_cell({ 0, 0, 0 }), m_offset({ .x = 0, .y = 0, .z = 0 }), m_velocity({ .x = 0, .y = 0, .z = 0 }),
+    m_delta_velocity({ .x = 0, .y = 0, .z = 0 }), m_lambda(0)
+{}
+
+MixedFish::MixedFish(const Fish &other)
+  : m_cell({ 0, 0, 0 }), m_offset({ .x = 0, .y = 0, .z = 0 }), m_velocity(castVect3<float>(other.getVelocity())),
+    m_delta_velocity(other.getDeltaVelocity()), m_lambda(other.getLambda())
+{
+  setPosition(other.getPosition());
+}
+
+void MixedFish::update(double delta_t, unsigned int len, double dldt)
+{
+  // Integrate in double, keeping only the velocity and the step of the position in float
+  const Vect3 velocity = castVect3<double>(m_velocity) + m_delta_velocity * delta_t;
+  m_velocity = castVect3<float>(velocity);
+
+  // Reset the delta velocity
+  m_delta_velocity = { .x = 0, .y = 0, .z = 0 };
+
+  m_offset += castVect3<float>(velocity * delta_t);
+
+  // Account for the periodic boundary conditions
+  carryOffset(m_cell[0], m_offset.x, len);
+  carryOffset(m_cell[1], m_offset.y, len);
+  carryOffset(m_cell[2], m_offset.z, len);
+
   m_lambda - dldt *delta_t > 0 ? m_lambda -= dldt *delta_t : m_lambda = 0.0;
 }
 
-void Fish::update(SimParam sim_param, FishParam fish_param)
+void MixedFish::update(SimParam sim_param, FishParam fish_param)
 {
   update(sim_param.delta_t, sim_param.length, fish_param.attraction_str / fish_param.attraction_duration);
 }
 
-double Fish::speed() const { return absolute(m_velocity); }
+double MixedFish::speed() const { return absolute(castVect3<double>(m_velocity)); }
 
-void Fish::setPosition(double x, double y, double z) { m_position = { .x = x, .y = y, .z = z }; }
+void MixedFish::setPosition(Vect3 position)
+{
+  const Vect3 cell{ .x = std::floor(position.x), .y = std::floor(position.y), .z = std::floor(position.z) };
+  m_cell = { static_cast<int>(cell.x), static_cast<int>(cell.y), static_cast<int>(cell.z) };
+  m_offset = castVect3<float>(position - cell);
+}
 
-void Fish::setPosition(Vect3 position) { m_position = position; }
+void MixedFish::setLambda(double lambda) { m_lambda = lambda; }
 
-void Fish::setLambda(double lambda) { m_lambda = lambda; }
+void MixedFish::setVelocity(Vect3 velocity) { m_velocity = castVect3<float>(velocity); }
 
-void Fish::setVelocity(double vx, double vy, double vz) { m_velocity = { .x = vx, .y = vy, .z = vz }; }
+void MixedFish::setDeltaVelocity(Vect3 delta_velocity) { m_delta_velocity = delta_velocity; }
 
-void Fish::setVelocity(Vect3 velocity) { m_velocity = velocity; }
+FixedFish::FixedFish()
+  : m_position({ .x = 0, .y = 0, .z = 0 }), m_velocity({ .x = 0, .y = 0, .z = 0 }),
+    m_delta_velocity({ .x = 0, .y = 0, .z = 0 }), m_lambda(0)
+{}
 
-void Fish::setDeltaVelocity(double delta_vx, double delta_vy, double delta_vz)
+FixedFish::FixedFish(const Fish &other, unsigned int len)
+  : m_position(toFixed(other.getPosition(), len)), m_velocity(other.getVelocity()),
+    m_delta_velocity(other.getDeltaVelocity()), m_lambda(other.getLambda())
+{}
+
+void FixedFish::update(double delta_t, unsigned int len, double dldt)
 {
-  m_delta_velocity = { .x = delta_vx, .y = delta_vy, .z = delta_vz };
+  m_velocity += m_delta_velocity * delta_t;
+
+  // Reset the delta velocity
+  m_delta_velocity = { .x = 0, .y = 0, .z = 0 };
+
+  // The step wraps around the box by the overflow of the coordinates
+  const FixedVect3 step = toFixed(m_velocity * delta_t, len);
+  m_position = { .x = m_position.x + step.x, .y = m_position.y + step.y, .z = m_position.z + step.z };
+
+  m_lambda - dldt *delta_t > 0 ? m_lambda -= dldt *delta_t : m_lambda = 0.0;
+}
+
+void FixedFish::update(SimParam sim_param, FishParam fish_param)
+{
+  update(sim_param.delta_t, sim_param.length, fish_param.attraction_str / fish_param.attraction_duration);
 }
 
-void Fish::setDeltaVelocity(Vect3 delta_velocity) { m_delta_velocity = delta_velocity; }
+double FixedFish::speed() const { return absolute(m_velocity); }
+
+void FixedFish::setPosition(Vect3 position, unsigned int len) { m_position = toFixed(position, len); }
+
+void FixedFish::setLambda(double lambda) { m_lambda = lambda; }
+
+void FixedFish::setVelocity(Vect3 velocity) { m_velocity = velocity; }
+
+void FixedFish::setDeltaVelocity(Vect3 delta_velocity) { m_delta_velocity = delta_velocity; }
@@ -0,0 +1,166 @@
+#include "fishschool.h"
+
+#include "driver.hpp"
+#include "fish.hpp"
+#include "io.hpp"
+#include "simulation.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <yaml-cpp/yaml.h>
+
+// The opaque handle of the C interface
+struct fishschool
+{
+  Simulation simulation;
+};
+
+namespace {
+
+// The views step from fish to fish in whole doubles
+static_assert(sizeof(Fish) % sizeof(double) == 0);
+constexpr std::size_t fish_stride = sizeof(Fish) / sizeof(double);
+
+struct CheckpointHeader
+{
+  std::uint32_t version;
+  std::uint32_t step;
+  std::uint64_t n_fish;
+};
+
+constexpr std::size_t doubles_per_fish = 7;// Position, velocity and lambda
+
+fishschool_view makeView(const School &fish, const double *data)
+{
+  return { .data = fish.empty() ? nullptr : data, .n_fish = fish.size(), .stride = fish_stride };
+}
+
+}// namespace
+
+fishschool *fishschool_create(const char *config, unsigned int seed)
+{
+  try {
+    const YAML::Node node = YAML::Load(config);
+    SimParam sim_param{};
+    FishParam fish_param{};
+    if ((node >> sim_param) == EXIT_FAILURE || (node >> fish_param) == EXIT_FAILURE) {
+      std::cerr << "Invalid parameters" << '\n';
+      return nullptr;
+    }
+    // The views and checkpoints are of fish in double precision
+    if (sim_param.precision != Precision::Double) {
+      std::cerr << "libfishschool only runs in double precision" << '\n';
+      return nullptr;
+    }
+
+    std::mt19937 gen(seed);
+    return new fishschool{ Simulation(sim_param, fish_param, makeSphere(sim_param, fish_param, gen)) };
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return nullptr;
+  }
+}
+
+void fishschool_destroy(fishschool *simulation) { delete simulation; }
+
+int fishschool_step(fishschool *simulation, unsigned int n)
+{
+  try {
+    simulation->simulation.step(n);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+size_t fishschool_fish_count(const fishschool *simulation) { return simulation->simulation.getSchool().size(); }
+
+unsigned int fishschool_step_count(const fishschool *simulation) { return simulation->simulation.getStep(); }
+
+double fishschool_time(const fishschool *simulation) { return simulation->simulation.getTime(); }
+
+unsigned int fishschool_length(const fishschool *simulation) { return simulation->simulation.getSimParam().length; }
+
+fishschool_view fishschool_positions(const fishschool *simulation)
+{
+  const School &fish = simulation->simulation.getSchool();
+  return makeView(fish, fish.empty() ? nullptr : fish.front().getPositionData());
+}
+
+fishschool_view fishschool_velocities(const fishschool *simulation)
+{
+  const School &fish = simulation->simulation.getSchool();
+  return makeView(fish, fish.empty() ? nullptr : fish.front().getVelocityData());
+}
+
+size_t fishschool_checkpoint_size(const fishschool *simulation)
+{
+  return sizeof(CheckpointHeader) + simulation->simulation.getSchool().size() * doubles_per_fish * sizeof(double);
+}
+
+int fishschool_checkpoint(const fishschool *simulation, void *buffer, size_t size)
+{
+  if (size < fishschool_checkpoint_size(simulation)) {
+    std::cerr << "The checkpoint needs " << fishschool_checkpoint_size(simulation) << " bytes" << '\n';
+    return EXIT_FAILURE;
+  }
+
+  const School &fish = simulation->simulation.getSchool();
+  const CheckpointHeader header{
+    .version = FISHSCHOOL_CHECKPOINT_VERSION, .step = simulation->simulation.getStep(), .n_fish = fish.size()
+  };
+  auto *bytes = static_cast<unsigned char *>(buffer);
+  std::memcpy(bytes, &header, sizeof(header));
+  bytes += sizeof(header);
+  for (const auto &one_fish : fish) {
+    const auto [x, y, z] = one_fish.getPosition();
+    const auto [vx, vy, vz] = one_fish.getVelocity();
+    const double state[doubles_per_fish] = { x, y, z, vx, vy, vz, one_fish.getLambda() };
+    std::memcpy(bytes, state, sizeof(state));
+    bytes += sizeof(state);
+  }
+  return EXIT_SUCCESS;
+}
+
+int fishschool_restore(fishschool *simulation, const void *buffer, size_t size)
+{
+  const School &current = simulation->simulation.getSchool();
+  CheckpointHeader header{};
+  if (size < sizeof(header)) {
+    std::cerr << "The checkpoint is truncated" << '\n';
+    return EXIT_FAILURE;
+  }
+  const auto *bytes = static_cast<const unsigned char *>(buffer);
+  std::memcpy(&header, bytes, sizeof(header));
+  bytes += sizeof(header);
+  if (header.version != FISHSCHOOL_CHECKPOINT_VERSION) {
+    std::cerr << "Unknown checkpoint version " << header.version << '\n';
+    return EXIT_FAILURE;
+  }
+  if (header.n_fish != current.size() || size < fishschool_checkpoint_size(simulation)) {
+    std::cerr << "The checkpoint holds " << header.n_fish << " fish, the simulation " << current.size() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  try {
+    School fish(current.size(), Fish{});
+    for (auto &one_fish : fish) {
+      double state[doubles_per_fish];
+      std::memcpy(state, bytes, sizeof(state));
+      bytes += sizeof(state);
+      one_fish.setPosition(state[0], state[1], state[2]);
+      one_fish.setVelocity(state[3], state[4], state[5]);
+      one_fish.setLambda(state[6]);
+    }
+    simulation->simulation.restore(fish, header.step);
+  } catch (const std::exception &err) {
+    std::cerr << err.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+#include "grid.hpp"
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+template<typename F>
+BasicCellList<F>::BasicCellList(unsigned int length, unsigned int reach) : BasicCellList(length, length, reach)
+{}
+
+template<typename F>
+BasicCellList<F>::BasicCellList(unsigned int length, unsigned int cells_per_side, unsigned int reach)
+  : m_length(length), m_cells_per_side(cells_per_side),
+    m_cell_size(static_cast<double>(length) / static_cast<double>(cells_per_side)),
+    m_inverse_cell_size(static_cast<double>(cells_per_side) / static_cast<double>(length)),
+    m_wrap_table(getWrapTable(cells_per_side, reach)),
+    m_cell_start(static_cast<std::size_t>(cells_per_side) * cells_per_side * cells_per_side + 1, 0),
+    m_cell_count(static_cast<std::size_t>(cells_per_side) * cells_per_side * cells_per_side, 0),
+    m_plane_count(cells_per_side, 0),
+    m_occupied((static_cast<std::size_t>(cells_per_side) * cells_per_side * cells_per_side + bits_per_word - 1)
+                 / bits_per_word,
+      0)
+{}
+
+template<typename F> void BasicCellList<F>::clear(std::size_t n_fish)
+{
+  std::fill(m_cell_count.begin(), m_cell_count.end(), 0);
+  std::fill(m_plane_count.begin(), m_plane_count.end(), 0);
+  std::fill(m_occupied.begin(), m_occupied.end(), 0);
+  m_fish_cell.resize(n_fish);
+}
+
+template<typename F> void BasicCellList<F>::bin(std::size_t index, const Position &position)
+{
+  const auto [x, y, z] = getCell(position);
+  m_fish_cell[index] = cellIndex(x, y, z);
+  m_cell_count[m_fish_cell[index]]++;
+  m_plane_count[x]++;
+  m_occupied[m_fish_cell[index] / bits_per_word] |= std::uint64_t{ 1 } << (m_fish_cell[index] % bits_per_word);
+}
+
+template<typename F> void BasicCellList<F>::scatter(const BasicSchool<F> &fish, unsigned int slack)
+{
+  // First slot of each cell, leaving the slack free after the fish of the cell
+  m_slack = slack;
+  for (std::size_t cell_index = 0; cell_index < m_cell_count.size(); cell_index++) {
+    m_cell_start[cell_index + 1] = m_cell_start[cell_index] + m_cell_count[cell_index] + slack;
+  }
+
+  // Scatter the fish into their cells, keeping the original order within each cell
+  m_cursor.assign(m_cell_start.begin(), m_cell_start.end() - 1);
+  m_fish.resize(m_cell_start.back());
+  m_fish_index.resize(m_cell_start.back());
+  m_position.resize(m_cell_start.back());
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    const unsigned int index = m_cursor[m_fish_cell[i]]++;
+    m_fish[index] = &fish[i];
+    m_fish_index[index] = static_cast<unsigned int>(i);
+    m_position[index] = FishTraits<F>::getPosition(fish[i]);
+  }
+}
+
+template<typename F> void BasicCellList<F>::build(const BasicSchool<F> &fish, unsigned int slack)
+{
+  clear(fish.size());
+  for (std::size_t i = 0; i < fish.size(); i++) { bin(i, FishTraits<F>::getPosition(fish[i])); }
+  scatter(fish, slack);
+}
+
+template<typename F>
+void BasicCellList<F>::build(const BasicSchool<F> &fish,
+  BasicCellList &first,
+  BasicCellList &second,
+  unsigned int slack)
+{
+  first.clear(fish.size());
+  second.clear(fish.size());
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    const Position position = FishTraits<F>::getPosition(fish[i]);
+    first.bin(i, position);
+    second.bin(i, position);
+  }
+  first.scatter(fish, slack);
+  second.scatter(fish, slack);
+}
+
+template<typename F> void BasicCellList<F>::update(const BasicSchool<F> &fish)
+{
+  assert(fish.size() == m_fish_cell.size());
+  const auto n_cells = static_cast<unsigned int>(m_cell_count.size());
+
+  // Refresh the positions and collect the fish that changed cells. Room is kept for every fish to move, and the
+  // threads hand their moves over in batches of a fixed size, so that the updates allocate nothing.
+  m_moves.clear();
+  m_moves.reserve(fish.size());
+#pragma omp parallel default(none) shared(fish, n_cells)
+  {
+    std::array<CellMove, move_batch_size> moves{};
+    std::size_t n_batched = 0;
+    const auto handOver = [&]() {
+#pragma omp critical
+      m_moves.insert(m_moves.end(), moves.begin(), std::next(moves.begin(), static_cast<std::ptrdiff_t>(n_batched)));
+      n_batched = 0;
+    };
+
+#pragma omp for schedule(static) nowait
+    for (unsigned int cell_index = 0; cell_index < n_cells; cell_index++) {
+      const IndexRange range = getCellRange(cell_index);
+      for (unsigned int slot = range.begin; slot < range.end; slot++) {
+        m_position[slot] = FishTraits<F>::getPosition(fish[m_fish_index[slot]]);
+        const auto [x, y, z] = getCell(m_position[slot]);
+        const unsigned int new_cell = cellIndex(x, y, z);
+        if (new_cell == cell_index) { continue; }
+        moves[n_batched++] = { .fish_index = m_fish_index[slot], .from = cell_index, .to = new_cell };
+        if (n_batched == move_batch_size) { handOver(); }
+      }
+    }
+    handOver();
+  }
+  if (m_moves.empty()) { return; }
+
+  // Remove the fish from the cells they left, keeping the order of the remaining fish.
+  // Each cell is compacted by one thread, in an order independent of the threads that found the moves.
+  for (const auto &move : m_moves) { m_fish_cell[move.fish_index] = move.to; }
+  std::sort(m_moves.begin(), m_moves.end(), [](const CellMove &lhs, const CellMove &rhs) {
+    return lhs.from != rhs.from ? lhs.from < rhs.from : lhs.fish_index < rhs.fish_index;
+  });
+  const auto n_moves = static_cast<unsigned int>(m_moves.size());
+#pragma omp parallel for default(none) shared(n_moves) schedule(dynamic)
+  for (unsigned int i = 0; i < n_moves; i++) {
+    if (i != 0 && m_moves[i].from == m_moves[i - 1].from) { continue; }
+
+    const unsigned int cell_index = m_moves[i].from;
+    const IndexRange range = getCellRange(cell_index);
+    unsigned int kept = range.begin;
+    for (unsigned int slot = range.begin; slot < range.end; slot++) {
+      if (m_fish_cell[m_fish_index[slot]] != cell_index) { continue; }
+      m_fish[kept] = m_fish[slot];
+      m_fish_index[kept] = m_fish_index[slot];
+      m_position[kept] = m_position[slot];
+      kept++;
+    }
+    m_cell_count[cell_index] = kept - range.begin;
+  }
+
+  // Rebuild from scratch if a cell has no room left for the fish entering it
+  std::sort(m_moves.begin(), m_moves.end(), [](const CellMove &lhs, const CellMove &rhs) {
+    return lhs.to != rhs.to ? lhs.to < rhs.to : lhs.fish_index < rhs.fish_index;
+  });
+  for (unsigned int i = 0; i < n_moves;) {
+    unsigned int last = i;
+    while (last < n_moves && m_moves[last].to == m_moves[i].to) { last++; }
+    const unsigned int cell_index = m_moves[i].to;
+    if (m_cell_count[cell_index] + (last - i) > m_cell_start[cell_index + 1] - m_cell_start[cell_index]) {
+      build(fish, m_slack);
+      return;
+    }
+    i = last;
+  }
+
+  // Append the fish to the cells they entered
+#pragma omp parallel for default(none) shared(fish, n_moves) schedule(dynamic)
+  for (unsigned int i = 0; i < n_moves; i++) {
+    if (i != 0 && m_moves[i].to == m_moves[i - 1].to) { continue; }
+
+    const unsigned int cell_index = m_moves[i].to;
+    for (unsigned int j = i; j < n_moves && m_moves[j].to == cell_index; j++) {
+      const unsigned int slot = m_cell_start[cell_index] + m_cell_count[cell_index]++;
+      m_fish[slot] = &fish[m_moves[j].fish_index];
+      m_fish_index[slot] = m_moves[j].fish_index;
+      m_position[slot] = FishTraits<F>::getPosition(fish[m_moves[j].fish_index]);
+    }
+  }
+
+  // Update the counts of the planes and the occupancy of the cells
+  const unsigned int plane_size = m_cells_per_side * m_cells_per_side;
+  for (const auto &move : m_moves) {
+    m_plane_count[move.from / plane_size]--;
+    m_plane_count[move.to / plane_size]++;
+    m_occupied[move.to / bits_per_word] |= std::uint64_t{ 1 } << (move.to % bits_per_word);
+    if (m_cell_count[move.from] == 0) {
+      m_occupied[move.from / bits_per_word] &= ~(std::uint64_t{ 1 } << (move.from % bits_per_word));
+    }
+  }
+}
+
+template<typename F> void BasicCellList<F>::computeCentroids()
+{
+  const auto n_cells = static_cast<unsigned int>(m_cell_count.size());
+  m_centroid.resize(n_cells);
+
+#pragma omp parallel for default(none) shared(n_cells) schedule(static)
+  for (unsigned int cell_index = 0; cell_index < n_cells; cell_index++) {
+    const IndexRange range = getCellRange(cell_index);
+    if (range.begin == range.end) { continue; }
+
+    // The cells do not wrap around the box, so the plain mean lies within the cell
+    Vect3 sum{ .x = 0.0, .y = 0.0, .z = 0.0 };
+    for (unsigned int i = range.begin; i < range.end; i++) { sum += toVect3(m_position[i], m_length); }
+    m_centroid[cell_index] = sum / static_cast<double>(range.end - range.begin);
+  }
+}
+
+template class BasicCellList<Fish>;
+template class BasicCellList<FishF>;
+template class BasicCellList<MixedFish>;
+template class BasicCellList<FixedFish>;
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <yaml-cpp/exceptions.h>
 #include <yaml-cpp/node/node.h>
 
@@ -18,6 +19,155 @@ int operator>>(const YAML::Node &node, SimParam &param)
     param.max_steps = sim_params["max-steps"].as<unsigned int>();
     param.delta_t = sim_params["delta-t"].as<double>();
     param.snapshot_interval = sim_params["snapshot-interval"].as<unsigned int>();
+
+    // Optional parameters
+    if (sim_params["cell-grid"]) {
+      const auto cell_grid = sim_params["cell-grid"].as<std::string>();
+      if (cell_grid == "unit") {
+        param.cell_grid = CellGrid::Unit;
+      } else if (cell_grid == "two-level") {
+        param.cell_grid = CellGrid::TwoLevel;
+      } else {
+        std::cerr << "Unknown cell-grid: " << cell_grid << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["rebuild-interval"]) {
+      param.rebuild_interval = sim_params["rebuild-interval"].as<unsigned int>();
+      if (param.rebuild_interval == 0) {
+        std::cerr << "rebuild-interval must be positive" << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["attraction-opening-angle"]) {
+      param.attraction_opening_angle = sim_params["attraction-opening-angle"].as<double>();
+      if (param.attraction_opening_angle < 0) {
+        std::cerr << "attraction-opening-angle must not be negative" << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["all-pairs-threshold"]) {
+      param.all_pairs_threshold = sim_params["all-pairs-threshold"].as<unsigned int>();
+    }
+    if (sim_params["kd-tree-threshold"]) {
+      param.kd_tree_threshold = sim_params["kd-tree-threshold"].as<unsigned int>();
+    }
+
+    if (sim_params["precision"]) {
+      const auto precision = sim_params["precision"].as<std::string>();
+      if (precision == "double") {
+        param.precision = Precision::Double;
+      } else if (precision == "float") {
+        param.precision = Precision::Float;
+      } else if (precision == "mixed") {
+        param.precision = Precision::Mixed;
+      } else if (precision == "fixed") {
+        param.precision = Precision::Fixed;
+      } else {
+        std::cerr << "Unknown precision: " << precision << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (sim_params["thread-affinity"]) {
+      const auto thread_affinity = sim_params["thread-affinity"].as<std::string>();
+      if (thread_affinity == "none") {
+        param.thread_affinity = ThreadAffinity::None;
+      } else if (thread_affinity == "close") {
+        param.thread_affinity = ThreadAffinity::Close;
+      } else if (thread_affinity == "spread") {
+        param.thread_affinity = ThreadAffinity::Spread;
+      } else {
+        std::cerr << "Unknown thread-affinity: " << thread_affinity << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["huge-pages"]) { param.huge_pages = sim_params["huge-pages"].as<bool>(); }
+    if (sim_params["load-imbalance"]) {
+      param.load_imbalance = sim_params["load-imbalance"].as<double>();
+      if (param.load_imbalance < 1) {
+        std::cerr << "load-imbalance must be at least 1" << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["rebalance-interval"]) {
+      param.rebalance_interval = sim_params["rebalance-interval"].as<unsigned int>();
+      if (param.rebalance_interval == 0) {
+        std::cerr << "rebalance-interval must be positive" << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["observables-interval"]) {
+      param.observables_interval = sim_params["observables-interval"].as<unsigned int>();
+    }
+    if (sim_params["cluster-radius"]) {
+      param.cluster_radius = sim_params["cluster-radius"].as<double>();
+      if (param.cluster_radius < 0) {
+        std::cerr << "cluster-radius must be non-negative" << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["rdf-bins"]) { param.rdf_bins = sim_params["rdf-bins"].as<unsigned int>(); }
+    if (sim_params["field-resolution"]) { param.field_resolution = sim_params["field-resolution"].as<unsigned int>(); }
+    if (sim_params["output-mode"]) {
+      const auto output_mode = sim_params["output-mode"].as<std::string>();
+      if (output_mode == "fish") {
+        param.output_mode = OutputMode::Fish;
+      } else if (output_mode == "voxels") {
+        param.output_mode = OutputMode::Voxels;
+      } else {
+        std::cerr << "Unknown output-mode: " << output_mode << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["output-resolution"]) {
+      param.output_resolution = sim_params["output-resolution"].as<unsigned int>();
+      if (param.output_resolution == 0) {
+        std::cerr << "output-resolution must be positive" << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (sim_params["output-sample"]) { param.output_sample = sim_params["output-sample"].as<unsigned int>(); }
+    if ((param.cluster_radius > 0 || param.rdf_bins > 0 || param.field_resolution > 0)
+        && param.observables_interval == 0) {
+      std::cerr << "cluster-radius, rdf-bins and field-resolution require observables-interval" << '\n';
+      return EXIT_FAILURE;
+    }
+
+    // The smallest schools are faster without any neighbour search, and small ones with the k-d tree, which builds
+    // no grid over the whole box, unless another search is asked for or a key of the cell lists is set
+    param.neighbour_search = NeighbourSearch::Cell;
+    const bool cell_keys =
+      sim_params["cell-grid"] || sim_params["rebuild-interval"] || param.attraction_opening_angle > 0;
+    if (!cell_keys && param.n_fish < param.all_pairs_threshold) {
+      param.neighbour_search = NeighbourSearch::AllPairs;
+    } else if (!cell_keys && param.n_fish < param.kd_tree_threshold) {
+      param.neighbour_search = NeighbourSearch::KdTree;
+    }
+    if (sim_params["neighbour-search"]) {
+      const auto neighbour_search = sim_params["neighbour-search"].as<std::string>();
+      if (neighbour_search == "cell") {
+        param.neighbour_search = NeighbourSearch::Cell;
+      } else if (neighbour_search == "tiled") {
+        param.neighbour_search = NeighbourSearch::Tiled;
+      } else if (neighbour_search == "kd-tree") {
+        param.neighbour_search = NeighbourSearch::KdTree;
+      } else if (neighbour_search == "all-pairs") {
+        param.neighbour_search = NeighbourSearch::AllPairs;
+      } else {
+        std::cerr << "Unknown neighbour-search: " << neighbour_search << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (param.attraction_opening_angle > 0 && param.neighbour_search != NeighbourSearch::Cell) {
+      std::cerr << "attraction-opening-angle is only supported with the cell neighbour-search" << '\n';
+      return EXIT_FAILURE;
+    }
+    if ((param.cell_grid == CellGrid::TwoLevel || param.rebuild_interval > 1)
+        && (param.neighbour_search == NeighbourSearch::KdTree || param.neighbour_search == NeighbourSearch::AllPairs)) {
+      std::cerr << "cell-grid and rebuild-interval are only supported with the cell and tiled neighbour-search" << '\n';
+      return EXIT_FAILURE;
+    }
   } catch (YAML::Exception &e) {
     std::cerr << "Error while reading from file: " << e.what() << '\n';
     return EXIT_FAILURE;
@@ -52,6 +202,10 @@ int parseArguments(int argc, char **argv, argparse::ArgumentParser &program)
 
   program.add_argument("-o", "--output").help("The path to the output file").default_value(std::string("output.txt"));
 
+  program.add_argument("--simd")
+    .help("Force the vector instructions of the kernels: generic, sse4.2, avx2 or avx512")
+    .default_value(std::string("auto"));
+
   try {
     program.parse_args(argc, argv);
   } catch (const std::runtime_error &err) {
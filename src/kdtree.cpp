@@ -0,0 +1,139 @@
+#include "kdtree.hpp"
+
+#include "coordinate.hpp"
+#include "fish.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template<typename F> void BasicKdTree<F>::build(const BasicSchool<F> &fish, unsigned int length)
+{
+  m_length = length;
+  m_entries.resize(fish.size());
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    m_entries[i] = { .position = toVect3(FishTraits<F>::getPosition(fish[i]), length),
+      .fish = &fish[i],
+      .index = static_cast<unsigned int>(i) };
+  }
+
+  m_depth = 0;
+  if (m_entries.empty()) { return; }
+
+  // Halve the fish until the leaves, which hold up to ceil(n / 2^depth) fish, hold at most leaf_size of them
+  while (((m_entries.size() - 1) >> m_depth) + 1 > leaf_size) { m_depth++; }
+  m_box.resize((std::size_t{ 2 } << m_depth) - 1);
+
+#pragma omp parallel default(none)
+  {
+#pragma omp single
+    buildNode(0, 0, size(), 0);
+  }
+}
+
+template<typename F>
+void BasicKdTree<F>::buildNode(std::size_t node, unsigned int begin, unsigned int end, unsigned int level)
+{
+  Box &box = m_box[node];
+  box = { .lower = m_entries[begin].position, .upper = m_entries[begin].position };
+  for (unsigned int i = begin + 1; i < end; i++) {
+    const Vect3 &position = m_entries[i].position;
+    box.lower = { .x = std::min(box.lower.x, position.x),
+      .y = std::min(box.lower.y, position.y),
+      .z = std::min(box.lower.z, position.z) };
+    box.upper = { .x = std::max(box.upper.x, position.x),
+      .y = std::max(box.upper.y, position.y),
+      .z = std::max(box.upper.z, position.z) };
+  }
+  if (level == m_depth) { return; }
+
+  // Split at the median along the longest side of the box
+  const Vect3 extent = box.upper - box.lower;
+  double Vect3::*axis = &Vect3::x;
+  if (extent.y > extent.x && extent.y >= extent.z) { axis = &Vect3::y; }
+  if (extent.z > extent.x && extent.z > extent.y) { axis = &Vect3::z; }
+
+  const unsigned int mid = begin + (end - begin) / 2;
+  std::nth_element(m_entries.begin() + begin,
+    m_entries.begin() + mid,
+    m_entries.begin() + end,
+    [axis](const Entry &lhs, const Entry &rhs) { return lhs.position.*axis < rhs.position.*axis; });
+
+  if (end - begin > task_size) {
+#pragma omp task default(none) firstprivate(node, begin, mid, level)
+    buildNode(2 * node + 1, begin, mid, level + 1);
+#pragma omp task default(none) firstprivate(node, mid, end, level)
+    buildNode(2 * node + 2, mid, end, level + 1);
+#pragma omp taskwait
+  } else {
+    buildNode(2 * node + 1, begin, mid, level + 1);
+    buildNode(2 * node + 2, mid, end, level + 1);
+  }
+}
+
+template<typename F>
+void BasicKdTree<F>::findNearest(const Vect3 &position,
+  std::size_t n_nearest,
+  double radius,
+  const F *exclude,
+  std::vector<std::pair<double, unsigned int>> &nearest) const
+{
+  nearest.clear();
+  if (m_entries.empty() || n_nearest == 0) { return; }
+
+  double squared_radius = radius * radius;
+  findNearest(0, 0, size(), 0, position, exclude, n_nearest, squared_radius, nearest);
+  std::sort_heap(nearest.begin(), nearest.end());
+}
+
+template<typename F>
+void BasicKdTree<F>::findNearest(std::size_t node,
+  unsigned int begin,
+  unsigned int end,
+  unsigned int level,
+  const Vect3 &position,
+  const F *exclude,
+  std::size_t n_nearest,
+  double &squared_radius,
+  std::vector<std::pair<double, unsigned int>> &nearest) const
+{
+  if (squaredBoxDistance(position, node) > squared_radius) { return; }
+
+  if (level == m_depth) {
+    // Keep the nearest fish found so far in a max-heap, shrinking the radius once it is full
+    const double radius = std::sqrt(squared_radius);
+    for (unsigned int i = begin; i < end; i++) {
+      if (m_entries[i].fish == exclude) { continue; }
+      const double distance = absolute(vect12(position, m_entries[i].position, m_length));
+      if (distance > radius) { continue; }
+      if (nearest.size() == n_nearest) {
+        if (std::pair{ distance, i } >= nearest.front()) { continue; }
+        std::pop_heap(nearest.begin(), nearest.end());
+        nearest.pop_back();
+      }
+      nearest.emplace_back(distance, i);
+      std::push_heap(nearest.begin(), nearest.end());
+      if (nearest.size() == n_nearest) { squared_radius = nearest.front().first * nearest.front().first; }
+    }
+    return;
+  }
+
+  // Descend into the nearer child first, so that the radius shrinks before the farther one is visited
+  const unsigned int mid = begin + (end - begin) / 2;
+  const std::size_t left = 2 * node + 1;
+  const std::size_t right = 2 * node + 2;
+  if (squaredBoxDistance(position, left) <= squaredBoxDistance(position, right)) {
+    findNearest(left, begin, mid, level + 1, position, exclude, n_nearest, squared_radius, nearest);
+    findNearest(right, mid, end, level + 1, position, exclude, n_nearest, squared_radius, nearest);
+  } else {
+    findNearest(right, mid, end, level + 1, position, exclude, n_nearest, squared_radius, nearest);
+    findNearest(left, begin, mid, level + 1, position, exclude, n_nearest, squared_radius, nearest);
+  }
+}
+
+template class BasicKdTree<Fish>;
+template class BasicKdTree<FishF>;
+template class BasicKdTree<MixedFish>;
+template class BasicKdTree<FixedFish>;
@@ -1,18 +1,16 @@
-#include "coordinate.hpp"
-#include "eom.hpp"
+#include "analysis.hpp"
+#include "cpu.hpp"
+#include "driver.hpp"
 #include "fish.hpp"
 #include "io.hpp"
+#include "memory.hpp"
 #include "simulation.hpp"
 #include <argparse/argparse.hpp>
-#include <cmath>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
-#include <numbers>
-#include <omp.h>
 #include <random>
 #include <string>
-#include <vector>
 #include <yaml-cpp/node/node.h>
 #include <yaml-cpp/node/parse.h>
 
@@ -26,6 +24,21 @@ int main(int argc, char *argv[])
     return 1;
   }
 
+  // Use the newest vector instructions of the processor unless told otherwise
+  const auto simd = program.get<std::string>("--simd");
+  if (simd != "auto") {
+    SimdLevel simd_level{};
+    if (parseSimdLevel(simd, simd_level) == EXIT_FAILURE) {
+      std::cerr << "Unknown vector instructions: " << simd << '\n';
+      return 1;
+    }
+    if (setSimdLevel(simd_level) == EXIT_FAILURE) {
+      std::cerr << "The processor does not support " << simd << ", only up to "
+                << toString(getSupportedSimdLevel()) << '\n';
+      return 1;
+    }
+  }
+  std::cout << "Vector instructions: " << toString(getSimdLevel()) << '\n';
 
   // Load the parameters from the YAML file
   const YAML::Node config = YAML::LoadFile(program.get<std::string>("--config"));
@@ -42,6 +55,12 @@ int main(int argc, char *argv[])
     return 1;
   }
 
+  // Pin the threads before the school and the cell lists are first touched by them
+  setHugePages(sim_param.huge_pages);
+  if (pinThreads(sim_param.thread_affinity) == EXIT_FAILURE) {
+    std::cerr << "Could not pin the threads, leaving them to the OpenMP runtime" << '\n';
+  }
+
   // Output file
   std::ofstream output_file("output.txt");
 
@@ -60,86 +79,37 @@ int main(int argc, char *argv[])
   // Initialize fish with a shere
   std::random_device rand;
   std::mt19937 gen(rand());
-  const double init_r = fish_param.repulsion_radius * cbrt(sim_param.n_fish);
-  std::uniform_real_distribution<double> dis_r(0.0, init_r);
-  std::uniform_real_distribution<double> dis_theta(0.0, 2 * std::numbers::pi);
-  std::uniform_real_distribution<double> dis_phi(0.0, std::numbers::pi);
-
-  std::vector<Fish> fish(sim_param.n_fish, Fish{});
-  for (auto &one_fish : fish) {
-    const double r_init = dis_r(gen);
-    const double theta = dis_theta(gen);
-    const double phi = dis_phi(gen);
-    one_fish.setPosition({ .x = r_init * std::sin(phi) * std::cos(theta) + static_cast<double>(sim_param.length) / 2,
-      .y = r_init * std::sin(phi) * std::sin(theta) + static_cast<double>(sim_param.length) / 2,
-      .z = r_init * std::cos(phi) + static_cast<double>(sim_param.length) / 2 });
-    one_fish.setVelocity({ .x = fish_param.vel_standard, .y = 0, .z = 0 });
+  School fish = makeSphere(sim_param, fish_param, gen);
+
+  // Time series of the analysis, if asked for
+  std::ofstream observables_file{};
+  std::ofstream clusters_file{};
+  std::ofstream cluster_labels_file{};
+  AnalysisOutput analysis{};
+  if (sim_param.observables_interval > 0) {
+    observables_file.open("observables.txt");
+    analysis.observables = &observables_file;
   }
+  if (sim_param.cluster_radius > 0) {
+    clusters_file.open("clusters.txt");
+    cluster_labels_file.open("cluster_labels.txt");
+    analysis.clusters = &clusters_file;
+    analysis.cluster_labels = &cluster_labels_file;
+  }
+  std::ofstream field_file{};
+  if (sim_param.field_resolution > 0) {
+    field_file.open("field.txt");
+    analysis.field = &field_file;
+  }
+  RadialDistribution radial_distribution(fish_param.attraction_radius, sim_param.rdf_bins);
+  if (sim_param.rdf_bins > 0) { analysis.radial_distribution = &radial_distribution; }
 
-  // Pre-generate the relative positions of the neighboring cells
-  const auto repulsion_boundary = getBoundaryCells(fish_param.repulsion_radius);
-  const auto repulsion_inner = getInnerCells(fish_param.repulsion_radius);
-
-  const auto attractive_boundary = getBoundaryBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
-  const auto attractive_inner = getInnerBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
-
-  // Main loop
-  for (unsigned int time_step = 0; time_step < sim_param.max_steps; time_step++) {
-
-
-    std::cout << "Time step: " << time_step << '\n';
-
-    std::vector<std::vector<std::vector<std::vector<Fish *>>>> cells(sim_param.length,
-      std::vector<std::vector<std::vector<Fish *>>>(
-        sim_param.length, std::vector<std::vector<Fish *>>(sim_param.length)));
-
-    // Sort the fish into 1x1x1 grid cells
-    for (auto &one_fish : fish) {
-      auto [x_pos, y_pos, z_pos] = one_fish.getPosition();
-      auto x = static_cast<unsigned long>(x_pos);
-      auto y = static_cast<unsigned long>(y_pos);
-      auto z = static_cast<unsigned long>(z_pos);
-
-      cells[x][y][z].push_back(&one_fish);
-    }
-
-// Loop over the fish and store the delta velocity
-#pragma omp parallel default(none) shared(cells, fish), \
-  firstprivate(fish_param, sim_param, repulsion_boundary, repulsion_inner, attractive_boundary, attractive_inner)
-    {
-#pragma omp for schedule(static)
-      for (auto &one_fish : fish) {
-
-        // Calculate the self-propulsion
-        auto delta_v_self = calcSelfPropulsion(one_fish, fish_param);
-
-        auto [delta_v_repulsion, n_fish_repulsion] =
-          calcRepulsion(one_fish, sim_param, fish_param, cells, repulsion_boundary, repulsion_inner);
-
-        if (n_fish_repulsion < fish_param.n_cog) { one_fish.setLambda(fish_param.attraction_str); }
-
-        if (one_fish.getLambda() > 0) {
-          auto [delta_v_attraction, n_fish_attrac] =
-            calcAttraction(one_fish, sim_param, fish_param, cells, attractive_boundary, attractive_inner);
-
-          one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion + delta_v_attraction);
-        } else {
-          one_fish.setDeltaVelocity(delta_v_self + delta_v_repulsion);
-        }
-      }
-    }
-
-    // Update the fish positions and velocities
-    for (auto &one_fish : fish) { one_fish.update(sim_param, fish_param); }
+  simulate(fish, sim_param, fish_param, makeStencils(sim_param, fish_param), output_file, true, analysis);
 
-    if (time_step % sim_param.snapshot_interval == 0) {
-      // Output the fish positions
-      for (auto &one_fish : fish) {
-        auto [x, y, z] = one_fish.getPosition();
-        auto [vx, vy, vz] = one_fish.getVelocity();
-        output_file << x << " " << y << " " << z << " " << vx << " " << vy << " " << vz << '\n';
-      }
-    }
+  // Over all the analysed steps
+  if (sim_param.rdf_bins > 0) {
+    std::ofstream rdf_file("rdf.txt");
+    radial_distribution.write(rdf_file);
   }
 
   output_file.close();
@@ -0,0 +1,89 @@
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t first_touch_threshold = std::size_t{ 64 } << 10;// Smaller arrays come from operator new
+constexpr std::size_t huge_page_size = std::size_t{ 2 } << 20;
+
+bool &hugePages()
+{
+  static bool huge_pages = false;
+  return huge_pages;
+}
+
+#if defined(__linux__)
+// Length of the mapping of an array. Arrays of at least a huge page are mapped in whole huge pages whether or not
+// they are backed by them, so that the length does not depend on the setting at the time of the deallocation.
+std::size_t mappingLength(std::size_t bytes)
+{
+  const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t granule = bytes >= huge_page_size ? huge_page_size : page_size;
+  return (bytes + granule - 1) / granule * granule;
+}
+
+void *mapFresh(std::size_t bytes)
+{
+  const std::size_t length = mappingLength(bytes);
+  if (length < huge_page_size) {
+    void *pointer = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pointer == MAP_FAILED) { throw std::bad_alloc(); }
+    return pointer;
+  }
+
+  // Map a huge page more than needed and trim it, so that the array starts on a huge page boundary
+  void *mapping = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) { throw std::bad_alloc(); }
+  const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+  const std::uintptr_t aligned = (address + huge_page_size - 1) / huge_page_size * huge_page_size;
+  if (aligned != address) { munmap(mapping, aligned - address); }
+  munmap(reinterpret_cast<void *>(aligned + length), address + huge_page_size - aligned);
+
+  auto *pointer = reinterpret_cast<void *>(aligned);
+  if (hugePages()) { madvise(pointer, length, MADV_HUGEPAGE); }
+  return pointer;
+}
+#endif
+
+}// namespace
+
+void setHugePages(bool enable) { hugePages() = enable; }
+
+bool getHugePages() { return hugePages(); }
+
+void *allocateFirstTouch(std::size_t n, std::size_t element_size)
+{
+  const std::size_t bytes = n * element_size;
+#if defined(__linux__)
+  if (bytes >= first_touch_threshold) {
+    auto *pointer = static_cast<unsigned char *>(mapFresh(bytes));
+
+    // The fresh pages are placed on the node of the thread that touches them first
+#pragma omp parallel for default(none) shared(pointer, n, element_size) schedule(static)
+    for (std::size_t i = 0; i < n; i++) { std::memset(pointer + i * element_size, 0, element_size); }
+    return pointer;
+  }
+#endif
+  return ::operator new(bytes);
+}
+
+void deallocateFirstTouch(void *pointer, std::size_t n, std::size_t element_size)
+{
+  const std::size_t bytes = n * element_size;
+#if defined(__linux__)
+  if (bytes >= first_touch_threshold) {
+    munmap(pointer, mappingLength(bytes));
+    return;
+  }
+#endif
+  ::operator delete(pointer);
+}
@@ -0,0 +1,186 @@
+#include "coordinate.hpp"
+#include "cpu.hpp"
+#include "domain.hpp"
+#include "eom.hpp"
+#include "fish.hpp"
+#include "io.hpp"
+#include "kdtree.hpp"
+#include "memory.hpp"
+#include "simulation.hpp"
+#include <argparse/argparse.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mpi.h>
+#include <numbers>
+#include <omp.h>
+#include <random>
+#include <span>
+#include <string>
+#include <yaml-cpp/node/node.h>
+#include <yaml-cpp/node/parse.h>
+
+namespace {
+
+// Output the fish positions and velocities, one fish per line
+void writeSnapshot(std::ofstream &output_file, std::span<const Fish> fish)
+{
+  for (const auto &one_fish : fish) {
+    auto [x, y, z] = one_fish.getPosition();
+    auto [vx, vy, vz] = one_fish.getVelocity();
+    output_file << x << " " << y << " " << z << " " << vx << " " << vy << " " << vz << '\n';
+  }
+}
+
+int run(int argc, char *argv[], int rank, int size)
+{
+  // Every rank parses the command line and the configuration, only rank 0 reports the errors
+  argparse::ArgumentParser program("fish_schooling_mpi");
+  if (parseArguments(argc, argv, program) == EXIT_FAILURE) {
+    if (rank == 0) { std::cout << program; }
+    return EXIT_FAILURE;
+  }
+
+  const auto simd = program.get<std::string>("--simd");
+  if (simd != "auto") {
+    SimdLevel simd_level{};
+    if (parseSimdLevel(simd, simd_level) == EXIT_FAILURE || setSimdLevel(simd_level) == EXIT_FAILURE) {
+      if (rank == 0) { std::cerr << "Unknown or unsupported vector instructions: " << simd << '\n'; }
+      return EXIT_FAILURE;
+    }
+  }
+
+  const YAML::Node config = YAML::LoadFile(program.get<std::string>("--config"));
+  FishParam fish_param{};
+  SimParam sim_param{};
+  if ((config >> fish_param) == EXIT_FAILURE || (config >> sim_param) == EXIT_FAILURE) {
+    if (rank == 0) { std::cerr << "Error reading the parameters" << '\n'; }
+    return EXIT_FAILURE;
+  }
+  if (sim_param.output_mode != OutputMode::Fish) {
+    if (rank == 0) { std::cerr << "fish_schooling_mpi only writes the fish, not the voxels" << '\n'; }
+    return EXIT_FAILURE;
+  }
+
+  // The ranks always search a k-d tree in double precision, so refuse the keys they would otherwise ignore
+  const YAML::Node neighbour_search = config["simulation-params"]["neighbour-search"];
+  if ((neighbour_search && neighbour_search.as<std::string>() != "kd-tree") || sim_param.cell_grid != CellGrid::Unit
+      || sim_param.rebuild_interval > 1 || sim_param.attraction_opening_angle > 0) {
+    if (rank == 0) {
+      std::cerr << "fish_schooling_mpi only searches a k-d tree, without cell-grid, rebuild-interval or "
+                   "attraction-opening-angle"
+                << '\n';
+    }
+    return EXIT_FAILURE;
+  }
+  if (sim_param.precision != Precision::Double) {
+    if (rank == 0) { std::cerr << "fish_schooling_mpi only runs in double precision" << '\n'; }
+    return EXIT_FAILURE;
+  }
+  if (sim_param.observables_interval > 0 || sim_param.cluster_radius > 0 || sim_param.rdf_bins > 0
+      || sim_param.field_resolution > 0) {
+    if (rank == 0) {
+      std::cerr << "fish_schooling_mpi writes no observables, clusters, radial distribution or field" << '\n';
+    }
+    return EXIT_FAILURE;
+  }
+
+  setHugePages(sim_param.huge_pages);
+  if (pinThreads(sim_param.thread_affinity) == EXIT_FAILURE) {
+    std::cerr << "Rank " << rank << " could not pin its threads, leaving them to the OpenMP runtime" << '\n';
+  }
+  if (rank == 0) {
+    std::cout << "Ranks: " << size << ", threads per rank: " << omp_get_max_threads() << '\n';
+    std::cout << "Vector instructions: " << toString(getSimdLevel()) << '\n';
+  }
+
+  // The neighbours are searched for in a k-d tree, whose memory follows the fish of the rank rather than the box
+  SlabDecomposition domain(MPI_COMM_WORLD, sim_param.length, fish_param.attraction_radius);
+
+  // Each rank starts its share of the sphere of fish, which are then sent to the ranks owning them
+  std::random_device rand;
+  std::mt19937 gen(rand());
+  const double init_r = fish_param.repulsion_radius * cbrt(sim_param.n_fish);
+  std::uniform_real_distribution<double> dis_r(0.0, init_r);
+  std::uniform_real_distribution<double> dis_theta(0.0, 2 * std::numbers::pi);
+  std::uniform_real_distribution<double> dis_phi(0.0, std::numbers::pi);
+
+  const auto n_ranks = static_cast<unsigned int>(size);
+  const unsigned int n_local =
+    sim_param.n_fish / n_ranks + (static_cast<unsigned int>(rank) < sim_param.n_fish % n_ranks ? 1 : 0);
+  School fish(n_local, Fish{});
+  for (auto &one_fish : fish) {
+    const double r_init = dis_r(gen);
+    const double theta = dis_theta(gen);
+    const double phi = dis_phi(gen);
+    one_fish.setPosition(periodic(
+      Vect3{ .x = r_init * std::sin(phi) * std::cos(theta) + static_cast<double>(sim_param.length) / 2,
+        .y = r_init * std::sin(phi) * std::sin(theta) + static_cast<double>(sim_param.length) / 2,
+        .z = r_init * std::cos(phi) + static_cast<double>(sim_param.length) / 2 },
+      sim_param.length));
+    one_fish.setVelocity({ .x = fish_param.vel_standard, .y = 0, .z = 0 });
+  }
+  domain.rebalance(fish);
+
+  std::ofstream output_file{};
+  if (rank == 0) { output_file.open("output.txt"); }
+
+  KdTree tree{};
+  unsigned int last_rebalance = 0;
+  for (unsigned int time_step = 0; time_step < sim_param.max_steps; time_step++) {
+    if (rank == 0) { std::cout << "Time step: " << time_step << '\n'; }
+
+    // Move the slabs after the school, once it has drifted into a few of them. A school the slabs cannot balance
+    // below the threshold would otherwise be rebalanced, and migrated as a whole, every step.
+    if (time_step - last_rebalance >= sim_param.rebalance_interval
+        && domain.getImbalance(fish) > sim_param.load_imbalance) {
+      domain.rebalance(fish);
+      last_rebalance = time_step;
+    }
+
+    // Interact the fish of the rank with each other and with the copies of the nearby fish of the other ranks
+    const std::size_t n_owned = domain.appendHalo(fish);
+    tree.build(fish, sim_param.length);
+    calcDeltaVelocities(fish, n_owned, sim_param, fish_param, tree);
+    fish.resize(n_owned);
+
+#pragma omp parallel for default(none) shared(fish, sim_param, fish_param) schedule(static)
+    for (auto &one_fish : fish) { one_fish.update(sim_param, fish_param); }
+
+    // Hand over the fish that swam into the slabs of other ranks
+    domain.migrate(fish);
+
+    // The fish are written rank by rank, so their order changes in between the snapshots
+    if (time_step % sim_param.snapshot_interval == 0) {
+      domain.visitOnRoot(fish, [&output_file](std::span<const Fish> some_fish) {
+        writeSnapshot(output_file, some_fish);
+      });
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}// namespace
+
+int main(int argc, char *argv[])
+{
+  // Only the main thread of each rank communicates, in between the parallel regions
+  int provided = 0;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  int rank = 0;
+  int size = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (provided < MPI_THREAD_FUNNELED) {
+    if (rank == 0) { std::cerr << "The MPI library does not support calls from the main thread of OpenMP" << '\n'; }
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+
+  const int result = run(argc, argv, rank, size);
+
+  MPI_Finalize();
+  return result;
+}
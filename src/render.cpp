@@ -0,0 +1,342 @@
+#include "render.hpp"
+
+#include "coordinate.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <numbers>
+#include <numeric>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+constexpr Rgb box_colour{ .r = 160, .g = 160, .b = 160 };
+constexpr Rgb background_colour{ .r = 255, .g = 255, .b = 255 };
+constexpr Rgb text_colour{ .r = 0, .g = 0, .b = 0 };
+
+// Rows of the 3x5 glyphs from the top, the leftmost pixel being the highest of the three bits
+struct Glyph
+{
+  char character;
+  std::array<std::uint8_t, 5> rows;
+};
+
+constexpr std::array<Glyph, 15> font{ { { '0', { 7, 5, 5, 5, 7 } },
+  { '1', { 2, 6, 2, 2, 7 } },
+  { '2', { 7, 1, 7, 4, 7 } },
+  { '3', { 7, 1, 7, 1, 7 } },
+  { '4', { 5, 5, 7, 1, 1 } },
+  { '5', { 7, 4, 7, 1, 7 } },
+  { '6', { 7, 4, 7, 5, 7 } },
+  { '7', { 7, 1, 1, 1, 1 } },
+  { '8', { 7, 5, 7, 5, 7 } },
+  { '9', { 7, 5, 7, 1, 7 } },
+  { '.', { 0, 0, 0, 0, 2 } },
+  { '=', { 0, 7, 0, 7, 0 } },
+  { '-', { 0, 0, 7, 0, 0 } },
+  { 't', { 2, 7, 2, 2, 3 } },
+  { ' ', { 0, 0, 0, 0, 0 } } } };
+
+double logistic(double x) { return 1.0 / (1.0 + std::exp(-x)); }
+
+// CRC-32 of the PNG chunks, over the bytes from the type of the chunk to the end of its data
+class Crc32
+{
+private:
+  std::array<std::uint32_t, 256> m_table{};
+
+public:
+  Crc32()
+  {
+    for (std::uint32_t n = 0; n < m_table.size(); n++) {
+      std::uint32_t c = n;
+      for (int k = 0; k < 8; k++) { c = (c & 1U) != 0 ? 0xedb88320U ^ (c >> 1U) : c >> 1U; }
+      m_table[n] = c;
+    }
+  }
+
+  [[nodiscard]] std::uint32_t update(std::uint32_t crc, std::span<const std::uint8_t> bytes) const
+  {
+    for (const auto byte : bytes) { crc = m_table[(crc ^ byte) & 0xffU] ^ (crc >> 8U); }
+    return crc;
+  }
+};
+
+void appendBigEndian(std::vector<std::uint8_t> &bytes, std::uint32_t value)
+{
+  for (int shift = 24; shift >= 0; shift -= 8) { bytes.push_back(static_cast<std::uint8_t>(value >> shift)); }
+}
+
+void writeChunk(std::ostream &output, const char *type, const std::vector<std::uint8_t> &data)
+{
+  static const Crc32 crc32{};
+  std::vector<std::uint8_t> header{};
+  appendBigEndian(header, static_cast<std::uint32_t>(data.size()));
+  header.insert(header.end(), type, type + 4);
+
+  // The data is written and checked where it is, as the image data of a large frame is large
+  const std::uint32_t crc = crc32.update(crc32.update(0xffffffffU, std::span(header).subspan(4)), data);
+  std::vector<std::uint8_t> trailer{};
+  appendBigEndian(trailer, ~crc);
+  output.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+  output.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+  output.write(reinterpret_cast<const char *>(trailer.data()), static_cast<std::streamsize>(trailer.size()));
+}
+
+}// namespace
+
+Rgb hsvToRgb(double hue, double saturation, double value)
+{
+  const auto toByte = [](double component) {
+    return static_cast<std::uint8_t>(std::clamp(component, 0.0, 1.0) * 255.0 + 0.5);
+  };
+  if (saturation <= 0) { return { .r = toByte(value), .g = toByte(value), .b = toByte(value) }; }
+
+  const double sector = (hue - std::floor(hue)) * 6.0;
+  const auto index = static_cast<int>(sector);
+  const double fraction = sector - index;
+  const double p = value * (1 - saturation);
+  const double q = value * (1 - saturation * fraction);
+  const double t = value * (1 - saturation * (1 - fraction));
+  switch (index) {
+  case 0:
+    return { .r = toByte(value), .g = toByte(t), .b = toByte(p) };
+  case 1:
+    return { .r = toByte(q), .g = toByte(value), .b = toByte(p) };
+  case 2:
+    return { .r = toByte(p), .g = toByte(value), .b = toByte(t) };
+  case 3:
+    return { .r = toByte(p), .g = toByte(q), .b = toByte(value) };
+  case 4:
+    return { .r = toByte(t), .g = toByte(p), .b = toByte(value) };
+  default:
+    return { .r = toByte(value), .g = toByte(p), .b = toByte(q) };
+  }
+}
+
+Rgb fishColour(const Vect3 &velocity, double vel_standard)
+{
+  const double hue = std::atan2(velocity.y, velocity.x) / (2.0 * std::numbers::pi) + 0.5;
+  const double saturation = logistic(absolute(velocity) / (vel_standard * vel_standard));
+  const double value = logistic(velocity.z / vel_standard);
+  return hsvToRgb(hue, saturation, value);
+}
+
+Projection::Projection(unsigned int length, unsigned int width, unsigned int height, double rot_x, double rot_z)
+  : m_length(length), m_scale(0.55 * std::min(width, height) / length), m_centre_x(0.5 * width),
+    m_centre_y(0.5 * height), m_cos_x(std::cos(rot_x * std::numbers::pi / 180)),
+    m_sin_x(std::sin(rot_x * std::numbers::pi / 180)), m_cos_z(std::cos(rot_z * std::numbers::pi / 180)),
+    m_sin_z(std::sin(rot_z * std::numbers::pi / 180))
+{}
+
+Vect3 Projection::project(const Vect3 &position) const
+{
+  // Rotate the box about its centre around z and then around the x axis of the screen, which looks down z
+  const double x = position.x - 0.5 * m_length;
+  const double y = position.y - 0.5 * m_length;
+  const double z = position.z - 0.5 * m_length;
+  const double rotated_x = x * m_cos_z + y * m_sin_z;
+  const double rotated_y = -x * m_sin_z + y * m_cos_z;
+  const double screen_y = rotated_y * m_cos_x + z * m_sin_x;
+  const double depth = -rotated_y * m_sin_x + z * m_cos_x;
+  return { .x = m_centre_x + m_scale * rotated_x, .y = m_centre_y - m_scale * screen_y, .z = depth };
+}
+
+Frame::Frame(unsigned int width, unsigned int height)
+  : m_width(width), m_height(height), m_pixels(std::size_t{ 3 } * width * height, 0)
+{}
+
+Rgb Frame::getPixel(unsigned int x, unsigned int y) const
+{
+  const std::size_t pixel = 3 * (std::size_t{ y } * m_width + x);
+  return { .r = m_pixels[pixel], .g = m_pixels[pixel + 1], .b = m_pixels[pixel + 2] };
+}
+
+void Frame::fill(Rgb colour)
+{
+  for (std::size_t y = 0; y < m_height; y++) {
+    for (std::size_t x = 0; x < m_width; x++) { setPixel(x, y, colour); }
+  }
+}
+
+void Frame::fillCircle(double x, double y, double radius, Rgb colour)
+{
+  const auto first_row = static_cast<int>(std::max(0.0, std::ceil(y - radius)));
+  const auto last_row = static_cast<int>(std::min(m_height - 1.0, std::floor(y + radius)));
+  for (int row = first_row; row <= last_row; row++) {
+    const double half_width = std::sqrt(std::max(0.0, radius * radius - (row - y) * (row - y)));
+    const auto first_column = static_cast<int>(std::max(0.0, std::ceil(x - half_width)));
+    const auto last_column = static_cast<int>(std::min(m_width - 1.0, std::floor(x + half_width)));
+    for (int column = first_column; column <= last_column; column++) {
+      setPixel(static_cast<std::size_t>(column), static_cast<std::size_t>(row), colour);
+    }
+  }
+}
+
+void Frame::drawLine(double x1, double y1, double x2, double y2, Rgb colour)
+{
+  // One pixel per step along the longer axis
+  const auto steps = static_cast<int>(std::ceil(std::max(std::abs(x2 - x1), std::abs(y2 - y1))));
+  for (int step = 0; step <= steps; step++) {
+    const double fraction = steps == 0 ? 0.0 : static_cast<double>(step) / steps;
+    const double x = std::round(x1 + fraction * (x2 - x1));
+    const double y = std::round(y1 + fraction * (y2 - y1));
+    if (x >= 0 && y >= 0 && x < m_width && y < m_height) {
+      setPixel(static_cast<std::size_t>(x), static_cast<std::size_t>(y), colour);
+    }
+  }
+}
+
+void Frame::drawText(unsigned int x, unsigned int y, std::string_view text, unsigned int scale, Rgb colour)
+{
+  for (const char character : text) {
+    const auto *glyph = std::find_if(
+      font.begin(), font.end(), [character](const Glyph &candidate) { return candidate.character == character; });
+    if (glyph != font.end()) {
+      for (unsigned int row = 0; row < glyph->rows.size(); row++) {
+        for (unsigned int column = 0; column < 3; column++) {
+          if (((glyph->rows[row] >> (2 - column)) & 1U) == 0) { continue; }
+          for (unsigned int dy = 0; dy < scale; dy++) {
+            for (unsigned int dx = 0; dx < scale; dx++) {
+              const unsigned int pixel_x = x + column * scale + dx;
+              const unsigned int pixel_y = y + row * scale + dy;
+              if (pixel_x < m_width && pixel_y < m_height) { setPixel(pixel_x, pixel_y, colour); }
+            }
+          }
+        }
+      }
+    }
+    x += 4 * scale;
+  }
+}
+
+bool readSnapshotText(std::istream &input, unsigned int n_fish, std::string &text)
+{
+  text.clear();
+  std::string line{};
+  for (unsigned int i = 0; i < n_fish; i++) {
+    if (!std::getline(input, line)) { return false; }
+    text += line;
+    text += '\n';
+  }
+  return true;
+}
+
+bool parseSnapshot(std::string_view text, Snapshot &snapshot)
+{
+  snapshot.positions.clear();
+  snapshot.velocities.clear();
+  const char *first = text.data();
+  const char *last = text.data() + text.size();
+  while (first < last) {
+    std::array<double, 6> values{};
+    for (auto &value : values) {
+      while (first < last && (*first == ' ' || *first == '\t')) { first++; }
+      const auto [end, error] = std::from_chars(first, last, value);
+      if (error != std::errc{}) { return false; }
+      first = end;
+    }
+    while (first < last && *first != '\n') { first++; }
+    first++;
+    snapshot.positions.push_back({ .x = values[0], .y = values[1], .z = values[2] });
+    snapshot.velocities.push_back({ .x = values[3], .y = values[4], .z = values[5] });
+  }
+  return true;
+}
+
+void renderSnapshot(Frame &frame, const Projection &projection, const Snapshot &snapshot, const RenderParam &param)
+{
+  frame.fill(background_colour);
+
+  // The edges of the box between the corners differing along one axis
+  const auto length = static_cast<double>(param.length);
+  std::array<Vect3, 8> corners{};
+  for (unsigned int corner = 0; corner < corners.size(); corner++) {
+    corners[corner] = projection.project({ .x = (corner & 4U) != 0 ? length : 0.0,
+      .y = (corner & 2U) != 0 ? length : 0.0,
+      .z = (corner & 1U) != 0 ? length : 0.0 });
+  }
+  for (unsigned int corner = 0; corner < corners.size(); corner++) {
+    for (const unsigned int axis : { 1U, 2U, 4U }) {
+      if ((corner & axis) != 0) { continue; }
+      const Vect3 &start = corners[corner];
+      const Vect3 &end = corners[corner | axis];
+      frame.drawLine(start.x, start.y, end.x, end.y, box_colour);
+    }
+  }
+
+  // The nearer fish are drawn over the farther ones
+  std::vector<Vect3> projected(snapshot.positions.size());
+  for (std::size_t i = 0; i < projected.size(); i++) { projected[i] = projection.project(snapshot.positions[i]); }
+  std::vector<std::size_t> order(projected.size());
+  std::iota(order.begin(), order.end(), std::size_t{ 0 });
+  std::sort(order.begin(), order.end(), [&projected](std::size_t a, std::size_t b) {
+    return projected[a].z < projected[b].z;
+  });
+  for (const auto i : order) {
+    frame.fillCircle(
+      projected[i].x, projected[i].y, param.point_radius, fishColour(snapshot.velocities[i], param.vel_standard));
+  }
+
+  if (!param.title.empty()) { frame.drawText(10, 10, param.title, 3, text_colour); }
+}
+
+void writePng(std::ostream &output, const Frame &frame)
+{
+  constexpr std::array<std::uint8_t, 8> signature{ 137, 80, 78, 71, 13, 10, 26, 10 };
+  output.write(reinterpret_cast<const char *>(signature.data()), signature.size());
+
+  // 8-bit RGB, not interlaced
+  std::vector<std::uint8_t> header{};
+  appendBigEndian(header, frame.getWidth());
+  appendBigEndian(header, frame.getHeight());
+  header.insert(header.end(), { 8, 2, 0, 0, 0 });
+  writeChunk(output, "IHDR", header);
+
+  // Each row after a filter byte of 0, in a zlib stream of stored deflate blocks
+  const std::size_t row_size = 3 * std::size_t{ frame.getWidth() };
+  std::vector<std::uint8_t> raw{};
+  raw.reserve((row_size + 1) * frame.getHeight());
+  for (unsigned int row = 0; row < frame.getHeight(); row++) {
+    raw.push_back(0);
+    const auto begin = frame.getPixels().begin() + static_cast<std::ptrdiff_t>(row * row_size);
+    raw.insert(raw.end(), begin, begin + static_cast<std::ptrdiff_t>(row_size));
+  }
+
+  constexpr std::size_t max_block_size = 65535;
+  std::vector<std::uint8_t> data{ 0x78, 0x01 };
+  data.reserve(raw.size() + raw.size() / max_block_size * 5 + 16);
+  std::size_t offset = 0;
+  do {
+    const std::size_t block_size = std::min(max_block_size, raw.size() - offset);
+    const bool last = offset + block_size == raw.size();
+    data.push_back(last ? 1 : 0);
+    data.push_back(static_cast<std::uint8_t>(block_size & 0xffU));
+    data.push_back(static_cast<std::uint8_t>(block_size >> 8U));
+    data.push_back(static_cast<std::uint8_t>(~block_size & 0xffU));
+    data.push_back(static_cast<std::uint8_t>((~block_size >> 8U) & 0xffU));
+    data.insert(data.end(),
+      raw.begin() + static_cast<std::ptrdiff_t>(offset),
+      raw.begin() + static_cast<std::ptrdiff_t>(offset + block_size));
+    offset += block_size;
+  } while (offset < raw.size());
+
+  std::uint32_t sum_a = 1;
+  std::uint32_t sum_b = 0;
+  for (const auto byte : raw) {
+    sum_a = (sum_a + byte) % 65521U;
+    sum_b = (sum_b + sum_a) % 65521U;
+  }
+  appendBigEndian(data, (sum_b << 16U) | sum_a);
+  writeChunk(output, "IDAT", data);
+  writeChunk(output, "IEND", {});
+}
@@ -0,0 +1,161 @@
+#include "io.hpp"
+#include "render.hpp"
+#include "simulation.hpp"
+#include <argparse/argparse.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <yaml-cpp/node/node.h>
+#include <yaml-cpp/node/parse.h>
+
+int main(int argc, char *argv[])
+{
+  argparse::ArgumentParser program("fish_render");
+  program.add_argument("-c", "--config").help("The path to the configuration file of the run").required();
+  program.add_argument("-i", "--input")
+    .help("The path to the snapshots of the run")
+    .default_value(std::string("output.txt"));
+  program.add_argument("-o", "--output")
+    .help("The video encoded by ffmpeg, or a directory of PNG frames if it ends with /")
+    .default_value(std::string("video.mp4"));
+  program.add_argument("--width").help("Width of the frames in pixels").default_value(800U).scan<'u', unsigned int>();
+  program.add_argument("--height").help("Height of the frames in pixels").default_value(600U).scan<'u', unsigned int>();
+  program.add_argument("--framerate").help("Frames per video second").default_value(24U).scan<'u', unsigned int>();
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error &err) {
+    std::cerr << err.what() << '\n';
+    std::cerr << program;
+    return 1;
+  }
+
+  const YAML::Node config = YAML::LoadFile(program.get<std::string>("--config"));
+  FishParam fish_param{};
+  SimParam sim_param{};
+  if ((config >> fish_param) == EXIT_FAILURE || (config >> sim_param) == EXIT_FAILURE) {
+    std::cerr << "Error reading the parameters" << '\n';
+    return 1;
+  }
+  if (sim_param.output_mode != OutputMode::Fish) {
+    std::cerr << "Only the snapshots of every fish can be rendered" << '\n';
+    return 1;
+  }
+
+  std::ifstream input(program.get<std::string>("--input"));
+  if (!input) {
+    std::cerr << "Could not open " << program.get<std::string>("--input") << '\n';
+    return 1;
+  }
+
+  // The frames go to ffmpeg through a pipe, or to a directory
+  const auto output = program.get<std::string>("--output");
+  const auto width = program.get<unsigned int>("--width");
+  const auto height = program.get<unsigned int>("--height");
+  const bool png = output.ends_with('/');
+  if (!png && (width % 2 != 0 || height % 2 != 0)) {
+    std::cerr << "The width and height of a video must be even, as ffmpeg encodes it as yuv420p" << '\n';
+    return 1;
+  }
+  FILE *ffmpeg = nullptr;
+  if (png) {
+    std::filesystem::create_directories(output);
+  } else {
+    std::ostringstream command{};
+    command << "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgb24 -s " << width << "x" << height
+            << " -framerate " << program.get<unsigned int>("--framerate") << " -i - -c:v libx264 -pix_fmt yuv420p "
+            << std::quoted(output);
+    ffmpeg = popen(command.str().c_str(), "w");
+    if (ffmpeg == nullptr) {
+      std::cerr << "Could not start ffmpeg" << '\n';
+      return 1;
+    }
+  }
+
+  // The file is read once, a batch of snapshots at a time, and the snapshots of a batch are parsed, drawn and encoded
+  // by the threads in parallel before the frames are written in order
+  const auto batch_size = static_cast<unsigned int>(omp_get_max_threads());
+  std::vector<std::string> texts(batch_size);
+  std::vector<Snapshot> snapshots(batch_size);
+  std::vector<Frame> frames(batch_size, Frame(width, height));
+  std::vector<std::string> encoded(batch_size);// The PNG files of the frames
+  const Projection projection(sim_param.length, width, height, 60.0, 30.0);
+  const double snapshot_time = sim_param.delta_t * sim_param.snapshot_interval;
+  unsigned int n_frames = 0;
+  bool incomplete = false;// The file ends in the middle of a snapshot
+  bool malformed = false;
+  bool failed = false;
+  while (!malformed && !failed) {
+    unsigned int n_read = 0;
+    while (n_read < batch_size) {
+      if (!readSnapshotText(input, sim_param.n_fish, texts[n_read])) {
+        incomplete = !texts[n_read].empty();
+        break;
+      }
+      n_read++;
+    }
+    if (n_read == 0) { break; }
+
+#pragma omp parallel for default(none) shared(texts, snapshots, frames, encoded, png, projection, sim_param, \
+    fish_param, snapshot_time, n_frames, n_read, malformed) schedule(dynamic, 1)
+    for (unsigned int k = 0; k < n_read; k++) {
+      if (!parseSnapshot(texts[k], snapshots[k])) {
+#pragma omp atomic write
+        malformed = true;
+        continue;
+      }
+      std::ostringstream title{};
+      title << "t = " << std::fixed << std::setprecision(2) << (n_frames + k) * snapshot_time;
+      renderSnapshot(frames[k],
+        projection,
+        snapshots[k],
+        { .length = sim_param.length, .vel_standard = fish_param.vel_standard, .title = title.str() });
+      if (png) {
+        std::ostringstream file{};
+        writePng(file, frames[k]);
+        encoded[k] = std::move(file).str();
+      }
+    }
+    if (malformed) {
+      std::cerr << "Malformed snapshot in frames " << n_frames << " to " << n_frames + n_read - 1 << '\n';
+      break;
+    }
+
+    for (unsigned int k = 0; k < n_read; k++) {
+      const auto &pixels = frames[k].getPixels();
+      if (png) {
+        std::ostringstream name{};
+        name << output << "frame_" << std::setw(5) << std::setfill('0') << n_frames + k << ".png";
+        std::ofstream file(name.str(), std::ios::binary);
+        file.write(encoded[k].data(), static_cast<std::streamsize>(encoded[k].size()));
+        file.close();
+        if (!file) {
+          std::cerr << "Could not write " << name.str() << '\n';
+          failed = true;
+          break;
+        }
+      } else if (std::fwrite(pixels.data(), 1, pixels.size(), ffmpeg) != pixels.size()) {
+        std::cerr << "Could not write to ffmpeg" << '\n';
+        failed = true;
+        break;
+      }
+    }
+    n_frames += n_read;
+    std::cout << "Rendered " << n_frames << " frames" << '\n';
+  }
+
+  if (incomplete) { std::cerr << "Ignored the incomplete last snapshot" << '\n'; }
+  if (ffmpeg != nullptr && pclose(ffmpeg) != 0) {
+    std::cerr << "ffmpeg failed" << '\n';
+    return 1;
+  }
+  return malformed || failed ? 1 : EXIT_SUCCESS;
+}
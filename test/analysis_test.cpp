@@ -0,0 +1,286 @@
+#include "analysis.hpp"
+
+#include "coordinate.hpp"
+#include "driver.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+TEST(AnalysisTest, RotatingRing)
+{
+  // A ring of fish swimming around its centre, which lies across the corner of the box
+  const unsigned int length = 20;
+  const unsigned int n_fish = 36;
+  const double radius = 3.0;
+  const double speed = 1.5;
+  School fish(n_fish, Fish{});
+  for (unsigned int i = 0; i < n_fish; i++) {
+    const double angle = 2 * std::numbers::pi * i / n_fish;
+    fish[i].setPosition(periodic(
+      Vect3{ .x = radius * std::cos(angle), .y = radius * std::sin(angle), .z = 0.5 }, length));
+    fish[i].setVelocity(-speed * std::sin(angle), speed * std::cos(angle), 0.0);
+  }
+
+  const Observables observables = computeObservables(fish, length);
+  EXPECT_NEAR(observables.polarization, 0.0, 1e-12);
+  const Vect3 centre{ .x = 0.0, .y = 0.0, .z = 0.5 };
+  EXPECT_NEAR(absolute(vect12(observables.centre_of_mass, centre, length)), 0.0, 1e-12);
+  EXPECT_NEAR(observables.angular_momentum.x, 0.0, 1e-12);
+  EXPECT_NEAR(observables.angular_momentum.y, 0.0, 1e-12);
+  EXPECT_NEAR(observables.angular_momentum.z, radius * speed, 1e-12);
+  EXPECT_NEAR(observables.extent, radius, 1e-12);
+  EXPECT_NEAR(observables.nearest_distance, 2 * radius * std::sin(std::numbers::pi / n_fish), 1e-12);
+}
+
+TEST(AnalysisTest, AlignedSchool)
+{
+  const unsigned int length = 16;
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<double> dis_pos(0.0, length);
+  School fish(300, Fish{});
+  for (auto &one_fish : fish) {
+    one_fish.setPosition(dis_pos(gen), dis_pos(gen), dis_pos(gen));
+    one_fish.setVelocity(0.0, 2.0, 0.0);
+  }
+
+  const Observables observables = computeObservables(fish, length);
+  EXPECT_NEAR(observables.polarization, 1.0, 1e-12);
+
+  // As the nearest neighbours found by checking every pair
+  double nearest_distance = 0.0;
+  for (const auto &one_fish : fish) {
+    double nearest = std::numeric_limits<double>::infinity();
+    for (const auto &other_fish : fish) {
+      if (&other_fish == &one_fish) { continue; }
+      nearest = std::min(nearest, absolute(vect12(one_fish.getPosition(), other_fish.getPosition(), length)));
+    }
+    nearest_distance += nearest;
+  }
+  EXPECT_NEAR(observables.nearest_distance, nearest_distance / static_cast<double>(fish.size()), 1e-12);
+}
+
+TEST(AnalysisTest, ClustersAcrossBoundary)
+{
+  // A chain across the boundary along x, a pair, and a fish on its own
+  const unsigned int length = 10;
+  School fish(6, Fish{});
+  fish[0].setPosition(5.0, 5.0, 5.0);
+  fish[1].setPosition(9.6, 1.0, 1.0);
+  fish[2].setPosition(5.5, 5.5, 5.0);
+  fish[3].setPosition(0.3, 1.0, 1.0);
+  fish[4].setPosition(1.2, 1.0, 9.9);
+  fish[5].setPosition(1.2, 1.0, 1.0);
+
+  const Clusters clusters = findClusters(fish, length, 1.0);
+  EXPECT_EQ(clusters.labels, (std::vector<unsigned int>{ 0, 1, 0, 1, 2, 1 }));
+  EXPECT_EQ(clusters.sizes, (std::vector<unsigned int>{ 2, 3, 1 }));
+
+  std::ostringstream output{};
+  writeClusters(output, 7, 0.35, clusters);
+  EXPECT_EQ(output.str(), "7 0.35 3 1:1 2:1 3:1\n");
+  output.str("");
+  writeClusterLabels(output, clusters);
+  EXPECT_EQ(output.str(), "0 1 0 1 2 1\n");
+}
+
+TEST(AnalysisTest, ClustersMatchAllPairs)
+{
+  // From grids of many cells down to one, where the neighbouring cells are periodic images of one another
+  for (const auto &[length, radius] : { std::pair{ 16U, 0.9 }, std::pair{ 16U, 1.6 }, std::pair{ 4U, 1.5 },
+         std::pair{ 3U, 2.5 } }) {
+    std::mt19937 gen(length);
+    std::uniform_real_distribution<double> dis_pos(0.0, length);
+    School fish(length * length * 40 / 16, Fish{});
+    for (auto &one_fish : fish) { one_fish.setPosition(dis_pos(gen), dis_pos(gen), dis_pos(gen)); }
+
+    // Flood fill from the first fish of every cluster
+    const auto n_fish = static_cast<unsigned int>(fish.size());
+    std::vector<unsigned int> labels(n_fish, n_fish);
+    unsigned int n_clusters = 0;
+    for (unsigned int first = 0; first < n_fish; first++) {
+      if (labels[first] != n_fish) { continue; }
+      std::vector<unsigned int> queue{ first };
+      labels[first] = n_clusters;
+      while (!queue.empty()) {
+        const unsigned int i = queue.back();
+        queue.pop_back();
+        for (unsigned int j = 0; j < n_fish; j++) {
+          const double distance = absolute(vect12(fish[i].getPosition(), fish[j].getPosition(), length));
+          if (labels[j] == n_fish && distance <= radius) {
+            labels[j] = n_clusters;
+            queue.push_back(j);
+          }
+        }
+      }
+      n_clusters++;
+    }
+
+    const Clusters clusters = findClusters(fish, length, radius);
+    EXPECT_EQ(clusters.labels, labels) << "Length " << length << ", radius " << radius;
+    EXPECT_EQ(clusters.sizes.size(), n_clusters);
+  }
+}
+
+TEST(AnalysisTest, VoxelField)
+{
+  const unsigned int length = 8;
+  School fish(4, Fish{});
+  fish[0].setPosition(0.5, 0.5, 0.5);
+  fish[0].setVelocity(1.0, 0.0, 0.0);
+  fish[1].setPosition(1.5, 1.0, 0.2);
+  fish[1].setVelocity(0.0, 2.0, 0.0);
+  fish[2].setPosition(7.9, 4.5, 2.5);
+  fish[2].setVelocity(1.0, 1.0, 1.0);
+  fish[3].setPosition(6.5, 5.5, 3.9);
+  fish[3].setVelocity(3.0, -1.0, 1.0);
+
+  // Voxels 2 units wide, the first holding two fish and the last occupied one two others
+  const VoxelField field = computeVoxelField(fish, length, 4);
+  ASSERT_EQ(field.counts.size(), 64);
+  EXPECT_EQ(field.counts[0], 2);
+  EXPECT_EQ(field.counts[(3 * 4 + 2) * 4 + 1], 2);
+  EXPECT_EQ(std::count(field.counts.begin(), field.counts.end(), 0U), 62);
+  EXPECT_DOUBLE_EQ(field.mean_velocities[0].x, 0.5);
+  EXPECT_DOUBLE_EQ(field.mean_velocities[0].y, 1.0);
+  EXPECT_DOUBLE_EQ(field.mean_velocities[(3 * 4 + 2) * 4 + 1].x, 2.0);
+
+  std::ostringstream output{};
+  writeVoxelField(output, 3, 0.15, field);
+  EXPECT_EQ(output.str(), "# 3 0.15 2\n0 0 0 2 0.5 1 0\n3 2 1 2 2 0 1\n");
+}
+
+TEST(AnalysisTest, RadialDistribution)
+{
+  // A single pair, in the bin of its distance across the boundary
+  const unsigned int length = 10;
+  School pair(2, Fish{});
+  pair[0].setPosition(0.2, 5.0, 5.0);
+  pair[1].setPosition(9.15, 5.0, 5.0);
+  RadialDistribution single(2.0, 20);
+  single.accumulate(pair, length);
+  const std::vector<double> distribution = single.compute();
+  const double shell = 4.0 / 3.0 * std::numbers::pi * (1.1 * 1.1 * 1.1 - 1.0);
+  for (unsigned int bin = 0; bin < 20; bin++) {
+    EXPECT_NEAR(distribution[bin], bin == 10 ? 1000.0 / shell : 0.0, 1e-9) << "Bin " << bin;
+  }
+
+  // Tends to 1 in a uniform school, and in as many steps of it
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> dis_pos(0.0, length);
+  School fish(4000, Fish{});
+  RadialDistribution uniform(3.0, 6);
+  for (unsigned int step = 0; step < 2; step++) {
+    for (auto &one_fish : fish) { one_fish.setPosition(dis_pos(gen), dis_pos(gen), dis_pos(gen)); }
+    uniform.accumulate(fish, length);
+  }
+  for (const auto value : uniform.compute()) { EXPECT_NEAR(value, 1.0, 0.05); }
+
+  std::ostringstream output{};
+  single.write(output);
+  std::istringstream rows(output.str());
+  std::string row{};
+  std::getline(rows, row);
+  EXPECT_EQ(row, "# r g(r)");
+  double radius = 0.0;
+  rows >> radius;
+  EXPECT_DOUBLE_EQ(radius, 0.05);
+}
+
+TEST(AnalysisTest, SimulateWritesTimeSeries)
+{
+  SimParam sim_param{ .length = 16,
+    .n_fish = 100,
+    .max_steps = 30,
+    .delta_t = 0.05,
+    .snapshot_interval = 10,
+    .neighbour_search = NeighbourSearch::AllPairs,
+    .observables_interval = 4,
+    .cluster_radius = 1.5 };
+  const FishParam fish_param{ .vel_standard = 1.5,
+    .vel_repulsion = 1.5,
+    .vel_escape = 7.5,
+    .body_length = 1.0,
+    .repulsion_radius = 1.0,
+    .attraction_radius = 3.0,
+    .n_cog = 3,
+    .attraction_str = 15.0,
+    .attraction_duration = 0.1 };
+
+  // Headers and the steps 1, 5, ..., 29 in every precision
+  for (const auto precision : { Precision::Double, Precision::Fixed }) {
+    sim_param.precision = precision;
+    std::mt19937 gen(3);
+    School fish = makeSphere(sim_param, fish_param, gen);
+    std::ostringstream output{};
+    std::ostringstream observables{};
+    std::ostringstream clusters{};
+    const AnalysisOutput analysis{ .observables = &observables, .clusters = &clusters };
+    simulate(fish, sim_param, fish_param, makeStencils(sim_param, fish_param), output, false, analysis);
+
+    std::istringstream rows(observables.str());
+    std::string row{};
+    std::getline(rows, row);
+    EXPECT_EQ(row.front(), '#');
+    unsigned int n_rows = 0;
+    while (std::getline(rows, row)) {
+      std::istringstream values(row);
+      unsigned int step = 0;
+      double time = 0.0;
+      double polarization = 0.0;
+      values >> step >> time >> polarization;
+      EXPECT_EQ(step, 4 * n_rows + 1);
+      EXPECT_DOUBLE_EQ(time, step * sim_param.delta_t);
+      EXPECT_GE(polarization, 0.0);
+      EXPECT_LE(polarization, 1.0 + 1e-12);
+      n_rows++;
+    }
+    EXPECT_EQ(n_rows, 8);
+
+    // Every fish is in one of the clusters
+    rows.clear();
+    rows.str(clusters.str());
+    std::getline(rows, row);
+    for (unsigned int i = 0; i < n_rows; i++) {
+      ASSERT_TRUE(std::getline(rows, row));
+      std::istringstream values(row.substr(row.find(' ', row.find(' ') + 1) + 1));
+      unsigned int n_clusters = 0;
+      values >> n_clusters;
+      unsigned int n_fish = 0;
+      std::string pair{};
+      while (values >> pair) {
+        const auto colon = pair.find(':');
+        n_fish += static_cast<unsigned int>(std::stoul(pair.substr(0, colon)) * std::stoul(pair.substr(colon + 1)));
+      }
+      EXPECT_GE(n_clusters, 1);
+      EXPECT_EQ(n_fish, sim_param.n_fish);
+    }
+    EXPECT_FALSE(std::getline(rows, row));
+  }
+
+  // Nothing unless an interval is given
+  sim_param.observables_interval = 0;
+  std::mt19937 gen(3);
+  School fish = makeSphere(sim_param, fish_param, gen);
+  std::ostringstream output{};
+  std::ostringstream observables{};
+  simulate(fish, sim_param, fish_param, makeStencils(sim_param, fish_param), output, false, { &observables });
+  EXPECT_TRUE(observables.str().empty());
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,117 @@
+#include "batch.hpp"
+
+#include "coordinate.hpp"
+#include "cpu.hpp"
+#include "eom.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class BatchTest : public ::testing::Test
+{
+protected:
+  const SimParam sim_param{ .length = 8,
+    .n_fish = 80,
+    .max_steps = 25,
+    .delta_t = 0.05,
+    .snapshot_interval = 10,
+    .neighbour_search = NeighbourSearch::AllPairs };
+
+  std::vector<FishParam> fish_params{};
+  std::vector<School> schools{};
+
+  void SetUp() override
+  {
+    // Lanes with other radii, numbers of neighbours and speeds, fewer than a full batch
+    for (unsigned int r = 0; r < 5; r++) {
+      fish_params.push_back({ .vel_standard = 1.0 + 0.25 * r,
+        .vel_repulsion = 1.0,
+        .vel_escape = 7.5 - r,
+        .body_length = 0.5 + 0.25 * r,
+        .repulsion_radius = 0.75 + 0.25 * r,
+        .attraction_radius = 2.0 + 0.5 * r,
+        .n_cog = 1 + r,
+        .attraction_str = 10.0 + r,
+        .attraction_duration = 0.1 + 0.1 * r });
+
+      std::mt19937 gen(17 + r);
+      std::uniform_real_distribution<double> dis_pos(0.0, 8.0);
+      std::uniform_real_distribution<double> dis_vel(-1.0, 1.0);
+      School fish(sim_param.n_fish, Fish{});
+      for (std::size_t i = 0; i < fish.size(); i++) {
+        fish[i].setPosition({ .x = dis_pos(gen), .y = dis_pos(gen), .z = dis_pos(gen) });
+        fish[i].setVelocity({ .x = dis_vel(gen), .y = dis_vel(gen), .z = dis_vel(gen) });
+        fish[i].setLambda(i % 2 == 0 ? 1.0 : 0.0);
+      }
+      schools.push_back(fish);
+    }
+  }
+};
+
+TEST_F(BatchTest, SchoolRoundTrip)
+{
+  ReplicaBatch batch(sim_param, fish_params);
+  EXPECT_EQ(batch.getReplicaCount(), 5);
+  for (std::size_t r = 0; r < schools.size(); r++) { batch.setSchool(r, schools[r]); }
+
+  for (std::size_t r = 0; r < schools.size(); r++) {
+    const School fish = batch.getSchool(r);
+    ASSERT_EQ(fish.size(), schools[r].size());
+    for (std::size_t i = 0; i < fish.size(); i++) {
+      EXPECT_EQ(fish[i].getPosition().x, schools[r][i].getPosition().x);
+      EXPECT_EQ(fish[i].getVelocity().z, schools[r][i].getVelocity().z);
+      EXPECT_EQ(fish[i].getLambda(), schools[r][i].getLambda());
+    }
+  }
+}
+
+TEST_F(BatchTest, LanesMatchAllPairs)
+{
+  // Every lane follows its replica run on its own to the last bit, at every level the processor supports
+  std::vector<School> expected = schools;
+  for (unsigned int step = 0; step < sim_param.max_steps; step++) {
+    for (std::size_t r = 0; r < expected.size(); r++) {
+      calcDeltaVelocitiesAllPairs(expected[r], sim_param, fish_params[r]);
+      for (auto &one_fish : expected[r]) { one_fish.update(sim_param, fish_params[r]); }
+    }
+  }
+
+  for (const auto level : { SimdLevel::Generic, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+    if (level > getSupportedSimdLevel()) { break; }
+    EXPECT_EQ(setSimdLevel(level), EXIT_SUCCESS);
+
+    ReplicaBatch batch(sim_param, fish_params);
+    for (std::size_t r = 0; r < schools.size(); r++) { batch.setSchool(r, schools[r]); }
+    for (unsigned int step = 0; step < sim_param.max_steps; step++) {
+      batch.calcDeltaVelocities();
+      batch.update();
+    }
+
+    for (std::size_t r = 0; r < schools.size(); r++) {
+      const School fish = batch.getSchool(r);
+      for (std::size_t i = 0; i < fish.size(); i++) {
+        EXPECT_EQ(fish[i].getPosition().x, expected[r][i].getPosition().x) << "Replica " << r << " fish " << i;
+        EXPECT_EQ(fish[i].getPosition().y, expected[r][i].getPosition().y);
+        EXPECT_EQ(fish[i].getPosition().z, expected[r][i].getPosition().z);
+        EXPECT_EQ(fish[i].getVelocity().x, expected[r][i].getVelocity().x);
+        EXPECT_EQ(fish[i].getVelocity().y, expected[r][i].getVelocity().y);
+        EXPECT_EQ(fish[i].getVelocity().z, expected[r][i].getVelocity().z);
+        EXPECT_EQ(fish[i].getLambda(), expected[r][i].getLambda());
+      }
+    }
+  }
+  EXPECT_EQ(setSimdLevel(getSupportedSimdLevel()), EXIT_SUCCESS);
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
@@ -287,3 +287,95 @@ TEST(BoundaryBetweenTest, RadiusFlipped)
 
   EXPECT_THAT(result1, UnorderedElementsAreArray(result2));
 }
+
+TEST(StencilReachTest, Reach)
+{
+  EXPECT_EQ(getStencilReach({}), 0);
+  EXPECT_EQ(getStencilReach(getBoundaryCells(0.5)), 1);
+
+  const std::vector<std::array<int, 3>> cells = { { 0, 0, 0 }, { 1, -3, 0 }, { 2, 0, 1 } };
+  EXPECT_EQ(getStencilReach(cells), 3);
+}
+
+TEST(WrapTableTest, WrapsIntoBox)
+{
+  const unsigned int length = 4;
+  const unsigned int reach = 2;
+  auto result = getWrapTable(length, reach);
+  // Cell coordinates -2 to 5
+  const std::vector<unsigned int> expected = { 2, 3, 0, 1, 2, 3, 0, 1 };
+  EXPECT_EQ(result, expected);
+}
+
+TEST(WrapTableTest, ReachLongerThanBox)
+{
+  const unsigned int length = 2;
+  const unsigned int reach = 3;
+  auto result = getWrapTable(length, reach);
+  // Cell coordinates -3 to 4
+  const std::vector<unsigned int> expected = { 1, 0, 1, 0, 1, 0, 1, 0 };
+  EXPECT_EQ(result, expected);
+}
+
+TEST(StencilRunTest, MergesConsecutiveCells)
+{
+  const std::vector<std::array<int, 3>> cells = {
+    { 0, 0, 1 }, { 0, 0, -1 }, { 0, 0, 0 }, { 0, 0, 3 }, { 1, 0, 0 }, { 0, 0, 0 }
+  };
+  auto result = getStencilRuns(cells);
+  ASSERT_EQ(result.size(), 3);
+  EXPECT_EQ(result[0].dx, 0);
+  EXPECT_EQ(result[0].dy, 0);
+  EXPECT_EQ(result[0].z_begin, -1);
+  EXPECT_EQ(result[0].z_end, 1);
+  EXPECT_EQ(result[1].z_begin, 3);
+  EXPECT_EQ(result[1].z_end, 3);
+  EXPECT_EQ(result[2].dx, 1);
+  EXPECT_EQ(result[2].z_begin, 0);
+  EXPECT_EQ(result[2].z_end, 0);
+}
+
+TEST(StencilRunTest, CoversStencil)
+{
+  const auto cells = getBoundaryCells(2.0);
+  auto result = getStencilRuns(cells);
+  EXPECT_LT(result.size(), cells.size());
+
+  std::size_t covered = 0;
+  for (const auto &run : result) { covered += static_cast<std::size_t>(run.z_end - run.z_begin + 1); }
+  EXPECT_EQ(covered, cells.size());
+}
+
+TEST(CellsPerSideTest, CellsAtLeastAsWideAsRadius)
+{
+  EXPECT_EQ(getCellsPerSide(32, 1.0), 32);
+  EXPECT_EQ(getCellsPerSide(32, 7.5), 4);
+  EXPECT_EQ(getCellsPerSide(30, 7.5), 4);
+  EXPECT_EQ(getCellsPerSide(4, 7.5), 1);
+}
+
+TEST(NeighbourRunTest, CoversNeighbours)
+{
+  auto result = getNeighbourRuns(4);
+  ASSERT_EQ(result.size(), 9);
+  EXPECT_EQ(result[0].dx, -1);
+  EXPECT_EQ(result[0].dy, -1);
+  EXPECT_EQ(result[8].dx, 1);
+  EXPECT_EQ(result[8].dy, 1);
+  for (const auto &run : result) {
+    EXPECT_EQ(run.z_begin, -1);
+    EXPECT_EQ(run.z_end, 1);
+  }
+}
+
+TEST(NeighbourRunTest, FewCells)
+{
+  // Each cell of the box is visited once
+  auto result = getNeighbourRuns(2);
+  ASSERT_EQ(result.size(), 4);
+  for (const auto &run : result) { EXPECT_EQ(run.z_end - run.z_begin + 1, 2); }
+
+  result = getNeighbourRuns(1);
+  ASSERT_EQ(result.size(), 1);
+  EXPECT_EQ(result[0].z_begin, result[0].z_end);
+}
@@ -0,0 +1,46 @@
+#include "cpu.hpp"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace testing;
+
+TEST(CpuTest, ParseSimdLevel)
+{
+  for (const auto level : { SimdLevel::Generic, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+    SimdLevel parsed{};
+    EXPECT_EQ(parseSimdLevel(toString(level), parsed), EXIT_SUCCESS);
+    EXPECT_EQ(parsed, level);
+  }
+
+  SimdLevel parsed{};
+  EXPECT_EQ(parseSimdLevel("avx", parsed), EXIT_FAILURE);
+  EXPECT_EQ(parseSimdLevel("AVX2", parsed), EXIT_FAILURE);
+}
+
+TEST(CpuTest, SetSimdLevel)
+{
+  // The supported level is in use until another one is forced
+  EXPECT_EQ(getSimdLevel(), getSupportedSimdLevel());
+
+  EXPECT_EQ(setSimdLevel(SimdLevel::Generic), EXIT_SUCCESS);
+  EXPECT_EQ(getSimdLevel(), SimdLevel::Generic);
+
+  EXPECT_EQ(setSimdLevel(getSupportedSimdLevel()), EXIT_SUCCESS);
+  EXPECT_EQ(getSimdLevel(), getSupportedSimdLevel());
+
+  // Forcing a newer level than the processor supports leaves the level unchanged
+  if (getSupportedSimdLevel() != SimdLevel::AVX512) {
+    EXPECT_EQ(setSimdLevel(SimdLevel::AVX512), EXIT_FAILURE);
+    EXPECT_EQ(getSimdLevel(), getSupportedSimdLevel());
+  }
+}
+
+TEST(CpuTest, PinThreads)
+{
+  EXPECT_EQ(pinThreads(ThreadAffinity::None), EXIT_SUCCESS);
+#if defined(__linux__)
+  EXPECT_EQ(pinThreads(ThreadAffinity::Spread), EXIT_SUCCESS);
+  EXPECT_EQ(pinThreads(ThreadAffinity::Close), EXIT_SUCCESS);
+#endif
+}
@@ -0,0 +1,150 @@
+#include "domain.hpp"
+#include "eom.hpp"
+#include "fish.hpp"
+#include "kdtree.hpp"
+#include "simulation.hpp"
+#include <cstddef>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <mpi.h>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+namespace {
+
+// The same school on every rank, the fish between x_lower and x_upper
+School makeSchool(std::size_t n_fish, double x_lower, double x_upper, double length)
+{
+  // NOLINTNEXTLINE(cert-msc32-c,cert-msc51-cpp)
+  std::mt19937 gen(17);
+  std::uniform_real_distribution<double> dis_x(x_lower, x_upper);
+  std::uniform_real_distribution<double> dis_pos(0.0, length);
+  std::uniform_real_distribution<double> dis_vel(-1.0, 1.0);
+  School fish(n_fish, Fish{});
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    fish[i].setPosition({ .x = dis_x(gen), .y = dis_pos(gen), .z = dis_pos(gen) });
+    fish[i].setVelocity({ .x = dis_vel(gen), .y = dis_vel(gen), .z = dis_vel(gen) });
+    fish[i].setLambda(i % 2 == 0 ? 1.0 : 0.0);
+  }
+  return fish;
+}
+
+unsigned long long countAll(const School &fish)
+{
+  auto n_fish = static_cast<unsigned long long>(fish.size());
+  unsigned long long total = 0;
+  MPI_Allreduce(&n_fish, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  return total;
+}
+
+}// namespace
+
+TEST(DomainTest, Migrate)
+{
+  SlabDecomposition domain(MPI_COMM_WORLD, 12, 3.0);
+  const School all = makeSchool(600, 0.0, 12.0, 12.0);
+
+  // Every rank starts with every size-th fish, wherever it is
+  School fish{};
+  for (std::size_t i = static_cast<std::size_t>(domain.getRank()); i < all.size();
+       i += static_cast<std::size_t>(domain.getSize())) {
+    fish.push_back(all[i]);
+  }
+  domain.migrate(fish);
+
+  EXPECT_EQ(countAll(fish), all.size());
+  for (const auto &one_fish : fish) {
+    EXPECT_GE(one_fish.getPosition().x, domain.getLower());
+    EXPECT_LT(one_fish.getPosition().x, domain.getUpper());
+    EXPECT_EQ(domain.getOwner(one_fish.getPosition().x), domain.getRank());
+  }
+}
+
+TEST(DomainTest, HaloMatchesOneProcess)
+{
+  // The interactions of the fish of each rank with its halo must be those of the whole school
+  const SimParam sim_param{ .length = 10, .n_fish = 800, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param{ .vel_standard = 1.0,
+    .vel_repulsion = 1.0,
+    .vel_escape = 7.5,
+    .body_length = 1.0,
+    .repulsion_radius = 1.0,
+    .attraction_radius = 3.0,
+    .n_cog = 3,
+    .attraction_str = 10.0,
+    .attraction_duration = 0.1 };
+
+  SlabDecomposition domain(MPI_COMM_WORLD, sim_param.length, fish_param.attraction_radius);
+  School reference = makeSchool(sim_param.n_fish, 0.0, 10.0, 10.0);
+
+  School fish{};
+  std::vector<std::size_t> index{};
+  for (std::size_t i = 0; i < reference.size(); i++) {
+    if (domain.getOwner(reference[i].getPosition().x) == domain.getRank()) {
+      fish.push_back(reference[i]);
+      index.push_back(i);
+    }
+  }
+  calcDeltaVelocitiesAllPairs(reference, sim_param, fish_param);
+
+  const std::size_t n_owned = domain.appendHalo(fish);
+  ASSERT_EQ(n_owned, index.size());
+  KdTree tree{};
+  tree.build(fish, sim_param.length);
+  calcDeltaVelocities(fish, n_owned, sim_param, fish_param, tree);
+
+  for (std::size_t i = 0; i < n_owned; i++) {
+    EXPECT_DOUBLE_EQ(fish[i].getLambda(), reference[index[i]].getLambda());
+    EXPECT_NEAR(fish[i].getDeltaVelocity().x, reference[index[i]].getDeltaVelocity().x, 1e-9);
+    EXPECT_NEAR(fish[i].getDeltaVelocity().y, reference[index[i]].getDeltaVelocity().y, 1e-9);
+    EXPECT_NEAR(fish[i].getDeltaVelocity().z, reference[index[i]].getDeltaVelocity().z, 1e-9);
+  }
+}
+
+TEST(DomainTest, Rebalance)
+{
+  // A school crowded into one end of the box starts in the first slabs
+  SlabDecomposition domain(MPI_COMM_WORLD, 16, 2.0);
+  const School all = makeSchool(1000, 1.0, 5.0, 16.0);
+  School fish{};
+  for (const auto &one_fish : all) {
+    if (domain.getOwner(one_fish.getPosition().x) == domain.getRank()) { fish.push_back(one_fish); }
+  }
+
+  domain.rebalance(fish);
+
+  EXPECT_EQ(countAll(fish), all.size());
+  EXPECT_LT(domain.getImbalance(fish), 1.1);
+  for (const auto &one_fish : fish) { EXPECT_EQ(domain.getOwner(one_fish.getPosition().x), domain.getRank()); }
+}
+
+TEST(DomainTest, VisitOnRoot)
+{
+  SlabDecomposition domain(MPI_COMM_WORLD, 12, 3.0);
+  School fish = makeSchool(static_cast<std::size_t>(10 * (domain.getRank() + 1)), 0.0, 12.0, 12.0);
+
+  const unsigned long long total = countAll(fish);
+
+  std::size_t visited = 0;
+  domain.visitOnRoot(fish, [&visited](std::span<const Fish> some_fish) { visited += some_fish.size(); });
+  EXPECT_EQ(visited, domain.getRank() == 0 ? total : 0);
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
+
+// The tests are collective, so every rank runs all of them, each checking its own fish
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  InitGoogleTest(&argc, argv);
+  const int result = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return result;
+}
@@ -0,0 +1,211 @@
+#include "driver.hpp"
+
+#include "eom.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+namespace {
+
+std::atomic<std::size_t> n_allocations{ 0 };// Calls to operator new in this test, from any thread
+
+}// namespace
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc,hicpp-no-malloc,misc-new-delete-overloads)
+void *operator new(std::size_t size)
+{
+  n_allocations++;
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) { return pointer; }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+  n_allocations++;
+  const auto align = static_cast<std::size_t>(alignment);
+  if (void *pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) { return pointer; }
+  throw std::bad_alloc();
+}
+
+// Not inlined, where the compiler would see the pointers of the new expressions handed to free()
+[[gnu::noinline]] void operator delete(void *pointer) noexcept { std::free(pointer); }
+[[gnu::noinline]] void operator delete(void *pointer, std::size_t /*size*/) noexcept { std::free(pointer); }
+[[gnu::noinline]] void operator delete(void *pointer, std::align_val_t /*alignment*/) noexcept { std::free(pointer); }
+[[gnu::noinline]] void operator delete(void *pointer, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+  std::free(pointer);
+}
+// NOLINTEND(cppcoreguidelines-no-malloc,hicpp-no-malloc,misc-new-delete-overloads)
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class SimulationTest : public ::testing::Test
+{
+protected:
+  const SimParam sim_param{ .length = 16,
+    .n_fish = 400,
+    .max_steps = 30,
+    .delta_t = 0.05,
+    .snapshot_interval = 10,
+    .neighbour_search = NeighbourSearch::AllPairs };
+  const FishParam fish_param{ .vel_standard = 1.5,
+    .vel_repulsion = 1.5,
+    .vel_escape = 7.5,
+    .body_length = 1.0,
+    .repulsion_radius = 1.0,
+    .attraction_radius = 3.0,
+    .n_cog = 3,
+    .attraction_str = 15.0,
+    .attraction_duration = 0.1 };
+
+  [[nodiscard]] School makeSchool(const SimParam &param) const
+  {
+    std::mt19937 gen(11);
+    return makeSphere(param, fish_param, gen);
+  }
+};
+
+TEST_F(SimulationTest, StepMatchesKernels)
+{
+  School expected = makeSchool(sim_param);
+  for (unsigned int step = 0; step < 10; step++) {
+    calcDeltaVelocitiesAllPairs(expected, sim_param, fish_param);
+    for (auto &one_fish : expected) { one_fish.update(sim_param, fish_param); }
+  }
+
+  Simulation simulation(sim_param, fish_param, makeSchool(sim_param));
+  simulation.step(4);
+  simulation.step(6);
+  EXPECT_EQ(simulation.getStep(), 10);
+  EXPECT_DOUBLE_EQ(simulation.getTime(), 0.5);
+
+  const School &fish = simulation.getSchool();
+  ASSERT_EQ(fish.size(), expected.size());
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    EXPECT_EQ(fish[i].getPosition().x, expected[i].getPosition().x) << "Fish " << i;
+    EXPECT_EQ(fish[i].getVelocity().y, expected[i].getVelocity().y);
+    EXPECT_EQ(fish[i].getLambda(), expected[i].getLambda());
+  }
+}
+
+TEST_F(SimulationTest, ObserversMatchSnapshots)
+{
+  // The observers see the school after the steps at which simulate() writes the snapshots
+  School fish = makeSchool(sim_param);
+  std::ostringstream expected{};
+  simulate(fish, sim_param, fish_param, makeStencils(sim_param, fish_param), expected, false);
+
+  Simulation simulation(sim_param, fish_param, makeSchool(sim_param));
+  std::ostringstream output{};
+  std::vector<unsigned int> steps{};
+  simulation.addObserver(sim_param.snapshot_interval, [&output, &steps](const Simulation &observed) {
+    observed.writeSnapshot(output);
+    steps.push_back(observed.getStep());
+  });
+  simulation.step(sim_param.max_steps);
+  EXPECT_EQ(output.str(), expected.str());
+  EXPECT_EQ(steps, (std::vector<unsigned int>{ 1, 11, 21 }));
+}
+
+TEST_F(SimulationTest, VoxelSnapshots)
+{
+  School fish = makeSchool(sim_param);
+  std::ostringstream expected{};
+  simulate(fish, sim_param, fish_param, makeStencils(sim_param, fish_param), expected, false);
+  std::vector<std::string> fish_lines{};
+  std::istringstream expected_lines(expected.str());
+  for (std::string line{}; std::getline(expected_lines, line);) { fish_lines.push_back(line); }
+
+  // Each snapshot holds all the fish in its voxels, then the same sample of the fish as the snapshots of every fish
+  SimParam param = sim_param;
+  param.output_mode = OutputMode::Voxels;
+  param.output_resolution = 4;
+  param.output_sample = 8;
+  fish = makeSchool(param);
+  std::ostringstream output{};
+  simulate(fish, param, fish_param, makeStencils(param, fish_param), output, false);
+  std::istringstream lines(output.str());
+  for (const unsigned int step : { 1U, 11U, 21U }) {
+    std::string line{};
+    ASSERT_TRUE(std::getline(lines, line));
+    std::istringstream header(line);
+    std::string hash{};
+    unsigned int header_step = 0;
+    double time = 0.0;
+    unsigned int n_voxels = 0;
+    header >> hash >> header_step >> time >> n_voxels;
+    EXPECT_EQ(header_step, step);
+    EXPECT_LE(n_voxels, 64);
+
+    unsigned int n_fish = 0;
+    for (unsigned int voxel = 0; voxel < n_voxels; voxel++) {
+      ASSERT_TRUE(std::getline(lines, line));
+      std::istringstream values(line);
+      unsigned int x = 0;
+      unsigned int y = 0;
+      unsigned int z = 0;
+      unsigned int count = 0;
+      values >> x >> y >> z >> count;
+      EXPECT_LT(std::max({ x, y, z }), 4);
+      n_fish += count;
+    }
+    EXPECT_EQ(n_fish, sim_param.n_fish);
+
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_EQ(line, "# sample 8");
+    const std::size_t snapshot = step / sim_param.snapshot_interval;
+    for (std::size_t i = 0; i < 8; i++) {
+      ASSERT_TRUE(std::getline(lines, line));
+      EXPECT_EQ(line, fish_lines[snapshot * sim_param.n_fish + i * sim_param.n_fish / 8]);
+    }
+  }
+  std::string line{};
+  EXPECT_FALSE(std::getline(lines, line));
+}
+
+TEST_F(SimulationTest, StepAllocatesNothing)
+{
+  // Every neighbour search, the generic repulsion of a larger n_cog, and cell lists updated in between the rebuilds
+  std::vector<SimParam> params(6, sim_param);
+  params[1].neighbour_search = NeighbourSearch::Cell;
+  params[2].neighbour_search = NeighbourSearch::Cell;
+  params[2].cell_grid = CellGrid::TwoLevel;
+  params[2].rebuild_interval = 4;
+  params[2].attraction_opening_angle = 0.5;
+  params[3].neighbour_search = NeighbourSearch::Tiled;
+  params[3].rebuild_interval = 3;
+  params[4].neighbour_search = NeighbourSearch::KdTree;
+  params[5].neighbour_search = NeighbourSearch::Cell;
+
+  for (std::size_t p = 0; p < params.size(); p++) {
+    FishParam param = fish_param;
+    if (p == params.size() - 1) { param.n_cog = 12; }
+
+    // The buffers of the threads grow with the fullest cells, which fill up as the school gathers, so that the run is
+    // made once beforehand. The lists of the simulation itself grow to the school in its first steps.
+    Simulation(params[p], param, makeSchool(params[p])).step(30);
+    Simulation simulation(params[p], param, makeSchool(params[p]));
+    unsigned int n_observed = 0;
+    simulation.addObserver(5, [&n_observed](const Simulation & /*observed*/) { n_observed++; });
+    simulation.step(5);
+    const std::size_t before = n_allocations;
+    simulation.step(25);
+    EXPECT_EQ(n_allocations - before, 0) << "Parameters " << p;
+    EXPECT_EQ(n_observed, 6);
+  }
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,182 @@
+#include "ensemble.hpp"
+
+#include "driver.hpp"
+#include "fish.hpp"
+#include "simulation.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <yaml-cpp/node/node.h>
+#include <yaml-cpp/node/parse.h>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class EnsembleTest : public ::testing::Test
+{
+protected:
+  YAML::Node ensembleConfig;
+
+  void SetUp() override
+  {
+    ensembleConfig = YAML::Load(R"(
+            configs:
+              - simulation-params:
+                  length: 16
+                  n-fish: 60
+                  max-steps: 20
+                  delta-t: 0.01
+                  snapshot-interval: 5
+                  neighbour-search: cell
+                fish-params:
+                  vel-standard: 1.5
+                  vel-repulsion: 1.5
+                  vel-escape: 7.5
+                  body-length: 1.0
+                  repulsion-radius: 1.0
+                  attraction-radius: 3.0
+                  n-cog: 3
+                  attraction-strength: 15.0
+                  attraction-duration: 0.1
+            sweep:
+              fish-params.attraction-radius: [3.0, 4.0]
+              simulation-params.n-fish: [60, 80, 100]
+            seeds: 2
+            seed: 5
+        )");
+  }
+
+  // Every replica must write what it writes on its own
+  static void expectRunsAlone(const Ensemble &ensemble)
+  {
+    for (std::size_t i = 0; i < ensemble.replicas.size(); i++) {
+      const auto &replica = ensemble.replicas[i];
+      std::mt19937 gen(replica.seed);
+      School fish = makeSphere(replica.sim_param, replica.fish_param, gen);
+      std::ostringstream expected{};
+      simulate(fish, replica.sim_param, replica.fish_param, makeStencils(replica.sim_param, replica.fish_param),
+        expected, false);
+
+      std::ifstream output_file(ensemble.output + "_" + std::to_string(i) + ".txt");
+      std::ostringstream output{};
+      output << output_file.rdbuf();
+      EXPECT_EQ(output.str(), expected.str()) << "Replica " << i;
+      EXPECT_FALSE(output.str().empty());
+    }
+  }
+};
+
+TEST_F(EnsembleTest, CartesianProduct)
+{
+  Ensemble ensemble{};
+  ASSERT_EQ(ensembleConfig >> ensemble, EXIT_SUCCESS);
+  ASSERT_EQ(ensemble.replicas.size(), 12);
+  EXPECT_EQ(ensemble.output, "replica");
+  EXPECT_EQ(ensemble.parallel_below, 20000);
+  EXPECT_TRUE(ensemble.batch_replicas);
+
+  // The last axis counts fastest, and each combination is repeated for every seed
+  for (std::size_t i = 0; i < ensemble.replicas.size(); i++) {
+    const auto &replica = ensemble.replicas[i];
+    EXPECT_EQ(replica.seed, 5 + i);
+    EXPECT_DOUBLE_EQ(replica.fish_param.attraction_radius, i < 6 ? 3.0 : 4.0);
+    EXPECT_EQ(replica.sim_param.n_fish, 60 + 20 * ((i / 2) % 3));
+    EXPECT_EQ(replica.sim_param.length, 16);
+  }
+  EXPECT_EQ(ensemble.replicas[0].label, "configs[0] attraction-radius=3.0 n-fish=60");
+}
+
+TEST_F(EnsembleTest, InvalidSweep)
+{
+  Ensemble ensemble{};
+  YAML::Node config = YAML::Clone(ensembleConfig);
+  config["sweep"]["length"] = YAML::Load("[8, 16]");
+  EXPECT_EQ(config >> ensemble, EXIT_FAILURE);
+
+  config = YAML::Clone(ensembleConfig);
+  config["sweep"]["other-params.length"] = YAML::Load("[8, 16]");
+  EXPECT_EQ(config >> ensemble, EXIT_FAILURE);
+
+  config = YAML::Clone(ensembleConfig);
+  config["sweep"]["simulation-params.length"] = 8;
+  EXPECT_EQ(config >> ensemble, EXIT_FAILURE);
+
+  config = YAML::Clone(ensembleConfig);
+  config["sweep"]["fish-params.n-cog"] = YAML::Load("[many]");
+  EXPECT_EQ(config >> ensemble, EXIT_FAILURE);
+
+  config = YAML::Clone(ensembleConfig);
+  config.remove("configs");
+  EXPECT_EQ(config >> ensemble, EXIT_FAILURE);
+}
+
+TEST_F(EnsembleTest, StencilsShared)
+{
+  Ensemble ensemble{};
+  ASSERT_EQ(ensembleConfig >> ensemble, EXIT_SUCCESS);
+
+  // One set of stencils for each attraction radius, whatever the number of fish and the seed
+  StencilCache cache{};
+  const auto &first = cache.get(ensemble.replicas[0].sim_param, ensemble.replicas[0].fish_param);
+  for (std::size_t i = 0; i < 6; i++) {
+    EXPECT_EQ(&cache.get(ensemble.replicas[i].sim_param, ensemble.replicas[i].fish_param), &first);
+  }
+  EXPECT_NE(&cache.get(ensemble.replicas[6].sim_param, ensemble.replicas[6].fish_param), &first);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_FALSE(first.repulsion_runs.empty());
+
+  // The k-d tree needs no stencils, whatever the radii
+  SimParam tree_param = ensemble.replicas[0].sim_param;
+  tree_param.neighbour_search = NeighbourSearch::KdTree;
+  EXPECT_TRUE(cache.get(tree_param, ensemble.replicas[0].fish_param).repulsion_runs.empty());
+  EXPECT_EQ(&cache.get(tree_param, ensemble.replicas[6].fish_param),
+    &cache.get(tree_param, ensemble.replicas[0].fish_param));
+  EXPECT_EQ(cache.size(), 3);
+}
+
+TEST_F(EnsembleTest, RunMatchesOneSimulation)
+{
+  // Replicas run side by side must write what they write on their own
+  Ensemble ensemble{};
+  ensembleConfig["seeds"] = 1;
+  ASSERT_EQ(ensembleConfig >> ensemble, EXIT_SUCCESS);
+  ensemble.output = testing::TempDir() + "ensemble_test";
+  ensemble.parallel_below = 80;
+
+  StencilCache cache{};
+  runEnsemble(ensemble, cache);
+  EXPECT_EQ(cache.size(), 2);
+
+  expectRunsAlone(ensemble);
+
+  std::ifstream index_file(ensemble.output + "_index.txt");
+  std::string line{};
+  std::getline(index_file, line);
+  EXPECT_EQ(line, "0 5 configs[0] attraction-radius=3.0 n-fish=60");
+}
+
+TEST_F(EnsembleTest, BatchedRunMatchesOneSimulation)
+{
+  // All-pairs replicas of the same size run as lanes of batches, the last of them not full
+  Ensemble ensemble{};
+  ensembleConfig["configs"][0]["simulation-params"]["neighbour-search"] = "all-pairs";
+  ensembleConfig["sweep"].remove("simulation-params.n-fish");
+  ensembleConfig["seeds"] = 5;
+  ASSERT_EQ(ensembleConfig >> ensemble, EXIT_SUCCESS);
+  ASSERT_EQ(ensemble.replicas.size(), 10);
+  ensemble.output = testing::TempDir() + "batched_ensemble_test";
+
+  StencilCache cache{};
+  runEnsemble(ensemble, cache);
+  expectRunsAlone(ensemble);
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
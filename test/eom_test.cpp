@@ -1,13 +1,123 @@
 #include "coordinate.hpp"
+#include "cpu.hpp"
+#include "driver.hpp"
 #include "eom.hpp"
 #include "fish.hpp"
+#include "grid.hpp"
+#include "kdtree.hpp"
+#include "nearest.hpp"
 #include "simulation.hpp"
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <gtest/gtest.h>
+#include <random>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 using namespace testing;
 
+namespace {
+
+// The fish parameters of the tests comparing the neighbour searches
+// NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+FishParam makeFishParam(double repulsion_radius = 1.0, double attraction_radius = 3.0, unsigned int n_cog = 3)
+{
+  // NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  return { .vel_standard = 1.0,
+    .vel_repulsion = 1.0,
+    .vel_escape = 7.5,
+    .body_length = 1.0,
+    .repulsion_radius = repulsion_radius,
+    .attraction_radius = attraction_radius,
+    .n_cog = n_cog,
+    .attraction_str = 10.0,
+    .attraction_duration = 0.1 };
+  // NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+}
+
+// Fish uniformly between lower and upper along each axis, wrapped into the box, of which every other one is attracted
+School makeRandomSchool(const SimParam &sim_param, unsigned int seed, double lower, double upper)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> dis_pos(lower, upper);
+  std::uniform_real_distribution<double> dis_vel(-1.0, 1.0);
+  School fish(sim_param.n_fish, Fish{});
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    fish[i].setPosition(periodic(Vect3{ .x = dis_pos(gen), .y = dis_pos(gen), .z = dis_pos(gen) }, sim_param.length));
+    fish[i].setVelocity({ .x = dis_vel(gen), .y = dis_vel(gen), .z = dis_vel(gen) });
+    fish[i].setLambda(i % 2 == 0 ? 1.0 : 0.0);
+  }
+  return fish;
+}
+
+// Copy of the school stored as F
+template<typename F> BasicSchool<F> convertSchool(const School &fish, unsigned int length)
+{
+  BasicSchool<F> copy{};
+  for (const auto &one_fish : fish) {
+    if constexpr (std::is_same_v<F, FixedFish>) {
+      copy.emplace_back(one_fish, length);
+    } else {
+      copy.emplace_back(one_fish);
+    }
+  }
+  return copy;
+}
+
+// Run every neighbour search on the school stored as F, and compare them with the all-pairs search in the same
+// precision by the root mean square of the error relative to the norm of the delta velocities
+template<typename F>
+void expectSearchesMatchAllPairs(const School &initial,
+  const SimParam &sim_param,
+  const FishParam &fish_param,
+  double tolerance)
+{
+  BasicSchool<F> reference = convertSchool<F>(initial, sim_param.length);
+  BasicSchool<F> cell_fish = reference;
+  BasicSchool<F> tiled_fish = reference;
+  BasicSchool<F> tree_fish = reference;
+  calcDeltaVelocitiesAllPairs(reference, sim_param, fish_param);
+
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+  BasicCellList<F> cells(sim_param.length, stencils.reach);
+  cells.build(cell_fish);
+  calcDeltaVelocities(
+    cell_fish, sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+
+  BasicCellList<F> tiled_cells(sim_param.length, stencils.reach);
+  tiled_cells.build(tiled_fish);
+  calcDeltaVelocitiesTiled(
+    tiled_fish, sim_param, fish_param, tiled_cells, stencils.repulsion_runs, tiled_cells, stencils.attractive_runs);
+
+  BasicKdTree<F> tree{};
+  tree.build(tree_fish, sim_param.length);
+  calcDeltaVelocities(tree_fish, sim_param, fish_param, tree);
+
+  // The tiled driver takes the same displacements in the same order as the per-fish one
+  for (std::size_t i = 0; i < cell_fish.size(); i++) {
+    EXPECT_EQ(tiled_fish[i].getLambda(), cell_fish[i].getLambda());
+    EXPECT_EQ(tiled_fish[i].getDeltaVelocity().x, cell_fish[i].getDeltaVelocity().x);
+    EXPECT_EQ(tiled_fish[i].getDeltaVelocity().y, cell_fish[i].getDeltaVelocity().y);
+    EXPECT_EQ(tiled_fish[i].getDeltaVelocity().z, cell_fish[i].getDeltaVelocity().z);
+  }
+
+  for (const auto *other : { &cell_fish, &tree_fish }) {
+    double squared_norm = 0.0;
+    double squared_error = 0.0;
+    for (std::size_t i = 0; i < reference.size(); i++) {
+      const auto delta_velocity = castVect3<double>(reference[i].getDeltaVelocity());
+      const double difference = absolute(castVect3<double>((*other)[i].getDeltaVelocity()) - delta_velocity);
+      squared_norm += absolute(delta_velocity) * absolute(delta_velocity);
+      squared_error += difference * difference;
+    }
+    EXPECT_LT(std::sqrt(squared_error / squared_norm), tolerance);
+  }
+}
+
+}// namespace
+
 TEST(EOMTest, GFactor)
 {
   // Test the g factor for the repulsion interaction
@@ -601,4 +711,440 @@ TEST(RepulsionTest, JustOutsideRadius)
   EXPECT_TRUE(std::isfinite(delta_v_1.x));
   EXPECT_TRUE(std::isfinite(delta_v_1.y));
   EXPECT_TRUE(std::isfinite(delta_v_1.z));
-}
\ No newline at end of file
+}
+
+TEST(EOMTest, CellListMatchesNestedCells)
+{
+  // Compare the kernels scanning the runs of a cell list with the ones walking the nested cells
+  const SimParam sim_param{ .length = 10, .n_fish = 300, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School fish = makeRandomSchool(sim_param, 42, 0.0, sim_param.length);
+  for (auto &one_fish : fish) { one_fish.setLambda(1.0); }
+
+  std::vector<std::vector<std::vector<std::vector<Fish *>>>> nested_cells(sim_param.length,
+    std::vector<std::vector<std::vector<Fish *>>>(
+      sim_param.length, std::vector<std::vector<Fish *>>(sim_param.length)));
+  for (auto &one_fish : fish) {
+    auto [x, y, z] = one_fish.getPosition();
+    nested_cells[static_cast<unsigned long>(x)][static_cast<unsigned long>(y)][static_cast<unsigned long>(z)].push_back(
+      &one_fish);
+  }
+
+  const auto repulsion_boundary = getBoundaryCells(fish_param.repulsion_radius);
+  const auto repulsion_inner = getInnerCells(fish_param.repulsion_radius);
+  const auto attractive_boundary = getBoundaryBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
+  const auto attractive_inner = getInnerBetween(fish_param.repulsion_radius, fish_param.attraction_radius);
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+
+  CellList cells(sim_param.length, stencils.reach);
+  cells.build(fish);
+
+  for (const auto &one_fish : fish) {
+    auto [expected_repulsion, expected_n_repulsion] =
+      calcRepulsion(one_fish, sim_param, fish_param, nested_cells, repulsion_boundary, repulsion_inner);
+    auto [delta_v_repulsion, n_repulsion] =
+      calcRepulsion(one_fish, sim_param, fish_param, cells, stencils.repulsion_runs);
+    EXPECT_EQ(n_repulsion, expected_n_repulsion);
+    EXPECT_NEAR(delta_v_repulsion.x, expected_repulsion.x, 1e-9);
+    EXPECT_NEAR(delta_v_repulsion.y, expected_repulsion.y, 1e-9);
+    EXPECT_NEAR(delta_v_repulsion.z, expected_repulsion.z, 1e-9);
+
+    auto [expected_attraction, expected_n_attraction] =
+      calcAttraction(one_fish, sim_param, fish_param, nested_cells, attractive_boundary, attractive_inner);
+    auto [delta_v_attraction, n_attraction] =
+      calcAttraction(one_fish, sim_param, fish_param, cells, stencils.attractive_runs);
+    EXPECT_EQ(n_attraction, expected_n_attraction);
+    EXPECT_NEAR(delta_v_attraction.x, expected_attraction.x, 1e-9);
+    EXPECT_NEAR(delta_v_attraction.y, expected_attraction.y, 1e-9);
+    EXPECT_NEAR(delta_v_attraction.z, expected_attraction.z, 1e-9);
+  }
+}
+
+TEST(EOMTest, TiledMatchesPerFish)
+{
+  // The tiled driver visits the neighbours of each fish in the same order as the per-fish driver
+  const SimParam sim_param{ .length = 10, .n_fish = 2000, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School fish = makeRandomSchool(sim_param, 7, 0.0, sim_param.length);
+  School tiled_fish = fish;
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+
+  CellList cells(sim_param.length, stencils.reach);
+  cells.build(fish);
+  calcDeltaVelocities(fish, sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+
+  CellList tiled_cells(sim_param.length, stencils.reach);
+  tiled_cells.build(tiled_fish);
+  calcDeltaVelocitiesTiled(
+    tiled_fish, sim_param, fish_param, tiled_cells, stencils.repulsion_runs, tiled_cells, stencils.attractive_runs);
+
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getLambda(), fish[i].getLambda());
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getDeltaVelocity().x, fish[i].getDeltaVelocity().x);
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getDeltaVelocity().y, fish[i].getDeltaVelocity().y);
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getDeltaVelocity().z, fish[i].getDeltaVelocity().z);
+  }
+}
+
+TEST(EOMTest, TwoLevelMatchesUnitGrid)
+{
+  // Searching the fine and coarse grids with 27-cell stencils finds the same neighbours as the unit grid
+  const SimParam sim_param{ .length = 12, .n_fish = 1500, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const FishParam fish_param = makeFishParam(1.5, 3.5);
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School fish = makeRandomSchool(sim_param, 11, 0.0, sim_param.length);
+  School two_level_fish = fish;
+  School tiled_fish = fish;
+
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+  CellList cells(sim_param.length, stencils.reach);
+  cells.build(fish);
+  calcDeltaVelocities(fish, sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+
+  SimParam two_level_param = sim_param;
+  two_level_param.cell_grid = CellGrid::TwoLevel;
+  const Stencils two_level = makeStencils(two_level_param, fish_param);
+  CellList fine(sim_param.length, two_level.fine_side, 1);
+  CellList coarse(sim_param.length, two_level.coarse_side, 1);
+  CellList::build(two_level_fish, fine, coarse);
+  calcDeltaVelocities(
+    two_level_fish, sim_param, fish_param, fine, two_level.repulsion_runs, coarse, two_level.attractive_runs);
+
+  CellList tiled_fine(sim_param.length, two_level.fine_side, 1);
+  CellList tiled_coarse(sim_param.length, two_level.coarse_side, 1);
+  CellList::build(tiled_fish, tiled_fine, tiled_coarse);
+  calcDeltaVelocitiesTiled(
+    tiled_fish, sim_param, fish_param, tiled_fine, two_level.repulsion_runs, tiled_coarse, two_level.attractive_runs);
+
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    EXPECT_DOUBLE_EQ(two_level_fish[i].getLambda(), fish[i].getLambda());
+    EXPECT_NEAR(two_level_fish[i].getDeltaVelocity().x, fish[i].getDeltaVelocity().x, 1e-9);
+    EXPECT_NEAR(two_level_fish[i].getDeltaVelocity().y, fish[i].getDeltaVelocity().y, 1e-9);
+    EXPECT_NEAR(two_level_fish[i].getDeltaVelocity().z, fish[i].getDeltaVelocity().z, 1e-9);
+
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getLambda(), two_level_fish[i].getLambda());
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getDeltaVelocity().x, two_level_fish[i].getDeltaVelocity().x);
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getDeltaVelocity().y, two_level_fish[i].getDeltaVelocity().y);
+    EXPECT_DOUBLE_EQ(tiled_fish[i].getDeltaVelocity().z, two_level_fish[i].getDeltaVelocity().z);
+  }
+}
+
+TEST(EOMTest, ApproximateAttraction)
+{
+  // Dense ball of fish, so that the far cells hold several fish
+  const SimParam sim_param{ .length = 16, .n_fish = 4000, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const FishParam fish_param = makeFishParam(1.0, 5.0);
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School fish = makeRandomSchool(sim_param, 5, 4.0, 12.0);
+  for (auto &one_fish : fish) { one_fish.setLambda(1.0); }
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+
+  CellList cells(sim_param.length, stencils.reach);
+  cells.build(fish);
+  cells.computeCentroids();
+
+  double squared_error = 0.0;
+  for (const auto &one_fish : fish) {
+    auto [exact, n_exact] = calcAttraction(one_fish, sim_param, fish_param, cells, stencils.attractive_runs);
+
+    // No cell is seen under a small enough angle, so the sum is exact
+    auto [narrow, n_narrow] =
+      calcAttraction(one_fish, sim_param, fish_param, cells, stencils.attractive_runs, 1e-6);
+    EXPECT_EQ(n_narrow, n_exact);
+    EXPECT_NEAR(narrow.x, exact.x, 1e-9);
+    EXPECT_NEAR(narrow.y, exact.y, 1e-9);
+    EXPECT_NEAR(narrow.z, exact.z, 1e-9);
+
+    // Only the cells entirely within the attraction zone are approximated, so the count is unchanged
+    auto [approximate, n_approximate] =
+      calcAttraction(one_fish, sim_param, fish_param, cells, stencils.attractive_runs, 1.0);
+    EXPECT_EQ(n_approximate, n_exact);
+    if (absolute(exact) > 0) {
+      const double error = absolute(approximate - exact) / absolute(exact);
+      EXPECT_LT(error, 0.05);
+      squared_error += error * error;
+    }
+  }
+  EXPECT_LT(std::sqrt(squared_error / static_cast<double>(fish.size())), 0.01);
+}
+
+TEST(EOMTest, KdTreeMatchesCellList)
+{
+  // Crowd the fish into a small ball across the periodic boundary, where the cells hold many fish each
+  const SimParam sim_param{ .length = 10, .n_fish = 1500, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School fish = makeRandomSchool(sim_param, 13, -0.5, 3.5);
+  School tree_fish = fish;
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+
+  CellList cells(sim_param.length, stencils.reach);
+  cells.build(fish);
+  calcDeltaVelocities(fish, sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+
+  KdTree tree{};
+  tree.build(tree_fish, sim_param.length);
+  calcDeltaVelocities(tree_fish, sim_param, fish_param, tree);
+
+  for (std::size_t i = 0; i < fish.size(); i++) {
+    EXPECT_DOUBLE_EQ(tree_fish[i].getLambda(), fish[i].getLambda());
+    EXPECT_NEAR(tree_fish[i].getDeltaVelocity().x, fish[i].getDeltaVelocity().x, 1e-9);
+    EXPECT_NEAR(tree_fish[i].getDeltaVelocity().y, fish[i].getDeltaVelocity().y, 1e-9);
+    EXPECT_NEAR(tree_fish[i].getDeltaVelocity().z, fish[i].getDeltaVelocity().z, 1e-9);
+  }
+}
+
+TEST(EOMTest, AllPairsIsReference)
+{
+  // The all-pairs search checks every fish, so every other search must agree with it
+  const SimParam sim_param{ .length = 10, .n_fish = 800, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School reference = makeRandomSchool(sim_param, 17, 0.0, sim_param.length);
+  School cell_fish = reference;
+  School tiled_fish = reference;
+  School tree_fish = reference;
+  calcDeltaVelocitiesAllPairs(reference, sim_param, fish_param);
+
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+  CellList cells(sim_param.length, stencils.reach);
+  cells.build(cell_fish);
+  calcDeltaVelocities(
+    cell_fish, sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+
+  CellList tiled_cells(sim_param.length, stencils.reach);
+  tiled_cells.build(tiled_fish);
+  calcDeltaVelocitiesTiled(
+    tiled_fish, sim_param, fish_param, tiled_cells, stencils.repulsion_runs, tiled_cells, stencils.attractive_runs);
+
+  KdTree tree{};
+  tree.build(tree_fish, sim_param.length);
+  calcDeltaVelocities(tree_fish, sim_param, fish_param, tree);
+
+  for (const auto *other : { &cell_fish, &tiled_fish, &tree_fish }) {
+    for (std::size_t i = 0; i < reference.size(); i++) {
+      EXPECT_DOUBLE_EQ((*other)[i].getLambda(), reference[i].getLambda());
+      EXPECT_NEAR((*other)[i].getDeltaVelocity().x, reference[i].getDeltaVelocity().x, 1e-9);
+      EXPECT_NEAR((*other)[i].getDeltaVelocity().y, reference[i].getDeltaVelocity().y, 1e-9);
+      EXPECT_NEAR((*other)[i].getDeltaVelocity().z, reference[i].getDeltaVelocity().z, 1e-9);
+    }
+  }
+}
+
+TEST(EOMTest, AllPairsReducedPrecision)
+{
+  const SimParam sim_param{ .length = 10, .n_fish = 800, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  School reference = makeRandomSchool(sim_param, 19, 0.0, sim_param.length);
+  BasicSchool<FishF> float_fish(reference.begin(), reference.end());
+  BasicSchool<MixedFish> mixed_fish(reference.begin(), reference.end());
+  BasicSchool<FixedFish> fixed_fish{};
+  for (const auto &one_fish : reference) { fixed_fish.emplace_back(one_fish, sim_param.length); }
+  calcDeltaVelocitiesAllPairs(reference, sim_param, fish_param);
+  calcDeltaVelocitiesAllPairs(float_fish, sim_param, fish_param);
+  calcDeltaVelocitiesAllPairs(mixed_fish, sim_param, fish_param);
+  calcDeltaVelocitiesAllPairs(fixed_fish, sim_param, fish_param);
+
+  // A pair on the edge of a zone may fall on either side in float, so compare the root mean square of the error
+  double squared_norm = 0.0;
+  double float_error = 0.0;
+  double mixed_error = 0.0;
+  double fixed_error = 0.0;
+  for (std::size_t i = 0; i < reference.size(); i++) {
+    const Vect3 delta_velocity = reference[i].getDeltaVelocity();
+    const double float_difference = absolute(castVect3<double>(float_fish[i].getDeltaVelocity()) - delta_velocity);
+    const double mixed_difference = absolute(mixed_fish[i].getDeltaVelocity() - delta_velocity);
+    const double fixed_difference = absolute(fixed_fish[i].getDeltaVelocity() - delta_velocity);
+    squared_norm += absolute(delta_velocity) * absolute(delta_velocity);
+    float_error += float_difference * float_difference;
+    mixed_error += mixed_difference * mixed_difference;
+    fixed_error += fixed_difference * fixed_difference;
+  }
+  EXPECT_LT(std::sqrt(float_error / squared_norm), 1e-4);
+  EXPECT_LT(std::sqrt(mixed_error / squared_norm), 1e-4);
+  EXPECT_LT(std::sqrt(fixed_error / squared_norm), 1e-6);
+}
+
+TEST(EOMTest, ReducedPrecisionSearches)
+{
+  // The cell lists, the tiled driver and the k-d tree find the same neighbours in every precision
+  const SimParam sim_param{ .length = 10, .n_fish = 800, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const School initial = makeRandomSchool(sim_param, 31, 0.0, sim_param.length);
+  // NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  expectSearchesMatchAllPairs<FishF>(initial, sim_param, fish_param, 1e-4);
+  expectSearchesMatchAllPairs<MixedFish>(initial, sim_param, fish_param, 1e-4);
+  expectSearchesMatchAllPairs<FixedFish>(initial, sim_param, fish_param, 1e-6);
+  // NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+}
+
+TEST(EOMTest, AllPairsSimdLevels)
+{
+  // Every level the processor supports gives the same velocities to the last bit
+  const SimParam sim_param{ .length = 10, .n_fish = 700, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const School initial = makeRandomSchool(sim_param, 29, 0.0, sim_param.length);
+
+  const auto run = [&](SimdLevel level) {
+    EXPECT_EQ(setSimdLevel(level), EXIT_SUCCESS);
+    School fish = initial;
+    BasicSchool<FishF> float_fish(initial.begin(), initial.end());
+    BasicSchool<FixedFish> fixed_fish{};
+    for (const auto &one_fish : initial) { fixed_fish.emplace_back(one_fish, sim_param.length); }
+    calcDeltaVelocitiesAllPairs(fish, sim_param, fish_param);
+    calcDeltaVelocitiesAllPairs(float_fish, sim_param, fish_param);
+    calcDeltaVelocitiesAllPairs(fixed_fish, sim_param, fish_param);
+
+    std::vector<Vect3> delta_velocities{};
+    for (std::size_t i = 0; i < initial.size(); i++) {
+      delta_velocities.push_back(fish[i].getDeltaVelocity());
+      delta_velocities.push_back(castVect3<double>(float_fish[i].getDeltaVelocity()));
+      delta_velocities.push_back(fixed_fish[i].getDeltaVelocity());
+    }
+    return delta_velocities;
+  };
+
+  const auto reference = run(SimdLevel::Generic);
+  for (const auto level : { SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+    if (level > getSupportedSimdLevel()) { break; }
+    const auto delta_velocities = run(level);
+    for (std::size_t i = 0; i < reference.size(); i++) {
+      EXPECT_EQ(delta_velocities[i].x, reference[i].x);
+      EXPECT_EQ(delta_velocities[i].y, reference[i].y);
+      EXPECT_EQ(delta_velocities[i].z, reference[i].z);
+    }
+  }
+  EXPECT_EQ(setSimdLevel(getSupportedSimdLevel()), EXIT_SUCCESS);
+}
+
+TEST(EOMTest, NeighbourSearchSimdLevels)
+{
+  // The searches are compiled for every level, which may only differ by the contraction to FMA of AVX-512
+  const SimParam sim_param{ .length = 10, .n_fish = 1200, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+  const FishParam fish_param = makeFishParam();
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const School initial = makeRandomSchool(sim_param, 37, 0.0, sim_param.length);
+  const Stencils stencils = makeStencils(sim_param, fish_param);
+
+  const auto run = [&](SimdLevel level) {
+    EXPECT_EQ(setSimdLevel(level), EXIT_SUCCESS);
+    std::vector<School> schools(3, initial);
+    CellList cells(sim_param.length, stencils.reach);
+    cells.build(schools[0]);
+    calcDeltaVelocities(
+      schools[0], sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+    CellList tiled_cells(sim_param.length, stencils.reach);
+    tiled_cells.build(schools[1]);
+    calcDeltaVelocitiesTiled(
+      schools[1], sim_param, fish_param, tiled_cells, stencils.repulsion_runs, tiled_cells, stencils.attractive_runs);
+    KdTree tree{};
+    tree.build(schools[2], sim_param.length);
+    calcDeltaVelocities(schools[2], sim_param, fish_param, tree);
+    return schools;
+  };
+
+  const auto reference = run(SimdLevel::Generic);
+  for (const auto level : { SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+    if (level > getSupportedSimdLevel()) { break; }
+    const auto schools = run(level);
+    for (std::size_t search = 0; search < schools.size(); search++) {
+      for (std::size_t i = 0; i < initial.size(); i++) {
+        const Fish &one_fish = schools[search][i];
+        const Fish &expected = reference[search][i];
+        EXPECT_EQ(one_fish.getLambda(), expected.getLambda());
+        EXPECT_NEAR(one_fish.getDeltaVelocity().x, expected.getDeltaVelocity().x, 1e-12);
+        EXPECT_NEAR(one_fish.getDeltaVelocity().y, expected.getDeltaVelocity().y, 1e-12);
+        EXPECT_NEAR(one_fish.getDeltaVelocity().z, expected.getDeltaVelocity().z, 1e-12);
+      }
+    }
+  }
+  EXPECT_EQ(setSimdLevel(getSupportedSimdLevel()), EXIT_SUCCESS);
+}
+
+TEST(EOMTest, NearestBuffer)
+{
+  NearestBuffer<3> nearest{};
+  nearest.insert(0.5, 4);
+  nearest.insert(0.25, 7);
+  EXPECT_EQ(nearest.size(), 2);
+
+  // The farthest fish is dropped once the buffer is full, and ties go to the smaller index
+  nearest.insert(0.75, 1);
+  nearest.insert(0.25, 2);
+  nearest.insert(0.9, 0);
+  ASSERT_EQ(nearest.size(), 3);
+  EXPECT_EQ(nearest.getIndex(0), 2);
+  EXPECT_EQ(nearest.getIndex(1), 7);
+  EXPECT_EQ(nearest.getIndex(2), 4);
+  EXPECT_DOUBLE_EQ(nearest.getDistance(2), 0.5);
+}
+
+TEST(EOMTest, OfferNearest)
+{
+  // The same fish as above, kept in a heap that never outgrows its capacity
+  std::vector<std::pair<double, unsigned int>> nearest{};
+  nearest.reserve(3);
+  const auto *data = nearest.data();
+  for (const auto &offered : { std::pair{ 0.5, 4U }, { 0.25, 7U }, { 0.75, 1U }, { 0.25, 2U }, { 0.9, 0U } }) {
+    offerNearest(nearest, 3, offered);
+  }
+  std::sort_heap(nearest.begin(), nearest.end());
+  ASSERT_EQ(nearest.size(), 3);
+  EXPECT_EQ(nearest.data(), data);
+  EXPECT_EQ(nearest[0].second, 2);
+  EXPECT_EQ(nearest[1].second, 7);
+  EXPECT_EQ(nearest[2].second, 4);
+
+  nearest.clear();
+  offerNearest(nearest, 0, { 0.5, 4U });
+  EXPECT_TRUE(nearest.empty());
+}
+
+TEST(EOMTest, SpecialisedNCogMatchesAllPairs)
+{
+  // Dense enough that most fish have more than n_cog fish in their repulsion zone
+  const SimParam sim_param{ .length = 8, .n_fish = 1200, .max_steps = 100, .delta_t = 0.1, .snapshot_interval = 10 };
+
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const School initial = makeRandomSchool(sim_param, 23, 0.0, sim_param.length);
+  // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+  const Stencils stencils = makeStencils(sim_param, makeFishParam(1.0, 2.0));
+
+  // n_cog up to 8 runs a specialised driver, and 9 the generic one
+  for (unsigned int n_cog = 1; n_cog <= 9; n_cog++) {
+    // NOLINTNEXTLINE(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+    const FishParam fish_param = makeFishParam(1.0, 2.0, n_cog);
+
+    School reference = initial;
+    School fish = initial;
+    calcDeltaVelocitiesAllPairs(reference, sim_param, fish_param);
+
+    CellList cells(sim_param.length, stencils.reach);
+    cells.build(fish);
+    calcDeltaVelocities(fish, sim_param, fish_param, cells, stencils.repulsion_runs, cells, stencils.attractive_runs);
+
+    for (std::size_t i = 0; i < fish.size(); i++) {
+      EXPECT_DOUBLE_EQ(fish[i].getLambda(), reference[i].getLambda());
+      EXPECT_NEAR(fish[i].getDeltaVelocity().x, reference[i].getDeltaVelocity().x, 1e-9);
+      EXPECT_NEAR(fish[i].getDeltaVelocity().y, reference[i].getDeltaVelocity().y, 1e-9);
+      EXPECT_NEAR(fish[i].getDeltaVelocity().z, reference[i].getDeltaVelocity().z, 1e-9);
+    }
+  }
+}
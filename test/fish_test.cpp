@@ -94,5 +94,61 @@ TEST(FishTest, Update)
   ASSERT_DOUBLE_EQ(fish.getLambda(), 15.0 - (15.0 / 100));
 }
 
+TEST(FishTest, MixedKeepsResolution)
+{
+  // Far from the origin of a large box, the steps of a float position are lost, but not those of the offset
+  const SimParam sim_param{
+    .length = 4096, .n_fish = 1, .max_steps = 1000, .delta_t = 0.01, .snapshot_interval = 100
+  };
+  const Fish initial(
+    { .x = 4000.25, .y = 0.5, .z = 0.5 }, { .x = 0.001, .y = 0, .z = 0 }, { .x = 0, .y = 0, .z = 0 }, 0);
+  FishF float_fish(initial);
+  MixedFish mixed_fish(initial);
+  for (int step = 0; step < 100; step++) {
+    float_fish.update(0.01F, sim_param.length, 0.0F);
+    mixed_fish.update(0.01, sim_param.length, 0.0);
+  }
+  EXPECT_FLOAT_EQ(float_fish.getPosition().x, 4000.25F);
+  EXPECT_NEAR(mixed_fish.getPosition().x, 4000.251, 1e-5);
+  EXPECT_EQ(mixed_fish.getCell()[0], 4000);
+}
+
+TEST(FishTest, MixedPeriodicBoundary)
+{
+  MixedFish fish(Fish({ .x = 9.99, .y = 0.01, .z = 5.0 }, { .x = 2, .y = -2, .z = 0 }, { .x = 0, .y = 0, .z = 0 }, 0));
+  fish.update(0.01, 10, 0.0);
+  EXPECT_EQ(fish.getCell()[0], 0);
+  EXPECT_EQ(fish.getCell()[1], 9);
+  EXPECT_EQ(fish.getCell()[2], 5);
+  EXPECT_NEAR(fish.getPosition().x, 0.01, 1e-6);
+  EXPECT_NEAR(fish.getPosition().y, 9.99, 1e-6);
+  EXPECT_NEAR(fish.getPosition().z, 5.0, 1e-6);
+}
+
+TEST(FishTest, MixedTinyNegativeStep)
+{
+  // The offset just below 0 would round up to 1 once carried into the cell below, so the fish stays at the start of
+  // its cell, including across the boundary of the box
+  const Fish initial(
+    { .x = 5.0, .y = 0.0, .z = 5.0 }, { .x = -1e-7, .y = -1e-7, .z = 0 }, { .x = 0, .y = 0, .z = 0 }, 0);
+  MixedFish fish(initial);
+  fish.update(0.01, 10, 0.0);
+  EXPECT_EQ(fish.getCell()[0], 5);
+  EXPECT_EQ(fish.getCell()[1], 0);
+  EXPECT_FLOAT_EQ(fish.getOffset().x, 0.0F);
+  EXPECT_FLOAT_EQ(fish.getOffset().y, 0.0F);
+  EXPECT_LT(fish.getOffset().x, 1.0F);
+}
+
+TEST(FishTest, FixedPeriodicBoundary)
+{
+  const Fish initial({ .x = 9.99, .y = 0.01, .z = 5.0 }, { .x = 2, .y = -2, .z = 0 }, { .x = 0, .y = 0, .z = 0 }, 0);
+  FixedFish fish(initial, 10);
+  fish.update(0.01, 10, 0.0);
+  EXPECT_NEAR(fish.getPosition(10).x, 0.01, 1e-8);
+  EXPECT_NEAR(fish.getPosition(10).y, 9.99, 1e-8);
+  EXPECT_NEAR(fish.getPosition(10).z, 5.0, 1e-8);
+}
+
 // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
 // NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,137 @@
+#include "fishschool.h"
+
+#include "driver.hpp"
+#include "fish.hpp"
+#include "io.hpp"
+#include "simulation.hpp"
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class FishSchoolTest : public ::testing::Test
+{
+protected:
+  const char *config = R"(
+            simulation-params:
+              length: 12
+              n-fish: 200
+              max-steps: 100
+              delta-t: 0.01
+              snapshot-interval: 10
+              neighbour-search: cell
+            fish-params:
+              vel-standard: 1.5
+              vel-repulsion: 1.5
+              vel-escape: 7.5
+              body-length: 1.0
+              repulsion-radius: 1.0
+              attraction-radius: 3.0
+              n-cog: 3
+              attraction-strength: 15.0
+              attraction-duration: 0.1
+        )";
+
+  static std::vector<double> copyView(const fishschool_view &view)
+  {
+    std::vector<double> values{};
+    for (std::size_t i = 0; i < view.n_fish; i++) {
+      for (std::size_t c = 0; c < 3; c++) { values.push_back(view.data[i * view.stride + c]); }
+    }
+    return values;
+  }
+};
+
+TEST_F(FishSchoolTest, StepsInPlace)
+{
+  fishschool *simulation = fishschool_create(config, 3);
+  ASSERT_NE(simulation, nullptr);
+  EXPECT_EQ(fishschool_fish_count(simulation), 200);
+  EXPECT_EQ(fishschool_length(simulation), 12);
+
+  // The views read the school of the simulation, which the steps update where it is
+  const fishschool_view positions = fishschool_positions(simulation);
+  const fishschool_view velocities = fishschool_velocities(simulation);
+  EXPECT_EQ(fishschool_step(simulation, 7), 0);
+  EXPECT_EQ(fishschool_step_count(simulation), 7);
+  EXPECT_DOUBLE_EQ(fishschool_time(simulation), 0.07);
+  EXPECT_EQ(fishschool_positions(simulation).data, positions.data);
+
+  // As the C++ simulation of the same parameters and seed
+  const YAML::Node node = YAML::Load(config);
+  SimParam sim_param{};
+  FishParam fish_param{};
+  ASSERT_EQ(node >> sim_param, EXIT_SUCCESS);
+  ASSERT_EQ(node >> fish_param, EXIT_SUCCESS);
+  std::mt19937 gen(3);
+  Simulation expected(sim_param, fish_param, makeSphere(sim_param, fish_param, gen));
+  expected.step(7);
+  for (std::size_t i = 0; i < positions.n_fish; i++) {
+    const Fish &one_fish = expected.getSchool()[i];
+    EXPECT_EQ(positions.data[i * positions.stride], one_fish.getPosition().x) << "Fish " << i;
+    EXPECT_EQ(positions.data[i * positions.stride + 2], one_fish.getPosition().z);
+    EXPECT_EQ(velocities.data[i * velocities.stride + 1], one_fish.getVelocity().y);
+  }
+  fishschool_destroy(simulation);
+}
+
+TEST_F(FishSchoolTest, CheckpointResumes)
+{
+  fishschool *simulation = fishschool_create(config, 5);
+  ASSERT_NE(simulation, nullptr);
+  fishschool_step(simulation, 4);
+  std::vector<unsigned char> checkpoint(fishschool_checkpoint_size(simulation));
+  ASSERT_EQ(fishschool_checkpoint(simulation, checkpoint.data(), checkpoint.size()), 0);
+  fishschool_step(simulation, 6);
+  const std::vector<double> expected = copyView(fishschool_positions(simulation));
+
+  // Into the same simulation, and into another one of as many fish
+  ASSERT_EQ(fishschool_restore(simulation, checkpoint.data(), checkpoint.size()), 0);
+  EXPECT_EQ(fishschool_step_count(simulation), 4);
+  fishschool_step(simulation, 6);
+  EXPECT_EQ(copyView(fishschool_positions(simulation)), expected);
+
+  fishschool *other = fishschool_create(config, 9);
+  ASSERT_EQ(fishschool_restore(other, checkpoint.data(), checkpoint.size()), 0);
+  fishschool_step(other, 6);
+  EXPECT_EQ(copyView(fishschool_positions(other)), expected);
+  EXPECT_EQ(fishschool_step_count(other), 10);
+
+  // Too small a buffer, and a checkpoint of another number of fish
+  EXPECT_NE(fishschool_checkpoint(simulation, checkpoint.data(), checkpoint.size() - 1), 0);
+  EXPECT_NE(fishschool_restore(simulation, checkpoint.data(), 8), 0);
+  YAML::Node larger = YAML::Load(config);
+  larger["simulation-params"]["n-fish"] = 300;
+  fishschool *large = fishschool_create(YAML::Dump(larger).c_str(), 5);
+  EXPECT_NE(fishschool_restore(large, checkpoint.data(), checkpoint.size()), 0);
+
+  fishschool_destroy(large);
+  fishschool_destroy(other);
+  fishschool_destroy(simulation);
+}
+
+TEST_F(FishSchoolTest, InvalidConfig)
+{
+  EXPECT_EQ(fishschool_create("simulation-params: [", 1), nullptr);
+  EXPECT_EQ(fishschool_create("fish-params: {}", 1), nullptr);
+
+  // The reduced precisions are not run by the library rather than silently run in double
+  YAML::Node reduced = YAML::Load(config);
+  for (const char *precision : { "float", "mixed", "fixed" }) {
+    reduced["simulation-params"]["precision"] = precision;
+    EXPECT_EQ(fishschool_create(YAML::Dump(reduced).c_str(), 1), nullptr);
+  }
+  reduced["simulation-params"]["precision"] = "double";
+  fishschool *simulation = fishschool_create(YAML::Dump(reduced).c_str(), 1);
+  EXPECT_NE(simulation, nullptr);
+  fishschool_destroy(simulation);
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,327 @@
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "grid.hpp"
+#include <algorithm>
+#include <array>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+TEST(CellListTest, SortsFishByCell)
+{
+  School fish(4, Fish{});
+  fish[0].setPosition(3.5, 0.5, 0.5);
+  fish[1].setPosition(0.5, 0.5, 2.5);
+  fish[2].setPosition(0.5, 0.5, 0.5);
+  fish[3].setPosition(3.2, 0.1, 0.9);
+
+  CellList cells(4, 1);
+  cells.build(fish);
+
+  ASSERT_EQ(cells.size(), 4);
+  EXPECT_EQ(cells.getFish(0), &fish[2]);
+  EXPECT_EQ(cells.getFish(1), &fish[1]);
+  // Fish in the same cell keep their original order
+  EXPECT_EQ(cells.getFish(2), &fish[0]);
+  EXPECT_EQ(cells.getFish(3), &fish[3]);
+  EXPECT_DOUBLE_EQ(cells.getPosition(3).x, 3.2);
+
+  const auto range = cells.getCellRange(cells.cellIndex(3, 0, 0));
+  EXPECT_EQ(range.begin, 2);
+  EXPECT_EQ(range.end, 4);
+  const auto empty = cells.getCellRange(cells.cellIndex(1, 1, 1));
+  EXPECT_EQ(empty.begin, empty.end);
+}
+
+TEST(CellListTest, ClampsPositionOnTheEdge)
+{
+  const CellList cells(4, 1);
+  const auto cell = cells.getCell({ .x = 4.0, .y = 0.0, .z = 3.999 });
+  EXPECT_EQ(cell[0], 3);
+  EXPECT_EQ(cell[1], 0);
+  EXPECT_EQ(cell[2], 3);
+}
+
+TEST(CellListTest, FixedPointCells)
+{
+  // The top bits of the coordinates give the cells the positions in double are in
+  const BasicCellList<FixedFish> cells(12, 3, 1);
+  const auto cell = cells.getCell(toFixed({ .x = 3.9, .y = 4.5, .z = 11.9 }, 12));
+  EXPECT_EQ(cell[0], 0);
+  EXPECT_EQ(cell[1], 1);
+  EXPECT_EQ(cell[2], 2);
+
+  // The largest coordinate is in the last cell without clamping
+  const auto edge = cells.getCell({ .x = 0xFFFFFFFFU, .y = 0, .z = 0x80000000U });
+  EXPECT_EQ(edge[0], 2);
+  EXPECT_EQ(edge[1], 0);
+  EXPECT_EQ(edge[2], 1);
+}
+
+TEST(CellListTest, FixedPointUpdateMatchesDouble)
+{
+  // Fixed-point fish are binned into the same cells as the fish in double, after the build and the updates
+  // NOLINTNEXTLINE(cert-msc32-c,cert-msc51-cpp)
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<double> dis_pos(0.0, 8.0);
+  std::uniform_real_distribution<double> dis_step(-0.2, 0.2);
+  School fish(300, Fish{});
+  for (auto &one_fish : fish) { one_fish.setPosition(dis_pos(gen), dis_pos(gen), dis_pos(gen)); }
+  BasicSchool<FixedFish> fixed_fish{};
+  for (const auto &one_fish : fish) { fixed_fish.emplace_back(one_fish, 8); }
+
+  BasicCellList<FixedFish> cells(8, 4, 1);
+  cells.build(fixed_fish, 2);
+  for (int step = 0; step < 10; step++) {
+    for (auto &one_fish : fixed_fish) {
+      one_fish.setPosition(
+        one_fish.getPosition(8) + Vect3{ .x = dis_step(gen), .y = dis_step(gen), .z = dis_step(gen) }, 8);
+    }
+    cells.update(fixed_fish);
+
+    unsigned int n_binned = 0;
+    for (unsigned int x = 0; x < 4; x++) {
+      for (unsigned int y = 0; y < 4; y++) {
+        for (unsigned int z = 0; z < 4; z++) {
+          const IndexRange range = cells.getCellRange(cells.cellIndex(x, y, z));
+          for (unsigned int i = range.begin; i < range.end; i++) {
+            const Vect3 position = fixed_fish[cells.getFishIndex(i)].getPosition(8);
+            EXPECT_EQ(x, static_cast<unsigned int>(position.x / 2));
+            EXPECT_EQ(y, static_cast<unsigned int>(position.y / 2));
+            EXPECT_EQ(z, static_cast<unsigned int>(position.z / 2));
+            n_binned++;
+          }
+        }
+      }
+    }
+    EXPECT_EQ(n_binned, fixed_fish.size());
+  }
+}
+
+TEST(CellListTest, CoarseCells)
+{
+  const CellList cells(12, 3, 1);
+  EXPECT_EQ(cells.getCellsPerSide(), 3);
+  const auto cell = cells.getCell({ .x = 3.9, .y = 4.0, .z = 12.0 });
+  EXPECT_EQ(cell[0], 0);
+  EXPECT_EQ(cell[1], 1);
+  EXPECT_EQ(cell[2], 2);
+}
+
+TEST(CellListTest, BuildsTwoListsInOnePass)
+{
+  School fish(3, Fish{});
+  fish[0].setPosition({ .x = 0.5, .y = 0.5, .z = 3.5 });
+  fish[1].setPosition({ .x = 0.5, .y = 0.5, .z = 0.5 });
+  fish[2].setPosition({ .x = 3.5, .y = 0.5, .z = 0.5 });
+
+  CellList fine(4, 1);
+  CellList coarse(4, 2, 1);
+  CellList::build(fish, fine, coarse);
+
+  EXPECT_EQ(fine.getFish(0), &fish[1]);
+  EXPECT_EQ(fine.getFish(1), &fish[0]);
+  EXPECT_EQ(fine.getFish(2), &fish[2]);
+  EXPECT_EQ(coarse.getFish(0), &fish[1]);
+  EXPECT_EQ(coarse.getFish(1), &fish[0]);
+  EXPECT_EQ(coarse.getFish(2), &fish[2]);
+  EXPECT_EQ(coarse.getFishIndex(0), 1);
+  EXPECT_EQ(coarse.getCellRange(coarse.cellIndex(0, 0, 0)).end, 1);
+  EXPECT_EQ(coarse.getCellRange(coarse.cellIndex(0, 0, 1)).end, 2);
+}
+
+TEST(CellListTest, RunCells)
+{
+  School fish(3, Fish{});
+  fish[0].setPosition(1.5, 1.5, 0.5);
+  fish[1].setPosition(1.5, 1.5, 1.5);
+  fish[2].setPosition(1.5, 1.5, 3.5);
+
+  CellList cells(4, 1);
+  cells.build(fish);
+  const unsigned int row = cells.cellIndex(1, 1, 0);
+
+  // Run from z - 1 to z + 1 around the cell (1, 1, 1) covers the cells holding the first two fish
+  const StencilRun run{ .dx = 0, .dy = 0, .z_begin = -1, .z_end = 1 };
+  auto ranges = cells.getRunCells({ 1, 1, 1 }, run);
+  EXPECT_EQ(ranges[0].begin, row);
+  EXPECT_EQ(ranges[0].end, row + 3);
+  EXPECT_EQ(ranges[1].begin, ranges[1].end);
+
+  // Around the cell (1, 1, 0) the run wraps over the boundary to z = 3
+  ranges = cells.getRunCells({ 1, 1, 0 }, run);
+  EXPECT_EQ(ranges[0].begin, row + 3);
+  EXPECT_EQ(ranges[0].end, row + 4);
+  EXPECT_EQ(ranges[1].begin, row);
+  EXPECT_EQ(ranges[1].end, row + 2);
+
+  // The neighbouring row is empty
+  ranges = cells.getRunCells({ 1, 1, 1 }, { .dx = 1, .dy = 0, .z_begin = -1, .z_end = 1 });
+  EXPECT_FALSE(cells.isOccupied(ranges[0]));
+  EXPECT_FALSE(cells.isOccupied(ranges[1]));
+}
+
+TEST(CellListTest, RunLongerThanBox)
+{
+  School fish(2, Fish{});
+  fish[0].setPosition(0.5, 0.5, 0.5);
+  fish[1].setPosition(0.5, 0.5, 1.5);
+
+  CellList cells(2, 2);
+  cells.build(fish);
+
+  // Each cell is visited once, even though the run covers the box twice
+  const auto ranges = cells.getRunCells({ 0, 0, 0 }, { .dx = 0, .dy = 0, .z_begin = -2, .z_end = 2 });
+  EXPECT_EQ(ranges[0].end - ranges[0].begin + ranges[1].end - ranges[1].begin, 2);
+}
+
+TEST(CellListTest, Occupancy)
+{
+  School fish(2, Fish{});
+  fish[0].setPosition(0.5, 0.5, 0.5);
+  fish[1].setPosition(2.5, 3.5, 1.5);
+
+  CellList cells(4, 1);
+  cells.build(fish);
+
+  EXPECT_TRUE(cells.isOccupied({ .begin = 0, .end = 1 }));
+  EXPECT_FALSE(cells.isOccupied({ .begin = 1, .end = cells.cellIndex(2, 3, 1) }));
+  // Range spanning several words of the bitmap
+  EXPECT_TRUE(cells.isOccupied({ .begin = 1, .end = cells.cellIndex(2, 3, 1) + 1 }));
+  EXPECT_FALSE(cells.isOccupied({ .begin = cells.cellIndex(2, 3, 2), .end = cells.cellIndex(3, 3, 3) + 1 }));
+  EXPECT_FALSE(cells.isOccupied({ .begin = 5, .end = 5 }));
+
+  EXPECT_EQ(cells.getPlaneCount(0), 1);
+  EXPECT_EQ(cells.getPlaneCount(1), 0);
+  EXPECT_EQ(cells.getPlaneCount(2), 1);
+  EXPECT_EQ(cells.getPlaneCount(3), 0);
+}
+
+TEST(CellListTest, ForEachInRuns)
+{
+  School fish(4, Fish{});
+  fish[0].setPosition(0.5, 1.5, 1.5);
+  fish[1].setPosition(2.5, 1.5, 0.5);
+  fish[2].setPosition(3.5, 3.5, 2.5);
+  fish[3].setPosition(1.5, 1.5, 3.5);
+
+  CellList cells(4, 1);
+  cells.build(fish);
+
+  // All the fish in the 27 cells around (2, 2, 0), which wraps around the box along z
+  std::vector<const Fish *> visited{};
+  cells.forEachInRuns({ 2, 2, 0 }, getStencilRuns(getBoundaryCells(0.5)), [&](unsigned int index) {
+    visited.push_back(cells.getFish(index));
+  });
+  EXPECT_THAT(visited, UnorderedElementsAre(&fish[1], &fish[3]));
+}
+
+TEST(CellListTest, UpdateMovesFish)
+{
+  School fish(3, Fish{});
+  fish[0].setPosition(0.5, 0.5, 0.5);
+  fish[1].setPosition(0.5, 0.5, 1.5);
+  fish[2].setPosition(2.5, 0.5, 0.5);
+
+  CellList cells(4, 1);
+  cells.build(fish, 1);
+  const unsigned int origin = cells.cellIndex(0, 0, 0);
+  EXPECT_EQ(cells.getCellRange(origin).end - cells.getCellRange(origin).begin, 1);
+
+  // Fish 0 joins fish 1, fish 2 leaves its plane, and fish 1 stays in its cell
+  fish[0].setPosition(0.5, 0.5, 1.2);
+  fish[1].setPosition(0.5, 0.5, 1.8);
+  fish[2].setPosition(3.5, 0.5, 0.5);
+  cells.update(fish);
+
+  EXPECT_FALSE(cells.isOccupied({ .begin = origin, .end = origin + 1 }));
+  const IndexRange range = cells.getCellRange(cells.cellIndex(0, 0, 1));
+  ASSERT_EQ(range.end - range.begin, 2);
+  EXPECT_EQ(cells.getFishIndex(range.begin), 1);
+  EXPECT_EQ(cells.getFishIndex(range.begin + 1), 0);
+  EXPECT_DOUBLE_EQ(cells.getPosition(range.begin).z, 1.8);
+  EXPECT_DOUBLE_EQ(cells.getPosition(range.begin + 1).z, 1.2);
+  EXPECT_EQ(cells.getPlaneCount(2), 0);
+  EXPECT_EQ(cells.getPlaneCount(3), 1);
+
+  // The cell has no room for a third fish, so the list is rebuilt
+  fish[2].setPosition(0.5, 0.5, 1.5);
+  cells.update(fish);
+  const IndexRange full = cells.getCellRange(cells.cellIndex(0, 0, 1));
+  ASSERT_EQ(full.end - full.begin, 3);
+  EXPECT_EQ(cells.getFishIndex(full.begin), 0);
+  EXPECT_EQ(cells.getFishIndex(full.begin + 1), 1);
+  EXPECT_EQ(cells.getFishIndex(full.begin + 2), 2);
+}
+
+TEST(CellListTest, UpdateMatchesBuild)
+{
+  // NOLINTNEXTLINE(cert-msc32-c,cert-msc51-cpp)
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<double> dis_pos(0.0, 8.0);
+  std::uniform_real_distribution<double> dis_step(-0.2, 0.2);
+  School fish(500, Fish{});
+  for (auto &one_fish : fish) { one_fish.setPosition(dis_pos(gen), dis_pos(gen), dis_pos(gen)); }
+
+  CellList cells(8, 1);
+  cells.build(fish, 2);
+  for (int step = 0; step < 20; step++) {
+    for (auto &one_fish : fish) {
+      one_fish.setPosition(
+        periodic(one_fish.getPosition() + Vect3{ .x = dis_step(gen), .y = dis_step(gen), .z = dis_step(gen) }, 8));
+    }
+    cells.update(fish);
+
+    CellList expected(8, 1);
+    expected.build(fish);
+    for (unsigned int cell_index = 0; cell_index < 8 * 8 * 8; cell_index++) {
+      const IndexRange range = cells.getCellRange(cell_index);
+      const IndexRange expected_range = expected.getCellRange(cell_index);
+      std::vector<unsigned int> indices{};
+      std::vector<unsigned int> expected_indices{};
+      for (unsigned int i = range.begin; i < range.end; i++) {
+        indices.push_back(cells.getFishIndex(i));
+        EXPECT_EQ(cells.getPosition(i).x, fish[cells.getFishIndex(i)].getPosition().x);
+        EXPECT_EQ(cells.getPosition(i).y, fish[cells.getFishIndex(i)].getPosition().y);
+        EXPECT_EQ(cells.getPosition(i).z, fish[cells.getFishIndex(i)].getPosition().z);
+      }
+      for (unsigned int i = expected_range.begin; i < expected_range.end; i++) {
+        expected_indices.push_back(expected.getFishIndex(i));
+      }
+      std::sort(indices.begin(), indices.end());
+      EXPECT_EQ(indices, expected_indices);
+      EXPECT_EQ(cells.isOccupied({ .begin = cell_index, .end = cell_index + 1 }), !expected_indices.empty());
+    }
+    for (unsigned int x = 0; x < 8; x++) { EXPECT_EQ(cells.getPlaneCount(x), expected.getPlaneCount(x)); }
+  }
+}
+
+TEST(CellListTest, Centroids)
+{
+  School fish(3, Fish{});
+  fish[0].setPosition(4.5, 0.5, 0.5);
+  fish[1].setPosition(5.5, 1.5, 0.5);
+  fish[2].setPosition(0.5, 0.5, 0.5);
+
+  CellList cells(8, 4, 1);
+  cells.build(fish);
+  cells.computeCentroids();
+
+  const unsigned int cell_index = cells.cellIndex(2, 0, 0);
+  EXPECT_EQ(cells.getCellCount(cell_index), 2);
+  EXPECT_DOUBLE_EQ(cells.getCentroid(cell_index).x, 5.0);
+  EXPECT_DOUBLE_EQ(cells.getCentroid(cell_index).y, 1.0);
+  EXPECT_DOUBLE_EQ(cells.getCentroid(cell_index).z, 0.5);
+  EXPECT_DOUBLE_EQ(cells.getCellCentre(cell_index).x, 5.0);
+  EXPECT_DOUBLE_EQ(cells.getCellCentre(cell_index).y, 1.0);
+  EXPECT_DOUBLE_EQ(cells.getCellCentre(cell_index).z, 1.0);
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
@@ -78,6 +78,270 @@ TEST_F(ConfigLoaderTest, ParseValidConfig)
   EXPECT_DOUBLE_EQ(fish_param.attraction_duration, 0.1);
 }
 
+TEST_F(ConfigLoaderTest, NeighbourSearch)
+{
+  // The neighbour search is optional and defaults to the k-d tree for schools of 1000 fish
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::KdTree);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["neighbour-search"] = "tiled";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Tiled);
+
+  config["simulation-params"]["neighbour-search"] = "octree";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, SmallSchoolThresholds)
+{
+  // Schools of 1000 fish default to the k-d tree
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.all_pairs_threshold, 150);
+  EXPECT_EQ(sim_param.kd_tree_threshold, 4000);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::KdTree);
+
+  // The smallest schools default to the all-pairs search, and the large ones to the cell lists
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["n-fish"] = 149;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::AllPairs);
+
+  config["simulation-params"]["n-fish"] = 3999;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::KdTree);
+
+  config["simulation-params"]["n-fish"] = 4000;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Cell);
+
+  config["simulation-params"]["n-fish"] = 1000;
+  config["simulation-params"]["kd-tree-threshold"] = 0;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Cell);
+
+  config["simulation-params"]["all-pairs-threshold"] = 2000;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::AllPairs);
+
+  // An explicit neighbour search takes precedence
+  config["simulation-params"]["neighbour-search"] = "tiled";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Tiled);
+
+  // The approximate attraction needs the cell search
+  config["simulation-params"].remove("neighbour-search");
+  config["simulation-params"]["attraction-opening-angle"] = 0.5;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Cell);
+}
+
+TEST_F(ConfigLoaderTest, CellListKeysKeepCellSearch)
+{
+  // A key of the cell lists keeps the cell search for a school that would otherwise use the k-d tree
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["cell-grid"] = "two-level";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Cell);
+
+  sim_param = {};
+  config = YAML::Clone(validConfig);
+  config["simulation-params"]["rebuild-interval"] = 20;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Cell);
+
+  // The smallest schools too
+  config["simulation-params"]["n-fish"] = 100;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Cell);
+
+  // The tiled search builds the same cell lists
+  config["simulation-params"]["neighbour-search"] = "tiled";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Tiled);
+
+  // The searches without cell lists cannot honour them
+  config["simulation-params"]["neighbour-search"] = "kd-tree";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+  config["simulation-params"]["neighbour-search"] = "all-pairs";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+
+  sim_param = {};
+  config["simulation-params"].remove("rebuild-interval");
+  config["simulation-params"]["cell-grid"] = "two-level";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, RebuildInterval)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.rebuild_interval, 1);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["rebuild-interval"] = 20;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.rebuild_interval, 20);
+
+  config["simulation-params"]["rebuild-interval"] = 0;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, AttractionOpeningAngle)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_DOUBLE_EQ(sim_param.attraction_opening_angle, 0.0);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["attraction-opening-angle"] = 0.5;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_DOUBLE_EQ(sim_param.attraction_opening_angle, 0.5);
+
+  config["simulation-params"]["attraction-opening-angle"] = -0.5;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+
+  // The tiled driver has no approximation
+  config["simulation-params"]["attraction-opening-angle"] = 0.5;
+  config["simulation-params"]["neighbour-search"] = "tiled";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, Precision)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.precision, Precision::Double);
+
+  // The reduced precisions search the neighbours as double does
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["precision"] = "mixed";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.precision, Precision::Mixed);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::KdTree);
+
+  config["simulation-params"]["neighbour-search"] = "tiled";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.neighbour_search, NeighbourSearch::Tiled);
+
+  config["simulation-params"].remove("neighbour-search");
+  config["simulation-params"]["precision"] = "fixed";
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.precision, Precision::Fixed);
+
+  config["simulation-params"]["precision"] = "half";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, MemoryPlacement)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.thread_affinity, ThreadAffinity::None);
+  EXPECT_FALSE(sim_param.huge_pages);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["thread-affinity"] = "spread";
+  config["simulation-params"]["huge-pages"] = true;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.thread_affinity, ThreadAffinity::Spread);
+  EXPECT_TRUE(sim_param.huge_pages);
+
+  config["simulation-params"]["thread-affinity"] = "compact";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, LoadImbalance)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_DOUBLE_EQ(sim_param.load_imbalance, 1.2);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["load-imbalance"] = 1.5;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_DOUBLE_EQ(sim_param.load_imbalance, 1.5);
+
+  config["simulation-params"]["load-imbalance"] = 0.5;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, RebalanceInterval)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.rebalance_interval, 10);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["rebalance-interval"] = 25;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.rebalance_interval, 25);
+
+  config["simulation-params"]["rebalance-interval"] = 0;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, ObservablesInterval)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.observables_interval, 0);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["observables-interval"] = 5;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.observables_interval, 5);
+}
+
+TEST_F(ConfigLoaderTest, ClusterRadius)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_DOUBLE_EQ(sim_param.cluster_radius, 0.0);
+
+  // Clusters are only found when the school is analysed
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["cluster-radius"] = 1.5;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+  config["simulation-params"]["observables-interval"] = 10;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_DOUBLE_EQ(sim_param.cluster_radius, 1.5);
+
+  config["simulation-params"]["cluster-radius"] = -1.0;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
+TEST_F(ConfigLoaderTest, AnalysisFields)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.rdf_bins, 0);
+  EXPECT_EQ(sim_param.field_resolution, 0);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["rdf-bins"] = 50;
+  config["simulation-params"]["field-resolution"] = 16;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+  config["simulation-params"]["observables-interval"] = 10;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.rdf_bins, 50);
+  EXPECT_EQ(sim_param.field_resolution, 16);
+}
+
+TEST_F(ConfigLoaderTest, OutputMode)
+{
+  ASSERT_EQ(validConfig >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.output_mode, OutputMode::Fish);
+  EXPECT_EQ(sim_param.output_resolution, 32);
+  EXPECT_EQ(sim_param.output_sample, 0);
+
+  YAML::Node config = YAML::Clone(validConfig);
+  config["simulation-params"]["output-mode"] = "voxels";
+  config["simulation-params"]["output-resolution"] = 64;
+  config["simulation-params"]["output-sample"] = 1000;
+  ASSERT_EQ(config >> sim_param, EXIT_SUCCESS);
+  EXPECT_EQ(sim_param.output_mode, OutputMode::Voxels);
+  EXPECT_EQ(sim_param.output_resolution, 64);
+  EXPECT_EQ(sim_param.output_sample, 1000);
+
+  config["simulation-params"]["output-resolution"] = 0;
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+  config["simulation-params"]["output-resolution"] = 64;
+  config["simulation-params"]["output-mode"] = "pixels";
+  EXPECT_EQ(config >> sim_param, EXIT_FAILURE);
+}
+
 TEST_F(ConfigLoaderTest, MissingSimParamsKey)
 {
   const YAML::Node incompleteConfig = YAML::Load(R"(
@@ -0,0 +1,112 @@
+#include "coordinate.hpp"
+#include "fish.hpp"
+#include "kdtree.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+TEST(KdTreeTest, Empty)
+{
+  KdTree tree{};
+  tree.build({}, 10);
+  EXPECT_EQ(tree.size(), 0);
+
+  unsigned int visited = 0;
+  tree.forEachWithin({ .x = 1.0, .y = 1.0, .z = 1.0 }, 5.0, [&](unsigned int, double) { visited++; });
+  EXPECT_EQ(visited, 0);
+
+  std::vector<std::pair<double, unsigned int>> nearest{};
+  tree.findNearest({ .x = 1.0, .y = 1.0, .z = 1.0 }, 3, 5.0, nullptr, nearest);
+  EXPECT_TRUE(nearest.empty());
+}
+
+TEST(KdTreeTest, Depth)
+{
+  School fish(100, Fish{});
+  for (std::size_t i = 0; i < fish.size(); i++) { fish[i].setPosition(0.05 * static_cast<double>(i), 0.5, 0.5); }
+
+  KdTree tree{};
+  tree.build(fish, 10);
+  // 100 fish are halved four times into leaves of at most 7 fish
+  EXPECT_EQ(tree.getDepth(), 4);
+  EXPECT_EQ(tree.size(), 100);
+}
+
+TEST(KdTreeTest, PeriodicBoundary)
+{
+  School fish(3, Fish{});
+  fish[0].setPosition(0.2, 5.0, 5.0);
+  fish[1].setPosition(9.9, 5.0, 5.0);
+  fish[2].setPosition(5.0, 5.0, 5.0);
+
+  KdTree tree{};
+  tree.build(fish, 10);
+
+  std::vector<unsigned int> found{};
+  tree.forEachWithin({ .x = 0.1, .y = 5.0, .z = 5.0 }, 0.5, [&](unsigned int i, double distance) {
+    found.push_back(tree.getFishIndex(i));
+    EXPECT_LE(distance, 0.5);
+  });
+  std::sort(found.begin(), found.end());
+  EXPECT_THAT(found, ElementsAre(0, 1));
+
+  // The nearest fish other than fish 1 lies across the boundary
+  std::vector<std::pair<double, unsigned int>> nearest{};
+  tree.findNearest({ .x = 9.9, .y = 5.0, .z = 5.0 }, 1, 1.0, &fish[1], nearest);
+  ASSERT_EQ(nearest.size(), 1);
+  EXPECT_EQ(tree.getFishIndex(nearest[0].second), 0);
+  EXPECT_NEAR(nearest[0].first, 0.3, 1e-12);
+}
+
+TEST(KdTreeTest, MatchesBruteForce)
+{
+  // NOLINTNEXTLINE(cert-msc32-c,cert-msc51-cpp)
+  std::mt19937 gen(9);
+  std::uniform_real_distribution<double> dis_pos(0.0, 12.0);
+  School fish(2000, Fish{});
+  for (auto &one_fish : fish) { one_fish.setPosition(dis_pos(gen), dis_pos(gen), dis_pos(gen)); }
+
+  KdTree tree{};
+  tree.build(fish, 12);
+
+  std::vector<std::pair<double, unsigned int>> nearest{};
+  for (std::size_t query = 0; query < fish.size(); query += 7) {
+    const Vect3 position = fish[query].getPosition();
+
+    // Fish within the radius by the minimum image distance
+    std::vector<std::pair<double, unsigned int>> expected{};
+    for (std::size_t i = 0; i < fish.size(); i++) {
+      const double distance = absolute(vect12(position, fish[i].getPosition(), 12));
+      if (distance <= 2.0) { expected.emplace_back(distance, static_cast<unsigned int>(i)); }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<std::pair<double, unsigned int>> found{};
+    tree.forEachWithin(position, 2.0, [&](unsigned int i, double distance) {
+      found.emplace_back(distance, tree.getFishIndex(i));
+    });
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, expected);
+
+    // Nearest fish other than the fish itself
+    tree.findNearest(position, 4, 2.0, &fish[query], nearest);
+    std::erase_if(expected, [&](const auto &pair) { return pair.second == query; });
+    ASSERT_EQ(nearest.size(), std::min<std::size_t>(4, expected.size()));
+    for (std::size_t i = 0; i < nearest.size(); i++) {
+      EXPECT_DOUBLE_EQ(nearest[i].first, expected[i].first);
+      EXPECT_EQ(tree.getFishIndex(nearest[i].second), expected[i].second);
+    }
+  }
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
@@ -0,0 +1,52 @@
+#include "memory.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+
+TEST(MemoryTest, FirstTouchVector)
+{
+  // Arrays below and above the size at which they are mapped and first touched by the threads
+  for (const std::size_t size : { std::size_t{ 100 }, std::size_t{ 100000 }, std::size_t{ 1000000 } }) {
+    std::vector<std::size_t, FirstTouchAllocator<std::size_t>> values(size);
+    std::iota(values.begin(), values.end(), 0);
+    values.resize(2 * size, 1);
+    EXPECT_EQ(values[size - 1], size - 1);
+    EXPECT_EQ(values[2 * size - 1], 1);
+  }
+}
+
+TEST(MemoryTest, FirstTouchZeroed)
+{
+  FirstTouchAllocator<double> allocator{};
+  const std::size_t size = 200000;
+  double *values = allocator.allocate(size);
+  for (std::size_t i = 0; i < size; i += 997) { EXPECT_EQ(values[i], 0.0); }
+  allocator.deallocate(values, size);
+}
+
+TEST(MemoryTest, HugePages)
+{
+  // Arrays of at least a huge page start on a huge page boundary
+  setHugePages(true);
+  EXPECT_TRUE(getHugePages());
+  FirstTouchAllocator<double> allocator{};
+  const std::size_t size = 3 << 18;
+  double *values = allocator.allocate(size);
+  values[size - 1] = 1.0;
+#if defined(__linux__)
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(values) % (std::size_t{ 2 } << 20), 0);
+#endif
+
+  // The array is unmapped whatever the setting is by then
+  setHugePages(false);
+  allocator.deallocate(values, size);
+  EXPECT_FALSE(getHugePages());
+}
+
+// NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
@@ -0,0 +1,155 @@
+#include "render.hpp"
+
+#include "coordinate.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+// NOLINTBEGIN(readability-magic-numbers)
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+TEST(RenderTest, HsvToRgb)
+{
+  const Rgb red = hsvToRgb(0.0, 1.0, 1.0);
+  EXPECT_EQ(red.r, 255);
+  EXPECT_EQ(red.g, 0);
+  EXPECT_EQ(red.b, 0);
+
+  const Rgb green = hsvToRgb(1.0 / 3.0, 1.0, 1.0);
+  EXPECT_EQ(green.r, 0);
+  EXPECT_EQ(green.g, 255);
+  EXPECT_EQ(green.b, 0);
+
+  const Rgb blue = hsvToRgb(2.0 / 3.0, 1.0, 1.0);
+  EXPECT_EQ(blue.r, 0);
+  EXPECT_EQ(blue.g, 0);
+  EXPECT_EQ(blue.b, 255);
+
+  // No saturation leaves a grey of the value
+  const Rgb grey = hsvToRgb(0.4, 0.0, 0.5);
+  EXPECT_EQ(grey.r, 128);
+  EXPECT_EQ(grey.g, 128);
+  EXPECT_EQ(grey.b, 128);
+}
+
+TEST(RenderTest, FishColour)
+{
+  // The hue follows the heading, so opposite headings differ in colour
+  const Rgb east = fishColour({ .x = 1.0, .y = 0.0, .z = 0.0 }, 1.0);
+  const Rgb west = fishColour({ .x = -1.0, .y = 0.0, .z = 0.0 }, 1.0);
+  EXPECT_TRUE(east.r != west.r || east.g != west.g || east.b != west.b);
+
+  // Rising fish are brighter than sinking ones
+  const Rgb rising = fishColour({ .x = 1.0, .y = 0.0, .z = 1.0 }, 1.0);
+  const Rgb sinking = fishColour({ .x = 1.0, .y = 0.0, .z = -1.0 }, 1.0);
+  EXPECT_GT(rising.r + rising.g + rising.b, sinking.r + sinking.g + sinking.b);
+}
+
+TEST(RenderTest, Projection)
+{
+  const unsigned int length = 10;
+  const unsigned int width = 400;
+  const unsigned int height = 300;
+  const Projection projection(length, width, height, 60.0, 30.0);
+
+  const Vect3 centre = projection.project({ .x = 5.0, .y = 5.0, .z = 5.0 });
+  EXPECT_NEAR(centre.x, 200.0, 1e-9);
+  EXPECT_NEAR(centre.y, 150.0, 1e-9);
+
+  for (unsigned int corner = 0; corner < 8; corner++) {
+    const Vect3 pixel = projection.project({ .x = (corner & 4U) != 0 ? 10.0 : 0.0,
+      .y = (corner & 2U) != 0 ? 10.0 : 0.0,
+      .z = (corner & 1U) != 0 ? 10.0 : 0.0 });
+    EXPECT_GE(pixel.x, 0.0);
+    EXPECT_LT(pixel.x, width);
+    EXPECT_GE(pixel.y, 0.0);
+    EXPECT_LT(pixel.y, height);
+  }
+
+  // The top of the box is drawn above its bottom
+  const Vect3 top = projection.project({ .x = 5.0, .y = 5.0, .z = 10.0 });
+  const Vect3 bottom = projection.project({ .x = 5.0, .y = 5.0, .z = 0.0 });
+  EXPECT_LT(top.y, bottom.y);
+}
+
+TEST(RenderTest, ReadSnapshots)
+{
+  // Two snapshots of two fish and the first line of a third
+  std::istringstream input("0 1 2 0.5 0 0\n3 4 5 0 -0.5 0\n6 7 8 0 0 1\n9 10 11 1 0 0\n12 13 14 0 0 0\n");
+  std::string text{};
+  Snapshot snapshot{};
+
+  ASSERT_TRUE(readSnapshotText(input, 2, text));
+  ASSERT_TRUE(parseSnapshot(text, snapshot));
+  ASSERT_EQ(snapshot.positions.size(), 2);
+  EXPECT_DOUBLE_EQ(snapshot.positions[1].z, 5.0);
+  EXPECT_DOUBLE_EQ(snapshot.velocities[1].y, -0.5);
+
+  ASSERT_TRUE(readSnapshotText(input, 2, text));
+  ASSERT_TRUE(parseSnapshot(text, snapshot));
+  ASSERT_EQ(snapshot.positions.size(), 2);
+  EXPECT_DOUBLE_EQ(snapshot.positions[0].x, 6.0);
+  EXPECT_DOUBLE_EQ(snapshot.velocities[1].x, 1.0);
+
+  // The last snapshot is incomplete
+  EXPECT_FALSE(readSnapshotText(input, 2, text));
+  EXPECT_FALSE(text.empty());
+
+  EXPECT_FALSE(parseSnapshot("0 1 2 0.5 0\n", snapshot));
+  EXPECT_FALSE(parseSnapshot("0 1 2 0.5 0 x\n", snapshot));
+}
+
+TEST(RenderTest, RenderSnapshot)
+{
+  const unsigned int length = 10;
+  Frame frame(200, 200);
+  const Projection projection(length, frame.getWidth(), frame.getHeight(), 60.0, 30.0);
+  const Snapshot snapshot{ .positions = { { .x = 5.0, .y = 5.0, .z = 5.0 } },
+    .velocities = { { .x = 1.0, .y = 0.0, .z = 0.0 } } };
+  renderSnapshot(frame, projection, snapshot, { .length = length, .vel_standard = 1.0, .title = "t = 1.00" });
+
+  const Rgb expected = fishColour(snapshot.velocities[0], 1.0);
+  const Rgb centre = frame.getPixel(100, 100);
+  EXPECT_EQ(centre.r, expected.r);
+  EXPECT_EQ(centre.g, expected.g);
+  EXPECT_EQ(centre.b, expected.b);
+
+  // The fish is no larger than its point
+  const Rgb background = frame.getPixel(110, 100);
+  EXPECT_FALSE(background.r == expected.r && background.g == expected.g && background.b == expected.b);
+}
+
+TEST(RenderTest, WritePng)
+{
+  Frame frame(3, 2);
+  frame.fill({ .r = 10, .g = 20, .b = 30 });
+  std::ostringstream output{};
+  writePng(output, frame);
+  const std::string png = output.str();
+  const std::vector<std::uint8_t> bytes(png.begin(), png.end());
+
+  const std::array<std::uint8_t, 8> signature{ 137, 80, 78, 71, 13, 10, 26, 10 };
+  ASSERT_GT(bytes.size(), signature.size() + 25 + 12);
+  EXPECT_TRUE(std::equal(signature.begin(), signature.end(), bytes.begin()));
+
+  // The header holds the size, a bit depth of 8 and the RGB colour type, and its CRC covers the type and data
+  const std::vector<std::uint8_t> header{ 0, 0, 0, 13, 'I', 'H', 'D', 'R', 0, 0, 0, 3, 0, 0, 0, 2, 8, 2, 0, 0, 0 };
+  EXPECT_TRUE(std::equal(header.begin(), header.end(), bytes.begin() + 8));
+
+  const std::array<std::uint8_t, 12> end{ 0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82 };
+  EXPECT_TRUE(std::equal(end.begin(), end.end(), bytes.end() - static_cast<std::ptrdiff_t>(end.size())));
+
+  // The stored pixels follow the filter byte of each row
+  const std::vector<std::uint8_t> row{ 0, 10, 20, 30, 10, 20, 30, 10, 20, 30 };
+  EXPECT_NE(std::search(bytes.begin(), bytes.end(), row.begin(), row.end()), bytes.end());
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+// NOLINTEND(readability-magic-numbers)
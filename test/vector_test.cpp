@@ -260,4 +260,48 @@ TEST(Vect3Test, Normalize)
   EXPECT_DOUBLE_EQ(result9.x, -1.0);
   EXPECT_DOUBLE_EQ(result9.y, 0.0);
   EXPECT_DOUBLE_EQ(result9.z, 0.0);
-}
\ No newline at end of file
+}
+
+// NOLINTBEGIN(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)
+TEST(Vect3Test, FloatVector)
+{
+  const Vect3f vect1{ .x = 1.0F, .y = 2.0F, .z = 2.0F };
+  const Vect3f vect2{ .x = 9.5F, .y = 0.5F, .z = 1.0F };
+  EXPECT_FLOAT_EQ(absolute(vect1), 3.0F);
+
+  const Vect3f sum = vect1 + 2 * vect2;
+  EXPECT_FLOAT_EQ(sum.x, 20.0F);
+  EXPECT_FLOAT_EQ(sum.y, 3.0F);
+  EXPECT_FLOAT_EQ(sum.z, 4.0F);
+
+  // Minimum image across the boundary of a box of length 10
+  const Vect3f rel = vect12(vect1, vect2, 10);
+  EXPECT_FLOAT_EQ(rel.x, -1.5F);
+  EXPECT_FLOAT_EQ(rel.y, -1.5F);
+  EXPECT_FLOAT_EQ(rel.z, -1.0F);
+
+  const Vect3 widened = castVect3<double>(vect2);
+  EXPECT_DOUBLE_EQ(widened.x, 9.5);
+}
+
+TEST(Vect3Test, FixedPoint)
+{
+  // A quarter of the box is 2^30, and positions outside the box wrap around it
+  const FixedVect3 fixed = toFixed({ .x = 2.5, .y = -2.5, .z = 12.5 }, 10);
+  EXPECT_EQ(fixed.x, 1U << 30U);
+  EXPECT_EQ(fixed.y, 3U << 30U);
+  EXPECT_EQ(fixed.z, 1U << 30U);
+
+  const Vect3 position = fromFixed(fixed, 10);
+  EXPECT_DOUBLE_EQ(position.x, 2.5);
+  EXPECT_DOUBLE_EQ(position.y, 7.5);
+
+  // The minimum image across the boundary, as for vect12() of the positions
+  const FixedVect3 fixed1 = toFixed({ .x = 9.5, .y = 0.5, .z = 1.0 }, 10);
+  const FixedVect3 fixed2 = toFixed({ .x = 1.0, .y = 9.0, .z = 2.0 }, 10);
+  const Vect3 rel = vect12(fixed1, fixed2, 10);
+  EXPECT_NEAR(rel.x, 1.5, 1e-8);
+  EXPECT_NEAR(rel.y, -1.5, 1e-8);
+  EXPECT_NEAR(rel.z, 1.0, 1e-8);
+}
+// NOLINTEND(readability-magic-numbers,cppcoreguidelines-avoid-magic-numbers)